@@ -0,0 +1,118 @@
+#!/usr/bin/env -S uv run --script
+# /// script
+# requires-python = ">=3.10"
+# dependencies = []
+# ///
+"""Time the read commands of the C CLI on a synthetic repository: cold, warm and indexed.
+
+Cold runs start with no .tickets/.index and with every ticket file evicted from the page
+cache (posix_fadvise DONTNEED, best effort), so the directory is read and parsed from disk.
+Warm runs follow an untimed run that left the files cached, still without an index, so every
+file is parsed again. Index runs follow `ticket index` and an untimed run, so unchanged files
+are answered from .tickets/.index.
+"""
+import argparse
+import math
+import os
+import statistics
+import sys
+import tempfile
+from pathlib import Path
+
+from gen_tickets import add_arguments, generate, ticket_id
+from scale import run_once
+
+BENCH_DIR = Path(__file__).resolve().parent
+DEFAULT_BINARY = BENCH_DIR.parent / "bin" / "ticket"
+PEAK_RSS = BENCH_DIR.parent / "bin" / "peak_rss"
+
+
+def commands(count: int) -> list[tuple[str, list[str]]]:
+    last = ticket_id(count - 1)
+    return [
+        ("ls", ["ls"]),
+        ("ready", ["ready"]),
+        ("blocked", ["blocked"]),
+        ("show", ["show", last]),
+        ("dep tree", ["dep", "tree", last]),
+        ("query", ["query"]),
+        ("closed", ["closed"]),
+    ]
+
+
+def drop_index(tickets_dir: Path) -> None:
+    index = tickets_dir / ".index"
+    if index.exists():
+        index.unlink()
+
+
+def evict(tickets_dir: Path) -> None:
+    drop_index(tickets_dir)
+    if not hasattr(os, "posix_fadvise"):
+        return
+    for entry in os.scandir(tickets_dir):
+        fd = os.open(entry.path, os.O_RDONLY)
+        try:
+            os.posix_fadvise(fd, 0, 0, os.POSIX_FADV_DONTNEED)
+        finally:
+            os.close(fd)
+
+
+def percentile(samples: list[float], fraction: float) -> float:
+    ordered = sorted(samples)
+    return ordered[max(0, math.ceil(fraction * len(ordered)) - 1)]
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--binary", type=Path, default=DEFAULT_BINARY)
+    parser.add_argument("--root", type=Path, help="generate the tree here and keep it")
+    parser.add_argument("--runs", type=int, default=10, help="timed runs per command and cache")
+    parser.add_argument("--only", help="comma-separated command names to time")
+    add_arguments(parser)
+    parser.set_defaults(count=10000, links=0.5, body_bytes=400, cycle_rate=0.01)
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory(prefix="ticket_bench_") as tmp:
+        root = args.root or Path(tmp)
+        generate(
+            root, args.count, args.deps, args.seed, args.links, args.body_bytes, args.cycle_rate
+        )
+        tickets_dir = root / ".tickets"
+        # A running `ticket serve` would answer instead of the binary under test.
+        os.environ["TICKET_NO_DAEMON"] = "1"
+
+        selected = commands(args.count)
+        if args.only:
+            names = set(args.only.split(","))
+            selected = [(name, command) for name, command in selected if name in names]
+
+        print(
+            f"{args.count} tickets, {args.deps} deps, {args.links} links, "
+            f"{args.body_bytes}-byte bodies, cycle rate {args.cycle_rate}, {args.runs} runs"
+        )
+        print(f"{'command':<10} {'cache':<5} {'p50 ms':>9} {'p95 ms':>9} {'peak RSS KiB':>13}")
+        for name, command in selected:
+            for cache in ("cold", "warm", "index"):
+                samples = []
+                if cache == "warm":
+                    drop_index(tickets_dir)
+                if cache == "index":
+                    run_once(args.binary, PEAK_RSS, root, ["index"])
+                if cache != "cold":
+                    run_once(args.binary, PEAK_RSS, root, command)
+                for _ in range(args.runs):
+                    if cache == "cold":
+                        evict(tickets_dir)
+                    samples.append(run_once(args.binary, PEAK_RSS, root, command))
+                elapsed = [seconds for seconds, _ in samples]
+                rss = max(kib for _, kib in samples)
+                print(
+                    f"{name:<10} {cache:<5} {statistics.median(elapsed) * 1000:>9.1f} "
+                    f"{percentile(elapsed, 0.95) * 1000:>9.1f} {rss:>13}"
+                )
+                sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
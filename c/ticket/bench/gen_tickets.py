@@ -0,0 +1,102 @@
+#!/usr/bin/env -S uv run --script
+# /// script
+# requires-python = ">=3.10"
+# dependencies = []
+# ///
+"""Generate a synthetic .tickets/ directory for benchmarking the C CLI."""
+import argparse
+import random
+import shutil
+import textwrap
+from pathlib import Path
+
+STATUSES = ["open", "open", "open", "in_progress", "closed", "closed"]
+FILLER = "Generated for benchmarking. "
+
+
+def ticket_id(n: int) -> str:
+    return f"bn-{n:06d}"
+
+
+def body_text(size: int) -> str:
+    if size <= 0:
+        return "Generated for benchmarking.\n"
+    text = (FILLER * (size // len(FILLER) + 1))[:size]
+    return textwrap.fill(text, 80) + "\n"
+
+
+def generate(
+    root: Path,
+    count: int,
+    deps: int,
+    seed: int,
+    links: float = 0.0,
+    body_bytes: int = 0,
+    cycle_rate: float = 0.0,
+) -> None:
+    tickets_dir = root / ".tickets"
+    if tickets_dir.exists():
+        shutil.rmtree(tickets_dir)
+    tickets_dir.mkdir(parents=True)
+
+    rng = random.Random(seed)
+    tickets = []
+    for n in range(count):
+        dep_ids = {ticket_id(rng.randrange(n)) for _ in range(deps)} if n > 0 else set()
+        tickets.append((rng.choice(STATUSES), dep_ids, rng.randrange(5)))
+
+    # Deps point at older tickets, so the graph is acyclic unless some point forward.
+    extra = random.Random(seed + 1)
+    if cycle_rate > 0:
+        for n in range(count - 1):
+            if extra.random() < cycle_rate:
+                tickets[n][1].add(ticket_id(extra.randrange(n + 1, count)))
+
+    link_ids = [set() for _ in range(count)]
+    if count > 1:
+        for _ in range(int(count * links / 2)):
+            a, b = extra.sample(range(count), 2)
+            link_ids[a].add(ticket_id(b))
+            link_ids[b].add(ticket_id(a))
+
+    body = body_text(body_bytes)
+    for n, (status, dep_ids, priority) in enumerate(tickets):
+        content = (
+            "---\n"
+            f"id: {ticket_id(n)}\n"
+            f"status: {status}\n"
+            f"deps: [{', '.join(sorted(dep_ids))}]\n"
+            f"links: [{', '.join(sorted(link_ids[n]))}]\n"
+            "created: 2024-01-01T00:00:00Z\n"
+            "type: task\n"
+            f"priority: {priority}\n"
+            "---\n"
+            f"# Synthetic ticket {n}\n\n"
+            f"{body}"
+        )
+        (tickets_dir / f"{ticket_id(n)}.md").write_text(content)
+
+
+def add_arguments(parser: argparse.ArgumentParser) -> None:
+    parser.add_argument("--count", type=int, default=1000)
+    parser.add_argument("--deps", type=int, default=2, help="dependencies per ticket")
+    parser.add_argument("--links", type=float, default=0.0, help="average links per ticket")
+    parser.add_argument("--body-bytes", type=int, default=0, help="size of each ticket body")
+    parser.add_argument(
+        "--cycle-rate", type=float, default=0.0, help="fraction of tickets given a forward dep"
+    )
+    parser.add_argument("--seed", type=int, default=1)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("root", type=Path, help="directory to create .tickets/ in")
+    add_arguments(parser)
+    args = parser.parse_args()
+    generate(
+        args.root, args.count, args.deps, args.seed, args.links, args.body_bytes, args.cycle_rate
+    )
+
+
+if __name__ == "__main__":
+    main()
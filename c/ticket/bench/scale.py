@@ -0,0 +1,62 @@
+#!/usr/bin/env -S uv run --script
+# /// script
+# requires-python = ">=3.10"
+# dependencies = []
+# ///
+"""Show how load time and peak RSS of the C CLI scale with the number of tickets."""
+import argparse
+import statistics
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+BENCH_DIR = Path(__file__).resolve().parent
+DEFAULT_BINARY = BENCH_DIR.parent / "bin" / "ticket"
+PEAK_RSS = BENCH_DIR.parent / "bin" / "peak_rss"
+
+
+def run_once(binary: Path, peak_rss: Path, cwd: Path, command: list[str]) -> tuple[float, int]:
+    result = subprocess.run(
+        [str(peak_rss), str(binary), *command],
+        cwd=cwd,
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.PIPE,
+        text=True,
+    )
+    if result.returncode != 0:
+        sys.exit(f"{' '.join(command)} failed in {cwd}")
+    stats = dict(field.split("=") for field in result.stderr.strip().splitlines()[-1].split())
+    return float(stats["elapsed_s"]), int(stats["peak_rss_kib"])
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--binary", type=Path, default=DEFAULT_BINARY)
+    parser.add_argument("--sizes", default="1000,10000,100000")
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--command", default="ls", help="ticket subcommand to time")
+    args = parser.parse_args()
+
+    sizes = [int(size) for size in args.sizes.split(",")]
+    command = args.command.split()
+
+    print(f"{'tickets':>8} {'median ms':>10} {'us/ticket':>10} {'peak RSS KiB':>13} {'KiB/ticket':>11}")
+    with tempfile.TemporaryDirectory(prefix="ticket_scale_") as tmp:
+        for size in sizes:
+            root = Path(tmp) / str(size)
+            subprocess.run(
+                [sys.executable, str(BENCH_DIR / "gen_tickets.py"), str(root), "--count", str(size)],
+                check=True,
+            )
+            samples = [run_once(args.binary, PEAK_RSS, root, command) for _ in range(args.runs)]
+            median = statistics.median(elapsed for elapsed, _ in samples)
+            rss = max(rss for _, rss in samples)
+            print(
+                f"{size:>8} {median * 1000:>10.1f} {median * 1e6 / size:>10.2f} "
+                f"{rss:>13} {rss / size:>11.3f}"
+            )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,21 @@
+#ifndef TICKET_ARENA_H
+#define TICKET_ARENA_H
+
+#include <stddef.h>
+
+typedef struct ArenaChunk ArenaChunk;
+
+/* Bump allocator: everything allocated from it is released at once by arena_free. */
+typedef struct {
+    ArenaChunk *head;
+    size_t used;
+    size_t capacity;
+    size_t total;
+} Arena;
+
+void arena_init(Arena *arena);
+void arena_free(Arena *arena);
+void *arena_alloc(Arena *arena, size_t size);
+char *arena_strndup(Arena *arena, const char *str, size_t len);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef TICKET_ATOMIC_WRITE_H
+#define TICKET_ATOMIC_WRITE_H
+
+#include <stdio.h>
+
+#include "ticket.h"
+
+/* The file is new: it is written unnamed (O_TMPFILE) where the system allows and linked into
+ * place, failing if the path exists by then. */
+#define ATOMIC_WRITE_CREATE 1
+
+/* A file being replaced: readers see the old content or all of the new, never a mix. Writes
+ * go to `stream`, backed by a temporary file in the same directory that atomic_file_commit
+ * renames (or links) over `path`. */
+typedef struct {
+    FILE *stream;
+    int flags;
+    char path[MAX_PATH];
+    char temp_path[MAX_PATH + 8];
+} AtomicFile;
+
+/* Returns non-zero if no temporary file could be made. A replaced file keeps its mode; a new
+ * one gets 0666 less the umask. */
+int atomic_file_open(AtomicFile *file, const char *path, int flags);
+/* Puts the content in place and closes the stream; on failure the old file is untouched.
+ * With TICKET_FSYNC=1 the data is on disk before it becomes visible. */
+int atomic_file_commit(AtomicFile *file);
+void atomic_file_abort(AtomicFile *file);
+int atomic_write_file(const char *path, const char *data, size_t len, int flags);
+/* With TICKET_FSYNC=1, fdatasyncs a file written in place, such as by an append. */
+int atomic_write_sync_fd(int fd);
+
+/* With TICKET_FSYNC=1, fsyncs once each directory a commit changed since the last call, so
+ * the renames survive a crash; run_command calls it when a command ends. */
+int atomic_write_sync(void);
+
+#endif
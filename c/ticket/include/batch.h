@@ -0,0 +1,12 @@
+#ifndef TICKET_BATCH_H
+#define TICKET_BATCH_H
+
+#include <stdio.h>
+
+/* Runs `ticket batch`: applies the operations read from in, one per line, to the tickets listed
+ * when it starts, and writes each changed ticket back once at the end. An error in an operation
+ * is printed after "Error: line N: " and the lines after it still run. Returns non-zero if any
+ * operation, or a write-back, failed. */
+int batch_run(FILE *in);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TICKET_COLUMNAR_H
+#define TICKET_COLUMNAR_H
+
+#include <stdint.h>
+
+#include "out_buf.h"
+#include "store.h"
+
+#define COLUMNAR_MAGIC "TKTCOLMN"
+#define COLUMNAR_VERSION 2
+#define COLUMNAR_BYTE_ORDER 0x01020304u
+/* Parent of a ticket that has none. */
+#define COLUMNAR_NONE UINT32_MAX
+/* Status and type codes are one byte. */
+#define COLUMNAR_MAX_NAMES 256
+
+/* Snapshot written by `ticket export --format=columnar`, meant to be mapped and scanned in
+ * place. All integers are in the writer's byte order, which byte_order (read as 0x01020304)
+ * confirms. After this header come, packed in this order:
+ *
+ *   uint32_t id_offsets[id_count + 1]
+ *   uint32_t title_offsets[ticket_count + 1]
+ *   uint32_t assignee_offsets[ticket_count + 1]
+ *   uint32_t status_offsets[status_count + 1]
+ *   uint32_t type_offsets[type_count + 1]
+ *   int32_t  priority[ticket_count]
+ *   uint32_t parent[ticket_count]
+ *   uint32_t dep_start[ticket_count + 1]
+ *   uint32_t dep_ids[dep_count]
+ *   uint32_t link_start[ticket_count + 1]
+ *   uint32_t link_ids[link_count]
+ *   uint8_t  status[ticket_count]
+ *   uint8_t  type[ticket_count]
+ *   char     strings[strings_size]
+ *
+ * String i of a column is strings[offsets[i]] up to strings[offsets[i + 1]], unterminated.
+ * Ids are numbered in load order: ticket i has id i, and ids that deps, links or a parent refer
+ * to without a ticket of their own follow from ticket_count on. parent, dep_ids and link_ids
+ * hold these numbers. Ticket i's deps are dep_ids[dep_start[i]] up to dep_ids[dep_start[i + 1]],
+ * and likewise for links. status[i] and type[i] index the status and type names; a ticket
+ * without a type or an assignee has the empty string. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t ticket_count;
+    uint32_t id_count;
+    uint32_t status_count;
+    uint32_t type_count;
+    uint32_t dep_count;
+    uint32_t link_count;
+    uint32_t strings_size;
+} ColumnarHeader;
+
+/* Writes the store as a snapshot. Returns non-zero, having written nothing, if memory runs
+ * out, the tickets use more than COLUMNAR_MAX_NAMES statuses or types, or the strings pass
+ * 4 GiB. */
+int columnar_write(const TicketStore *store, OutBuf *out);
+
+#endif
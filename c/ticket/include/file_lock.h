@@ -0,0 +1,19 @@
+#ifndef TICKET_FILE_LOCK_H
+#define TICKET_FILE_LOCK_H
+
+#include "index_cache.h"
+
+/* An exclusive flock(2) held on an open file. Ticket writers replace files by rename, so a
+ * lock on the old inode protects nothing once it is gone; acquiring re-checks that the path
+ * still names the locked inode and starts over on the new file if not. */
+typedef struct {
+    int fd;
+    FileStamp stamp;
+} FileLock;
+
+/* Blocks until path is locked. `stamp` is the locked file's, so a caller can tell whether it
+ * changed since an earlier read. Returns non-zero if the file cannot be opened. */
+int file_lock_acquire(FileLock *lock, const char *path);
+void file_lock_release(FileLock *lock);
+
+#endif
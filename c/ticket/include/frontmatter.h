@@ -0,0 +1,46 @@
+#ifndef TICKET_FRONTMATTER_H
+#define TICKET_FRONTMATTER_H
+
+#include <stddef.h>
+
+/* Unterminated slice of an open ticket file; valid until the file is closed. */
+typedef struct {
+    const char *ptr;
+    size_t len;
+} StrView;
+
+/* A ticket file opened read-only: large files are mapped, small ones read in one call. The
+ * frontmatter is the block between the first "---" line and the next one; everything outside
+ * it is body. Nothing past the closing "---" is scanned unless the title is asked for. */
+typedef struct {
+    void *map;
+    char *buffer;
+    const char *data;
+    size_t size;
+    size_t fm_open;
+    size_t fm_start;
+    size_t fm_end;
+    size_t body_start;
+} TicketFile;
+
+int ticket_file_open(TicketFile *file, const char *path);
+/* Wraps text already in memory, which must outlive the view; closing it frees nothing. */
+void ticket_file_view(TicketFile *file, const char *data, size_t size);
+void ticket_file_close(TicketFile *file);
+
+/* Iterates "key: value" lines in order; *cursor starts at 0. Lines without a colon are
+ * skipped, the value has leading spaces and the line terminator removed. */
+int frontmatter_next(const TicketFile *file, size_t *cursor, StrView *key, StrView *value);
+int frontmatter_get(const TicketFile *file, const char *key, StrView *value);
+StrView ticket_file_title(const TicketFile *file);
+
+/* "[a, b]" lists: frontmatter_list returns the text between the brackets (ptr is NULL when
+ * there is no list), frontmatter_list_next yields each non-empty, space-trimmed item. */
+StrView frontmatter_list(StrView value);
+int frontmatter_list_next(StrView *list, StrView *item);
+
+int strview_eq(StrView view, const char *str);
+StrView strview_token(StrView view);
+int strview_to_int(StrView view, int *out);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef TICKET_FRONTMATTER_PATCH_H
+#define TICKET_FRONTMATTER_PATCH_H
+
+#include "frontmatter.h"
+#include "out_buf.h"
+
+typedef enum {
+    FRONTMATTER_SET,
+    FRONTMATTER_LIST_ADD,
+    FRONTMATTER_LIST_REMOVE,
+} FrontmatterEditKind;
+
+/* One change to a "key: value" line. A set replaces the value; the list edits add value to, or
+ * remove every copy of it from, a "[a, b]" list (an empty value counts as an empty list). */
+typedef struct {
+    FrontmatterEditKind kind;
+    const char *key;
+    const char *value;
+} FrontmatterEdit;
+
+/* Writes the file's text to out with the edits applied in order, in one pass. Only the first
+ * line of each key, the one readers see, is patched; a missing key is added at the end of the
+ * frontmatter. Everything else, the body included, is copied in blocks as it is. An edit that
+ * would leave its line as it is, such as adding an item already listed, changes nothing, and
+ * a rewritten list is written as "[a, b]".
+ *
+ * Returns how many edits changed something, or -1 if out failed. With no frontmatter, nothing
+ * is changed. */
+int frontmatter_patch(const TicketFile *file, const FrontmatterEdit *edits, int count,
+                      OutBuf *out);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef TICKET_GRAPH_H
+#define TICKET_GRAPH_H
+
+#include "store.h"
+
+/* Dependency edges of a loaded store in compressed sparse row form. Ticket i's deps are
+ * dep_targets[dep_start[i] .. dep_start[i + 1]), as store indices or -1 for unknown ids; the
+ * tickets that depend on i are dependents[dependent_start[i] .. dependent_start[i + 1]), each
+ * listed once in store order, and its children (tickets whose parent is i) are
+ * children[child_start[i] .. child_start[i + 1]). unresolved[i] counts deps that are unknown
+ * or not closed. */
+typedef struct {
+    int count;
+    int *dep_start;
+    int *dep_targets;
+    int *dependent_start;
+    int *dependents;
+    int *child_start;
+    int *children;
+    int *unresolved;
+    unsigned char *closed;
+} TicketGraph;
+
+int ticket_graph_build(TicketGraph *graph, const TicketStore *store);
+void ticket_graph_free(TicketGraph *graph);
+
+/* Changes one ticket's status and adjusts the counters of the tickets that depend on it. */
+void ticket_graph_set_status(TicketGraph *graph, TicketStore *store, int ticket,
+                             const char *status);
+
+/* Open or in progress, and every dep exists and is closed. */
+int ticket_graph_is_ready(const TicketGraph *graph, const TicketStore *store, int ticket);
+/* Open or in progress, with at least one dep that is unknown or not closed. */
+int ticket_graph_is_blocked(const TicketGraph *graph, const TicketStore *store, int ticket);
+/* Whether dep_targets[edge] still blocks its ticket. */
+int ticket_graph_edge_unresolved(const TicketGraph *graph, int edge);
+
+/* Depths for a dep tree rooted at root. Edges that close a cycle on the DFS path are dropped,
+ * leaving a DAG in which max_depth[i] is the longest path from root to i and subtree_depth[i]
+ * the largest max_depth at or below i; both are -1 for tickets root cannot reach. Each array
+ * holds graph->count entries. Runs in O(tickets + deps) without recursion. */
+int ticket_graph_tree_depths(const TicketGraph *graph, int root, int *max_depth,
+                             int *subtree_depth);
+
+#endif
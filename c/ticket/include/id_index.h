@@ -0,0 +1,20 @@
+#ifndef TICKET_ID_INDEX_H
+#define TICKET_ID_INDEX_H
+
+#include <stddef.h>
+
+/* Open-addressing map from interned id pointers to ticket positions. Keys must come from
+ * the same Interner, so lookups compare pointers and never touch string bytes. */
+typedef struct {
+    const char **keys;
+    int *values;
+    size_t capacity;
+    size_t count;
+} IdIndex;
+
+void id_index_init(IdIndex *index);
+void id_index_free(IdIndex *index);
+int id_index_put(IdIndex *index, const char *key, int value);
+int id_index_get(const IdIndex *index, const char *key);
+
+#endif
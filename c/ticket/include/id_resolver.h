@@ -0,0 +1,56 @@
+#ifndef TICKET_ID_RESOLVER_H
+#define TICKET_ID_RESOLVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+#define ID_MATCHES_SHOWN 20
+
+/* Candidates for one partial ticket id: every offered id that contains the query. An id equal
+ * to the query wins outright. Allocation failures are sticky and reported on resolve. */
+typedef struct {
+    Arena arena;
+    const char *query;
+    size_t query_len;
+    const char *exact;
+    const char **ids;
+    int count;
+    int capacity;
+    int failed;
+} IdMatches;
+
+/* A fixed set of ids that many queries are resolved against, such as a batch's listing. Its
+ * trigram postings, pairs of (gram << 32 | id number) sorted, are built on the first query
+ * that can use them. */
+typedef struct {
+    const char **ids;
+    int count;
+    int capacity;
+    uint64_t *pairs;
+    size_t pair_count;
+    int built;
+} IdGrams;
+
+void id_grams_init(IdGrams *grams);
+void id_grams_free(IdGrams *grams);
+/* The id must outlive the set. Returns non-zero when out of memory. */
+int id_grams_add(IdGrams *grams, const char *id);
+
+void id_matches_init(IdMatches *matches, const char *query);
+void id_matches_free(IdMatches *matches);
+void id_matches_offer(IdMatches *matches, const char *id, size_t len);
+/* Offers the ids of .tickets/.index while it is current, narrowed through its trigram posting
+ * lists, and otherwise every ticket file in the directory. Returns 1 if neither is readable. */
+int id_match_tickets(IdMatches *matches);
+/* Offers the ids of the set that hold the query's rarest trigram, as id_match_tickets narrows
+ * through the index, or all of them for a query shorter than a trigram. */
+void id_match_grams(IdMatches *matches, IdGrams *grams);
+/* The id the query resolves to, or NULL after printing the not-found error or the ambiguous
+ * error followed by the sorted candidates. */
+const char *id_matches_resolve(IdMatches *matches);
+/* As id_matches_resolve, with context, such as "line 3: ", after the "Error: " it prints. */
+const char *id_matches_resolve_in(IdMatches *matches, const char *context);
+
+#endif
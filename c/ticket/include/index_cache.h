@@ -0,0 +1,118 @@
+#ifndef TICKET_INDEX_CACHE_H
+#define TICKET_INDEX_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "id_index.h"
+#include "store.h"
+
+#define INDEX_CACHE_PATH TICKETS_DIR "/.index"
+#define INDEX_GRAM_LEN 3
+
+typedef struct {
+    int64_t mtime_ns;
+    int64_t size;
+    uint64_t ino;
+} FileStamp;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t len;
+} IndexString;
+
+typedef struct {
+    FileStamp stamp;
+    IndexString id;
+    IndexString status;
+    IndexString title;
+    IndexString parent;
+    IndexString type;
+    IndexString assignee;
+    uint32_t deps_offset;
+    uint32_t dep_count;
+    uint32_t links_offset;
+    uint32_t link_count;
+    uint32_t dependents_offset;
+    uint32_t dependent_count;
+    uint32_t children_offset;
+    uint32_t child_count;
+    int32_t priority;
+    uint32_t reserved;
+} IndexEntry;
+
+/* One id trigram and the slice of the posting array listing, in entry order, every entry
+ * whose id contains it. */
+typedef struct {
+    uint32_t gram;
+    uint32_t first;
+    uint32_t count;
+} IndexGram;
+
+/* Read-only view of .tickets/.index, mapped for the duration of one load. An entry's dependents
+ * and children are edges[offset .. offset + count), entry numbers in store order, as
+ * ticket_graph_build found them when the index was written. */
+typedef struct {
+    void *map;
+    size_t map_size;
+    const IndexEntry *entries;
+    const IndexString *refs;
+    const IndexGram *grams;
+    const uint32_t *postings;
+    const uint32_t *edges;
+    const char *strings;
+    uint32_t entry_count;
+    uint32_t gram_count;
+    uint32_t posting_count;
+    uint32_t edge_count;
+    uint32_t strings_size;
+    FileStamp dir_stamp;
+    IdIndex by_id;
+} IndexCache;
+
+int index_cache_enabled(void);
+void file_stamp_from_stat(FileStamp *stamp, const struct stat *st);
+int file_stamp_equal(const FileStamp *a, const FileStamp *b);
+/* Stamp of the tickets directory itself; it moves whenever a file in it is created, removed
+ * or renamed over. */
+int index_cache_dir_stamp(FileStamp *stamp);
+/* Maps the index and checks its header only; index_cache_open also validates and interns
+ * every entry. */
+int index_cache_map(IndexCache *cache);
+int index_cache_open(IndexCache *cache, Interner *ids);
+void index_cache_close(IndexCache *cache);
+const IndexEntry *index_cache_lookup(const IndexCache *cache, const char *interned_id,
+                                     const FileStamp *stamp);
+int index_cache_fill_ticket(const IndexCache *cache, const IndexEntry *entry, TicketStore *store,
+                            Ticket *t);
+/* 1 while the directory is exactly as it was listed for the mapped index, so its ids are the
+ * current set of tickets. */
+int index_cache_is_current(const IndexCache *cache);
+const char *index_cache_entry_id(const IndexCache *cache, uint32_t entry, size_t *len);
+/* Entries whose id contains the INDEX_GRAM_LEN bytes at `text`; NULL when none does. */
+const uint32_t *index_cache_gram_entries(const IndexCache *cache, const char *text,
+                                         uint32_t *count);
+/* `listed` is the directory stamp taken before the store was listed, or NULL when the store
+ * does not hold every ticket file; only then does the index vouch for the id set. */
+int index_cache_write(const TicketStore *store, const FileStamp *stamps, const FileStamp *listed);
+/* A commit of one ticket file, made under the lock index writers hold so that no other
+ * cooperating process changes the directory between the stamps taken around it. */
+typedef struct {
+    int lock;
+    int have_before;
+    FileStamp before;
+} IndexDirChange;
+
+void index_cache_change_begin(IndexDirChange *change);
+/* Unlocks after the commit. When a file was replaced through a rename (`ids_kept`), the set of
+ * ids did not change, so the index's directory stamp is carried forward if it matched the one
+ * begin took; when a ticket was created, the stamp is cleared, since a directory change within
+ * the same clock tick may not move it. */
+void index_cache_change_end(IndexDirChange *change, int ids_kept);
+/* Replaces a ticket file with data. The rename is made between two directory stamps under the
+ * index's lock, so the index is carried over it without taking in a ticket another process
+ * created. Returns non-zero, leaving the file as it was, on failure. */
+int index_cache_replace_file(const char *path, const char *data, size_t len);
+
+#endif
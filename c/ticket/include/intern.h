@@ -0,0 +1,29 @@
+#ifndef TICKET_INTERN_H
+#define TICKET_INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+typedef struct {
+    const char *str;
+    uint32_t hash;
+    uint32_t len;
+} InternSlot;
+
+/* Deduplicating string table; equal strings intern to the same pointer. */
+typedef struct {
+    Arena *arena;
+    InternSlot *slots;
+    size_t capacity;
+    size_t count;
+} Interner;
+
+void intern_init(Interner *interner, Arena *arena);
+void intern_free(Interner *interner);
+uint32_t intern_hash(const char *str, size_t len);
+const char *intern(Interner *interner, const char *str, size_t len);
+const char *intern_lookup(const Interner *interner, const char *str, size_t len);
+
+#endif
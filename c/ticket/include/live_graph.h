@@ -0,0 +1,41 @@
+#ifndef TICKET_LIVE_GRAPH_H
+#define TICKET_LIVE_GRAPH_H
+
+#include <stddef.h>
+
+#include "graph.h"
+
+#define LIVE_UNCHANGED 0
+#define LIVE_CHANGED 1
+#define LIVE_GONE 2
+
+/* A store and its graph kept current with .tickets/ through inotify. A refresh re-parses
+ * only the files named by queued events: edits update tickets in place, and files that come,
+ * go or are renamed over re-list the directory without parsing the rest. A status-only edit
+ * adjusts the graph counters through ticket_graph_set_status; any other change rebuilds the
+ * CSR arrays from memory. */
+typedef struct {
+    TicketStore store;
+    TicketGraph graph;
+    int valid;
+    int inotify_fd;
+    const char *sentinel;
+    size_t loaded_size;
+    /* Set by each LIVE_CHANGED refresh: the ids it re-read, or `relisted` when tickets came,
+     * went or were loaded afresh, so positions and edges may have moved anywhere. */
+    const char **changed;
+    int changed_count;
+    int relisted;
+} LiveGraph;
+
+/* Starts watching, then loads. `sentinel` names a file in .tickets/ whose removal counts as
+ * LIVE_GONE (serve's socket), or is NULL. A failed load leaves `valid` at 0 and is retried by
+ * the next refresh; only a failure to watch is an error. */
+int live_graph_open(LiveGraph *live, const char *sentinel);
+void live_graph_close(LiveGraph *live);
+
+/* Applies every queued event without blocking: LIVE_UNCHANGED, LIVE_CHANGED, or LIVE_GONE
+ * once the directory or the sentinel is removed. */
+int live_graph_refresh(LiveGraph *live);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef TICKET_OUT_BUF_H
+#define TICKET_OUT_BUF_H
+
+#include <stddef.h>
+
+#include "frontmatter.h"
+
+#define OUT_BUF_SIZE (64 * 1024)
+
+/* Buffered writer on a file descriptor. Write errors are sticky: the append functions return
+ * nothing and out_buf_flush reports whether anything was lost. */
+typedef struct {
+    int fd;
+    int failed;
+    size_t len;
+    size_t capacity;
+    char *data;
+} OutBuf;
+
+int out_buf_init(OutBuf *out, int fd);
+/* A buffer with no descriptor that grows to hold everything appended; flushing it does
+ * nothing, and running out of memory counts as a failed write. */
+int out_buf_init_memory(OutBuf *out);
+/* Flushes, then releases the buffer. Returns non-zero if any write failed. */
+int out_buf_close(OutBuf *out);
+int out_buf_flush(OutBuf *out);
+
+void out_buf_write(OutBuf *out, const char *data, size_t len);
+void out_buf_putc(OutBuf *out, char c);
+void out_buf_puts(OutBuf *out, const char *s);
+/* Writes s left-justified in width columns, as printf's "%-*s" does. */
+void out_buf_pad(OutBuf *out, const char *s, size_t width);
+/* Writes value in decimal, as printf's "%d" does. */
+void out_buf_int(OutBuf *out, long long value);
+
+/* Writes str as a quoted JSON string, escaping quotes, backslashes, \n, \r and \t. */
+void out_buf_json_string(OutBuf *out, StrView str);
+
+#endif
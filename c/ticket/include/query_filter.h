@@ -0,0 +1,21 @@
+#ifndef TICKET_QUERY_FILTER_H
+#define TICKET_QUERY_FILTER_H
+
+#include "frontmatter.h"
+
+#define FILTER_NEEDS_JQ (-1)
+
+typedef struct QueryFilter QueryFilter;
+
+/* Compiles the jq subset that query evaluates natively: .field and ."field" paths, string,
+ * number, true/false/null and constant array literals, == != < <= > >=, and, or, "| not",
+ * "| length", contains(x), IN(...), IN(src; x), any(gen; cond) and all(gen; cond), where
+ * generators may iterate an array with "[]". Returns NULL for anything else. */
+QueryFilter *query_filter_compile(const char *source);
+void query_filter_free(QueryFilter *filter);
+
+/* 1 when `select(filter)` keeps the ticket, 0 when it drops it, FILTER_NEEDS_JQ when jq would
+ * raise an error or print the ticket differently from query's own JSON line. */
+int query_filter_match(const QueryFilter *filter, const TicketFile *file);
+
+#endif
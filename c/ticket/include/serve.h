@@ -0,0 +1,23 @@
+#ifndef TICKET_SERVE_H
+#define TICKET_SERVE_H
+
+#include "ticket.h"
+
+#define SERVE_SOCKET_NAME ".serve.sock"
+#define SERVE_SOCKET_PATH TICKETS_DIR "/" SERVE_SOCKET_NAME
+#define SERVE_MAX_REQUEST (1024 * 1024)
+
+typedef int (*ServeHandler)(int argc, char *argv[]);
+
+/* Hands argv, the working directory, the TICKET_* variables and stdin/stdout/stderr to a
+ * running `ticket serve`.
+ * Returns 0 with the command's exit status in *status, or 1 when no daemon answers and the
+ * command should run in this process. TICKET_NO_DAEMON=1 always runs it here. */
+int serve_forward(int argc, char *argv[], int *status);
+
+/* Keeps the tickets loaded and watched until SIGINT or SIGTERM. Each request runs `handler`
+ * in a forked child on the client's descriptors and TICKET_* variables, after the resident
+ * store has caught up with every change inotify reported. */
+int serve_run(ServeHandler handler);
+
+#endif
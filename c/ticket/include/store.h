@@ -0,0 +1,48 @@
+#ifndef TICKET_STORE_H
+#define TICKET_STORE_H
+
+#include <stddef.h>
+
+#include "arena.h"
+#include "id_index.h"
+#include "intern.h"
+#include "ticket.h"
+
+/* All tickets of one invocation. Records live in the arena and never move; only the
+ * pointer array is reallocated as the store grows. */
+typedef struct {
+    Arena arena;
+    Interner strings;
+    IdIndex ids;
+    Ticket **tickets;
+    int count;
+    int capacity;
+} TicketStore;
+
+void ticket_store_init(TicketStore *store);
+void ticket_store_free(TicketStore *store);
+Ticket *ticket_store_add(TicketStore *store, const char *id, size_t id_len);
+/* Parser threads for load_all_tickets; 0 picks TICKET_JOBS or the number of online CPUs. */
+void set_load_workers(int workers);
+/* The next load_all_tickets takes over `store` instead of reading the directory; serve uses
+ * this to hand each request child the resident tickets. */
+void set_preloaded_store(TicketStore *store);
+int load_all_tickets(TicketStore *store);
+/* Loads every ticket and rewrites .tickets/.index; returns 2 if only the write failed. */
+int rebuild_ticket_index(TicketStore *store);
+/* Loads, in directory order, only ticket `id` and the tickets `show` lists beside it: its
+ * deps, links and parent, and the tickets that depend on it or name it as parent. Those come
+ * from .tickets/.index, so this needs every ticket file to match its entry; otherwise it
+ * returns 1, having loaded nothing, and the caller loads every ticket instead. */
+int load_ticket_neighbourhood(TicketStore *store, const char *id);
+#define STORE_NEEDS_LISTING 2
+/* Re-reads only the files of `changed`, ids interned in the store, after they were created,
+ * modified or deleted; every other ticket keeps its record. With `relist` the directory is
+ * listed again, so tickets come and go and the order matches a fresh load. Without it the
+ * named tickets are updated in place, keeping their positions, and STORE_NEEDS_LISTING means
+ * one of them could not be read. After a return of 1 the store must be loaded afresh. */
+int ticket_store_refresh(TicketStore *store, const char *const *changed, int count, int relist);
+int find_ticket(const TicketStore *store, const char *id);
+int find_ticket_interned(const TicketStore *store, const char *id);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef TICKET_TICKET_H
+#define TICKET_TICKET_H
+
+#define TICKETS_DIR ".tickets"
+#define MAX_PATH 1024
+
+typedef struct {
+    const char *id;
+    const char *status;
+    const char *title;
+    const char *parent;
+    const char *type;
+    const char *assignee;
+    const char **deps;
+    const char **links;
+    int dep_count;
+    int link_count;
+    int priority;
+} Ticket;
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef TICKET_TRACE_H
+#define TICKET_TRACE_H
+
+#include <stdint.h>
+
+/* Wall-clock phases of one command. Spans are recorded on the calling thread only; the
+ * parse phase covers the whole parallel load, and per-file parse time is a counter. */
+typedef enum {
+    TRACE_SCAN,
+    TRACE_LOAD,
+    TRACE_INDEX_READ,
+    TRACE_INDEX_WRITE,
+    TRACE_GRAPH,
+    TRACE_OUTPUT,
+    TRACE_JQ_WAIT,
+    TRACE_PHASE_COUNT
+} TracePhase;
+
+/* Totals that any thread may add to. */
+typedef enum {
+    TRACE_FILES_OPENED,
+    TRACE_BYTES_READ,
+    TRACE_FILES_PARSED,
+    TRACE_PARSE_NS,
+    TRACE_INDEX_HITS,
+    TRACE_COUNTER_COUNT
+} TraceCounter;
+
+#ifdef TICKET_NO_TRACE
+
+#define TRACE_COMMAND_BEGIN(name) ((void)0)
+#define TRACE_COMMAND_END() ((void)0)
+#define TRACE_BEGIN(start) ((void)0)
+#define TRACE_END(phase, start) ((void)0)
+#define TRACE_ELAPSED(counter, start) ((void)0)
+#define TRACE_COUNT(counter, n) ((void)0)
+
+#else
+
+/* TICKET_TRACE=1 (or "summary") prints per-phase times and the counters to stderr when the
+ * command ends; TICKET_TRACE=chrome prints them as Chrome trace JSON instead. */
+void trace_command_begin(const char *name);
+void trace_command_end(void);
+extern int trace_enabled;
+uint64_t trace_now(void);
+void trace_span(TracePhase phase, uint64_t start);
+void trace_add(TraceCounter counter, uint64_t n);
+
+#define TRACE_COMMAND_BEGIN(name) trace_command_begin(name)
+#define TRACE_COMMAND_END() trace_command_end()
+#define TRACE_BEGIN(start) uint64_t start = trace_enabled ? trace_now() : 0
+#define TRACE_END(phase, start)                                                                    \
+    do {                                                                                           \
+        if (trace_enabled) {                                                                       \
+            trace_span(phase, start);                                                              \
+        }                                                                                          \
+    } while (0)
+#define TRACE_ELAPSED(counter, start)                                                              \
+    do {                                                                                           \
+        if (trace_enabled) {                                                                       \
+            trace_add(counter, trace_now() - (start));                                             \
+        }                                                                                          \
+    } while (0)
+#define TRACE_COUNT(counter, n)                                                                    \
+    do {                                                                                           \
+        if (trace_enabled) {                                                                       \
+            trace_add(counter, (uint64_t)(n));                                                     \
+        }                                                                                          \
+    } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef TICKET_WATCH_H
+#define TICKET_WATCH_H
+
+#include <stdio.h>
+
+#include "arena.h"
+#include "graph.h"
+#include "id_index.h"
+#include "intern.h"
+#include "live_graph.h"
+#include "out_buf.h"
+
+/* One listing followed by `--watch`. `shows` picks the tickets it contains, `print` writes one
+ * ticket's line without the newline, and `compare` orders Ticket pointers as qsort does. */
+typedef struct {
+    int (*shows)(const TicketStore *store, const TicketGraph *graph, int ticket, const void *ctx);
+    void (*print)(OutBuf *out, const TicketStore *store, const TicketGraph *graph, int ticket);
+    int (*compare)(const void *a, const void *b);
+    const void *ctx;
+} WatchListing;
+
+/* The lines currently on screen, keyed by ids interned in the view's own arena so they
+ * outlive a reload of the store. */
+typedef struct {
+    Arena arena;
+    Interner ids;
+    IdIndex rows;
+    const char **row_ids;
+    char **lines;
+    int count;
+    int capacity;
+} WatchView;
+
+void watch_view_init(WatchView *view);
+void watch_view_free(WatchView *view);
+/* Prints what the last refresh changed: "+ line" for a ticket that joined the listing,
+ * "- line" for one that left and "~ line" for one whose line changed. Deleted tickets come
+ * first, the rest in listing order. Only the re-read tickets and their dependents are checked
+ * unless the refresh re-listed. With `initial` every shown line is printed bare. Returns 1 on
+ * allocation failure. */
+int watch_view_update(WatchView *view, const WatchListing *listing, const LiveGraph *live,
+                      FILE *out, int initial);
+
+/* Prints the listing, then follows .tickets/ through inotify and prints each change. Only
+ * returns, with 1, once the directory is removed or on error. */
+int watch_listing(const WatchListing *listing);
+
+#endif
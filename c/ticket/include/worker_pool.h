@@ -0,0 +1,34 @@
+#ifndef TICKET_WORKER_POOL_H
+#define TICKET_WORKER_POOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+/* Called once per index; worker is 0 for the calling thread and 1..workers-1 otherwise. */
+typedef void (*WorkerTask)(void *ctx, int worker, size_t index);
+
+typedef struct WorkerThread WorkerThread;
+
+/* Fixed-size thread pool. The thread that calls worker_pool_run works alongside the pool,
+ * so a pool of one runs everything inline without creating threads. */
+typedef struct {
+    WorkerThread *threads;
+    int workers;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned long generation;
+    WorkerTask task;
+    void *ctx;
+    size_t next;
+    size_t count;
+    int active;
+    int stopping;
+} WorkerPool;
+
+int worker_pool_default_size(void);
+int worker_pool_start(WorkerPool *pool, int workers);
+void worker_pool_run(WorkerPool *pool, WorkerTask task, void *ctx, size_t count);
+void worker_pool_stop(WorkerPool *pool);
+
+#endif
@@ -0,0 +1,100 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN (sizeof(void *) > sizeof(double) ? sizeof(void *) : sizeof(double))
+
+struct ArenaChunk {
+    ArenaChunk *next;
+    size_t size;
+    unsigned char *data;
+};
+
+void arena_init(Arena *arena)
+{
+    arena->head = NULL;
+    arena->used = 0;
+    arena->capacity = 0;
+    arena->total = 0;
+}
+
+void arena_free(Arena *arena)
+{
+    ArenaChunk *chunk = arena->head;
+    while (chunk != NULL) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena_init(arena);
+}
+
+static ArenaChunk *arena_new_chunk(size_t size)
+{
+    size_t header = (sizeof(ArenaChunk) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    ArenaChunk *chunk = malloc(header + size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->data = (unsigned char *)chunk + header;
+    return chunk;
+}
+
+void *arena_alloc(Arena *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (size == 0) {
+        size = ARENA_ALIGN;
+    }
+
+    if (arena->head == NULL || arena->capacity - arena->used < size) {
+        if (size > ARENA_CHUNK_SIZE / 4) {
+            /* Oversized requests get a dedicated chunk behind the current one so the
+             * partially filled head keeps serving small allocations. */
+            ArenaChunk *chunk = arena_new_chunk(size);
+            if (chunk == NULL) {
+                return NULL;
+            }
+            if (arena->head == NULL) {
+                chunk->next = NULL;
+                arena->head = chunk;
+                arena->used = size;
+                arena->capacity = size;
+            } else {
+                chunk->next = arena->head->next;
+                arena->head->next = chunk;
+            }
+            arena->total += size;
+            return chunk->data;
+        }
+
+        ArenaChunk *chunk = arena_new_chunk(ARENA_CHUNK_SIZE);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = arena->head;
+        arena->head = chunk;
+        arena->used = 0;
+        arena->capacity = ARENA_CHUNK_SIZE;
+        arena->total += ARENA_CHUNK_SIZE;
+    }
+
+    void *ptr = arena->head->data + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+char *arena_strndup(Arena *arena, const char *str, size_t len)
+{
+    char *copy = arena_alloc(arena, len + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
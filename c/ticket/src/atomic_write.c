@@ -0,0 +1,180 @@
+/* O_TMPFILE is a GNU extension. */
+#define _GNU_SOURCE
+
+#include "atomic_write.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Directories past this many are fsync'ed at once instead of when the command ends. */
+#define ATOMIC_MAX_PENDING_DIRS 8
+
+static char pending_dirs[ATOMIC_MAX_PENDING_DIRS][MAX_PATH];
+static int pending_dir_count;
+
+static int sync_enabled(void)
+{
+    const char *value = getenv("TICKET_FSYNC");
+    return value != NULL && value[0] != '\0' && strcmp(value, "0") != 0;
+}
+
+int atomic_write_sync_fd(int fd)
+{
+    return sync_enabled() && fdatasync(fd) != 0;
+}
+
+static void parent_dir(const char *path, char *dir, size_t size)
+{
+    const char *slash = strrchr(path, '/');
+    if (slash == NULL) {
+        snprintf(dir, size, ".");
+    } else if (slash == path) {
+        snprintf(dir, size, "/");
+    } else {
+        snprintf(dir, size, "%.*s", (int)(slash - path), path);
+    }
+}
+
+static int sync_dir(const char *dir)
+{
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return 1;
+    }
+    int failed = fsync(fd) != 0;
+    return close(fd) != 0 || failed;
+}
+
+int atomic_write_sync(void)
+{
+    int failed = 0;
+    for (int i = 0; i < pending_dir_count; i++) {
+        failed |= sync_dir(pending_dirs[i]);
+    }
+    pending_dir_count = 0;
+    return failed;
+}
+
+static int dir_changed(const char *path)
+{
+    if (!sync_enabled()) {
+        return 0;
+    }
+    char dir[MAX_PATH];
+    parent_dir(path, dir, sizeof(dir));
+    for (int i = 0; i < pending_dir_count; i++) {
+        if (strcmp(pending_dirs[i], dir) == 0) {
+            return 0;
+        }
+    }
+    if (pending_dir_count == ATOMIC_MAX_PENDING_DIRS) {
+        return sync_dir(dir);
+    }
+    snprintf(pending_dirs[pending_dir_count++], MAX_PATH, "%s", dir);
+    return 0;
+}
+
+static mode_t file_mode(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        return st.st_mode & 07777;
+    }
+    mode_t mask = umask(0);
+    umask(mask);
+    return 0666 & ~mask;
+}
+
+int atomic_file_open(AtomicFile *file, const char *path, int flags)
+{
+    memset(file, 0, sizeof(*file));
+    file->flags = flags;
+    snprintf(file->path, sizeof(file->path), "%s", path);
+    mode_t mode = file_mode(path);
+
+    int fd = -1;
+#ifdef O_TMPFILE
+    /* An unnamed file is linked in through /proc, so it is only used when that is mounted;
+     * filesystems without O_TMPFILE support fail the open and fall back below. */
+    if ((flags & ATOMIC_WRITE_CREATE) && access("/proc/self/fd", X_OK) == 0) {
+        char dir[MAX_PATH];
+        parent_dir(path, dir, sizeof(dir));
+        fd = open(dir, O_TMPFILE | O_WRONLY | O_CLOEXEC, mode);
+    }
+#endif
+    if (fd < 0) {
+        snprintf(file->temp_path, sizeof(file->temp_path), "%s.XXXXXX", path);
+        fd = mkstemp(file->temp_path);
+        if (fd < 0) {
+            return 1;
+        }
+        if (fchmod(fd, mode) != 0) {
+            close(fd);
+            unlink(file->temp_path);
+            return 1;
+        }
+    }
+
+    file->stream = fdopen(fd, "w");
+    if (file->stream == NULL) {
+        close(fd);
+        if (file->temp_path[0] != '\0') {
+            unlink(file->temp_path);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int atomic_file_commit(AtomicFile *file)
+{
+    int fd = fileno(file->stream);
+    int failed = fflush(file->stream) != 0 || ferror(file->stream);
+    failed = failed || atomic_write_sync_fd(fd) != 0;
+
+    if (file->temp_path[0] == '\0') {
+        char proc_path[64];
+        snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", fd);
+        failed = failed ||
+                 linkat(AT_FDCWD, proc_path, AT_FDCWD, file->path, AT_SYMLINK_FOLLOW) != 0;
+        failed |= fclose(file->stream) != 0;
+    } else {
+        failed |= fclose(file->stream) != 0;
+        if (file->flags & ATOMIC_WRITE_CREATE) {
+            failed = failed || link(file->temp_path, file->path) != 0;
+            unlink(file->temp_path);
+        } else {
+            failed = failed || rename(file->temp_path, file->path) != 0;
+            if (failed) {
+                unlink(file->temp_path);
+            }
+        }
+    }
+    file->stream = NULL;
+    return failed || dir_changed(file->path);
+}
+
+void atomic_file_abort(AtomicFile *file)
+{
+    fclose(file->stream);
+    file->stream = NULL;
+    if (file->temp_path[0] != '\0') {
+        unlink(file->temp_path);
+    }
+}
+
+int atomic_write_file(const char *path, const char *data, size_t len, int flags)
+{
+    AtomicFile file;
+    if (atomic_file_open(&file, path, flags) != 0) {
+        return 1;
+    }
+    if (len > 0 && fwrite(data, 1, len, file.stream) != len) {
+        atomic_file_abort(&file);
+        return 1;
+    }
+    return atomic_file_commit(&file);
+}
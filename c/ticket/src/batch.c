@@ -0,0 +1,534 @@
+#define _DEFAULT_SOURCE
+
+#include "batch.h"
+
+#include <dirent.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "arena.h"
+#include "file_lock.h"
+#include "frontmatter.h"
+#include "frontmatter_patch.h"
+#include "id_index.h"
+#include "id_resolver.h"
+#include "index_cache.h"
+#include "intern.h"
+#include "out_buf.h"
+#include "ticket.h"
+
+#define BATCH_MAX_ARGS 256
+
+/* A ticket named in the directory listing. Its text is loaded on first use, patched in memory
+ * by every operation that changes it and written back once when the batch ends. `stamp` is
+ * the file's when it was read: if another writer changed it by then, the edits, kept with
+ * values copied to the batch arena, are replayed on the current content instead of
+ * overwriting that change. */
+typedef struct {
+    const char *id;
+    char *text;
+    size_t len;
+    int loaded;
+    int dirty;
+    FileStamp stamp;
+    FrontmatterEdit *edits;
+    /* The input line each edit came from. */
+    int *lines;
+    int edit_count;
+    int edit_capacity;
+} BatchFile;
+
+typedef struct {
+    Arena arena;
+    Interner ids;
+    IdIndex slots;
+    /* The listed ids in slot order, for resolving partial ids. */
+    IdGrams grams;
+    BatchFile *files;
+    int count;
+    int line;
+    /* "line N: " while that line is applied, and "<id>: " while that ticket is written back,
+     * so every error says where it came from. */
+    char context[MAX_PATH];
+} Batch;
+
+static void batch_error(const Batch *batch, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "Error: %s", batch->context);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+static void batch_free(Batch *batch)
+{
+    for (int i = 0; i < batch->count; i++) {
+        free(batch->files[i].text);
+        free(batch->files[i].edits);
+        free(batch->files[i].lines);
+    }
+    free(batch->files);
+    id_index_free(&batch->slots);
+    id_grams_free(&batch->grams);
+    intern_free(&batch->ids);
+    arena_free(&batch->arena);
+}
+
+static int batch_open(Batch *batch)
+{
+    arena_init(&batch->arena);
+    intern_init(&batch->ids, &batch->arena);
+    id_index_init(&batch->slots);
+    id_grams_init(&batch->grams);
+    batch->files = NULL;
+    batch->count = 0;
+    batch->line = 0;
+    batch->context[0] = '\0';
+
+    DIR *dir = opendir(TICKETS_DIR);
+    if (dir == NULL) {
+        batch_error(batch, "cannot open tickets directory\n");
+        return 1;
+    }
+
+    int capacity = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (entry->d_name[0] == '.' || len < 4 || strcmp(entry->d_name + len - 3, ".md") != 0) {
+            continue;
+        }
+
+        if (batch->count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            BatchFile *grown = realloc(batch->files, sizeof(BatchFile) * (size_t)capacity);
+            if (grown == NULL) {
+                closedir(dir);
+                return 1;
+            }
+            batch->files = grown;
+        }
+
+        const char *id = intern(&batch->ids, entry->d_name, len - 3);
+        if (id == NULL || id_index_put(&batch->slots, id, batch->count) != 0 ||
+            id_grams_add(&batch->grams, id) != 0) {
+            closedir(dir);
+            return 1;
+        }
+        memset(&batch->files[batch->count], 0, sizeof(BatchFile));
+        batch->files[batch->count].id = id;
+        batch->count++;
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+/* Same matching rules as resolve_ticket_id, against the listing taken when the batch began, and
+ * narrowed the same way through trigram postings. */
+static int batch_resolve(Batch *batch, const char *query)
+{
+    const char *exact = intern_lookup(&batch->ids, query, strlen(query));
+    if (exact != NULL) {
+        return id_index_get(&batch->slots, exact);
+    }
+
+    IdMatches matches;
+    id_matches_init(&matches, query);
+    id_match_grams(&matches, &batch->grams);
+    const char *id = id_matches_resolve_in(&matches, batch->context);
+    int slot = -1;
+    if (id != NULL) {
+        slot = id_index_get(&batch->slots, intern_lookup(&batch->ids, id, strlen(id)));
+    }
+    id_matches_free(&matches);
+    return slot;
+}
+
+/* Reads the file's current text and stamp; the stamp is taken first, so a write racing the
+ * read leaves a stale stamp and is caught when the batch writes back. */
+static int batch_read(const Batch *batch, BatchFile *file, const char *file_path)
+{
+    struct stat st;
+    TicketFile source;
+    if (stat(file_path, &st) != 0 || ticket_file_open(&source, file_path) != 0) {
+        batch_error(batch, "cannot read ticket file\n");
+        return 1;
+    }
+    file_stamp_from_stat(&file->stamp, &st);
+
+    char *text = malloc(source.size + 1);
+    if (text == NULL) {
+        ticket_file_close(&source);
+        batch_error(batch, "out of memory\n");
+        return 1;
+    }
+    memcpy(text, source.data, source.size);
+    free(file->text);
+    file->text = text;
+    file->len = source.size;
+    file->loaded = 1;
+    ticket_file_close(&source);
+    return 0;
+}
+
+static BatchFile *batch_file(Batch *batch, int slot)
+{
+    BatchFile *file = &batch->files[slot];
+    if (file->loaded) {
+        return file;
+    }
+
+    char file_path[MAX_PATH];
+    snprintf(file_path, sizeof(file_path), "%s/%s.md", TICKETS_DIR, file->id);
+    return batch_read(batch, file, file_path) == 0 ? file : NULL;
+}
+
+/* Replaces the file's text with the edits applied; *changes is how many changed it. */
+static int batch_apply(const Batch *batch, BatchFile *file, const FrontmatterEdit *edits, int count,
+                       int *changes)
+{
+    TicketFile view;
+    ticket_file_view(&view, file->text, file->len);
+    OutBuf text;
+    if (out_buf_init_memory(&text) != 0 ||
+        (*changes = frontmatter_patch(&view, edits, count, &text)) < 0) {
+        out_buf_close(&text);
+        batch_error(batch, "out of memory\n");
+        return 1;
+    }
+
+    free(file->text);
+    file->text = text.data;
+    file->len = text.len;
+    return 0;
+}
+
+static int batch_patch(Batch *batch, int slot, FrontmatterEditKind kind, const char *key,
+                       const char *value, int *changed)
+{
+    BatchFile *file = batch_file(batch, slot);
+    if (file == NULL) {
+        return 1;
+    }
+
+    if (file->edit_count == file->edit_capacity) {
+        int capacity = file->edit_capacity ? file->edit_capacity * 2 : 4;
+        FrontmatterEdit *grown = realloc(file->edits, sizeof(FrontmatterEdit) * (size_t)capacity);
+        if (grown != NULL) {
+            file->edits = grown;
+        }
+        int *lines = grown == NULL ? NULL : realloc(file->lines, sizeof(int) * (size_t)capacity);
+        if (lines == NULL) {
+            batch_error(batch, "out of memory\n");
+            return 1;
+        }
+        file->lines = lines;
+        file->edit_capacity = capacity;
+    }
+    /* Values may point into the line being parsed, so the edit keeps its own copy. */
+    FrontmatterEdit *edit = &file->edits[file->edit_count];
+    edit->kind = kind;
+    edit->key = key;
+    edit->value = arena_strndup(&batch->arena, value, strlen(value));
+    if (edit->value == NULL) {
+        batch_error(batch, "out of memory\n");
+        return 1;
+    }
+    if (batch_apply(batch, file, edit, 1, changed) != 0) {
+        return 1;
+    }
+    if (*changed) {
+        file->lines[file->edit_count] = batch->line;
+        file->edit_count++;
+        file->dirty = 1;
+    }
+    return 0;
+}
+
+/* The lines whose edits to the file were reported as made but are lost. */
+static void batch_report_lost(const Batch *batch, const BatchFile *file)
+{
+    int distinct = 0;
+    for (int i = 0; i < file->edit_count; i++) {
+        distinct += i == 0 || file->lines[i] != file->lines[i - 1];
+    }
+    batch_error(batch, "edits from line%s", distinct > 1 ? "s" : "");
+    for (int i = 0; i < file->edit_count; i++) {
+        if (i == 0 || file->lines[i] != file->lines[i - 1]) {
+            fprintf(stderr, "%s %d", i == 0 ? "" : ",", file->lines[i]);
+        }
+    }
+    fprintf(stderr, " were not written\n");
+}
+
+/* Writes the file back under its lock. If it changed since it was read, the batch's edits are
+ * made again, in one pass, on the current text; one that another writer already made, such as
+ * the same addition, changes nothing. */
+static int batch_write(const Batch *batch, BatchFile *file)
+{
+    char file_path[MAX_PATH];
+    snprintf(file_path, sizeof(file_path), "%s/%s.md", TICKETS_DIR, file->id);
+
+    FileLock lock;
+    if (file_lock_acquire(&lock, file_path) != 0) {
+        batch_error(batch, "cannot lock ticket file\n");
+        batch_report_lost(batch, file);
+        return 1;
+    }
+    int rc = 0;
+    int changes = 1;
+    if (!file_stamp_equal(&lock.stamp, &file->stamp)) {
+        rc = batch_read(batch, file, file_path) != 0 ||
+             batch_apply(batch, file, file->edits, file->edit_count, &changes) != 0;
+    }
+    if (rc == 0 && changes > 0 && index_cache_replace_file(file_path, file->text, file->len) != 0) {
+        batch_error(batch, "cannot update ticket file\n");
+        rc = 1;
+    }
+    file_lock_release(&lock);
+    if (rc != 0) {
+        batch_report_lost(batch, file);
+    }
+    return rc;
+}
+
+static int batch_set_status(Batch *batch, const char *query, const char *status)
+{
+    if (strcmp(status, "open") != 0 && strcmp(status, "in_progress") != 0 &&
+        strcmp(status, "closed") != 0) {
+        batch_error(batch, "invalid status '%s'. Valid statuses: open in_progress closed\n",
+                    status);
+        return 1;
+    }
+
+    int changed;
+    int slot = batch_resolve(batch, query);
+    if (slot < 0 || batch_patch(batch, slot, FRONTMATTER_SET, "status", status, &changed) != 0) {
+        return 1;
+    }
+
+    printf("Updated %s -> %s\n", batch->files[slot].id, status);
+    return 0;
+}
+
+static int batch_status(Batch *batch, char *args[], int nargs)
+{
+    (void)nargs;
+    return batch_set_status(batch, args[0], args[1]);
+}
+
+static int batch_start(Batch *batch, char *args[], int nargs)
+{
+    (void)nargs;
+    return batch_set_status(batch, args[0], "in_progress");
+}
+
+static int batch_close(Batch *batch, char *args[], int nargs)
+{
+    (void)nargs;
+    return batch_set_status(batch, args[0], "closed");
+}
+
+static int batch_reopen(Batch *batch, char *args[], int nargs)
+{
+    (void)nargs;
+    return batch_set_status(batch, args[0], "open");
+}
+
+static int batch_dep(Batch *batch, char *args[], int nargs)
+{
+    (void)nargs;
+    int slot = batch_resolve(batch, args[0]);
+    int dep_slot = slot < 0 ? -1 : batch_resolve(batch, args[1]);
+    if (dep_slot < 0) {
+        return 1;
+    }
+
+    const char *ticket_id = batch->files[slot].id;
+    const char *dep_id = batch->files[dep_slot].id;
+    int added;
+    if (batch_patch(batch, slot, FRONTMATTER_LIST_ADD, "deps", dep_id, &added) != 0) {
+        return 1;
+    }
+
+    if (!added) {
+        printf("Dependency already exists\n");
+        return 0;
+    }
+
+    printf("Added dependency: %s -> %s\n", ticket_id, dep_id);
+    return 0;
+}
+
+static int batch_undep(Batch *batch, char *args[], int nargs)
+{
+    (void)nargs;
+    int slot = batch_resolve(batch, args[0]);
+    int dep_slot = slot < 0 ? -1 : batch_resolve(batch, args[1]);
+    if (dep_slot < 0) {
+        return 1;
+    }
+
+    const char *ticket_id = batch->files[slot].id;
+    const char *dep_id = batch->files[dep_slot].id;
+    int removed;
+    if (batch_patch(batch, slot, FRONTMATTER_LIST_REMOVE, "deps", dep_id, &removed) != 0) {
+        return 1;
+    }
+
+    if (!removed) {
+        batch_error(batch, "Dependency not found\n");
+        return 1;
+    }
+
+    printf("Removed dependency: %s -/-> %s\n", ticket_id, dep_id);
+    return 0;
+}
+
+static int batch_link(Batch *batch, char *args[], int nargs)
+{
+    int slots[BATCH_MAX_ARGS];
+    for (int i = 0; i < nargs; i++) {
+        slots[i] = batch_resolve(batch, args[i]);
+        if (slots[i] < 0) {
+            return 1;
+        }
+    }
+
+    int total_added = 0;
+    for (int i = 0; i < nargs; i++) {
+        for (int j = 0; j < nargs; j++) {
+            if (i == j) {
+                continue;
+            }
+            const char *link_id = batch->files[slots[j]].id;
+            int added;
+            if (batch_patch(batch, slots[i], FRONTMATTER_LIST_ADD, "links", link_id, &added) !=
+                0) {
+                return 1;
+            }
+            total_added += added;
+        }
+    }
+
+    if (total_added == 0) {
+        printf("All links already exist\n");
+    } else {
+        printf("Added %d link(s) between %d tickets\n", total_added, nargs);
+    }
+    return 0;
+}
+
+static int batch_unlink(Batch *batch, char *args[], int nargs)
+{
+    (void)nargs;
+    int slot1 = batch_resolve(batch, args[0]);
+    int slot2 = slot1 < 0 ? -1 : batch_resolve(batch, args[1]);
+    if (slot2 < 0) {
+        return 1;
+    }
+
+    const char *id1 = batch->files[slot1].id;
+    const char *id2 = batch->files[slot2].id;
+    int removed;
+    if (batch_patch(batch, slot1, FRONTMATTER_LIST_REMOVE, "links", id2, &removed) != 0) {
+        return 1;
+    }
+
+    if (!removed) {
+        batch_error(batch, "Link not found\n");
+        return 1;
+    }
+
+    if (batch_patch(batch, slot2, FRONTMATTER_LIST_REMOVE, "links", id1, &removed) != 0) {
+        return 1;
+    }
+
+    printf("Removed link: %s <-> %s\n", id1, id2);
+    return 0;
+}
+
+typedef struct {
+    const char *name;
+    const char *usage;
+    int min_args;
+    int max_args;
+    int (*apply)(Batch *batch, char *args[], int nargs);
+} BatchOp;
+
+static const BatchOp batch_ops[] = {
+    {"status", "status <id> <status>", 2, 2, batch_status},
+    {"start", "start <id>", 1, 1, batch_start},
+    {"close", "close <id>", 1, 1, batch_close},
+    {"reopen", "reopen <id>", 1, 1, batch_reopen},
+    {"dep", "dep <id> <dep-id>", 2, 2, batch_dep},
+    {"undep", "undep <id> <dep-id>", 2, 2, batch_undep},
+    {"link", "link <id> <id> [id...]", 2, BATCH_MAX_ARGS - 1, batch_link},
+    {"unlink", "unlink <id> <id>", 2, 2, batch_unlink},
+};
+
+int batch_run(FILE *in)
+{
+    Batch batch;
+    if (batch_open(&batch) != 0) {
+        batch_free(&batch);
+        return 1;
+    }
+
+    int failed = 0;
+    char *line = NULL;
+    size_t line_capacity = 0;
+    while (getline(&line, &line_capacity, in) != -1) {
+        batch.line++;
+        snprintf(batch.context, sizeof(batch.context), "line %d: ", batch.line);
+
+        char *args[BATCH_MAX_ARGS + 1];
+        int nargs = 0;
+        for (char *word = strtok(line, " \t\r\n"); word != NULL; word = strtok(NULL, " \t\r\n")) {
+            if (nargs <= BATCH_MAX_ARGS) {
+                args[nargs] = word;
+            }
+            nargs++;
+        }
+        if (nargs == 0 || args[0][0] == '#') {
+            continue;
+        }
+
+        const BatchOp *op = NULL;
+        for (size_t i = 0; i < sizeof(batch_ops) / sizeof(batch_ops[0]); i++) {
+            if (strcmp(args[0], batch_ops[i].name) == 0) {
+                op = &batch_ops[i];
+                break;
+            }
+        }
+        if (op == NULL) {
+            batch_error(&batch, "unknown operation '%s'\n", args[0]);
+            failed = 1;
+            continue;
+        }
+        if (nargs - 1 < op->min_args || nargs - 1 > op->max_args) {
+            batch_error(&batch, "usage: %s\n", op->usage);
+            failed = 1;
+            continue;
+        }
+
+        if (op->apply(&batch, &args[1], nargs - 1) != 0) {
+            failed = 1;
+        }
+    }
+    free(line);
+
+    for (int i = 0; i < batch.count; i++) {
+        if (batch.files[i].dirty) {
+            snprintf(batch.context, sizeof(batch.context), "%s: ", batch.files[i].id);
+            failed |= batch_write(&batch, &batch.files[i]);
+        }
+    }
+
+    batch_free(&batch);
+    return failed;
+}
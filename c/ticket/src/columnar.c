@@ -0,0 +1,261 @@
+#define _DEFAULT_SOURCE
+
+#include "columnar.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* The distinct names of a one-byte code column in first-use order, and each ticket's code. */
+typedef struct {
+    const char *names[COLUMNAR_MAX_NAMES];
+    uint32_t count;
+    uint8_t *codes;
+} ColumnarCodes;
+
+/* The numbering of one snapshot: ids without a ticket in first-reference order, and the
+ * status and type codes. */
+typedef struct {
+    const TicketStore *store;
+    IdIndex extra_numbers;
+    const char **extra;
+    uint32_t extra_count;
+    uint32_t extra_capacity;
+    ColumnarCodes statuses;
+    ColumnarCodes types;
+} ColumnarIds;
+
+static void columnar_ids_free(ColumnarIds *ids)
+{
+    id_index_free(&ids->extra_numbers);
+    free(ids->extra);
+    free(ids->statuses.codes);
+    free(ids->types.codes);
+}
+
+/* Returns the number of an interned id, numbering it first if it has no ticket and has not
+ * been seen; COLUMNAR_NONE when out of memory. */
+static uint32_t id_number(ColumnarIds *ids, const char *id)
+{
+    int ticket = find_ticket_interned(ids->store, id);
+    if (ticket >= 0) {
+        return (uint32_t)ticket;
+    }
+    uint32_t first_extra = (uint32_t)ids->store->count;
+    int extra = id_index_get(&ids->extra_numbers, id);
+    if (extra >= 0) {
+        return first_extra + (uint32_t)extra;
+    }
+
+    if (ids->extra_count == ids->extra_capacity) {
+        uint32_t capacity = ids->extra_capacity ? ids->extra_capacity * 2 : 64;
+        const char **grown = realloc(ids->extra, sizeof(char *) * capacity);
+        if (grown == NULL) {
+            return COLUMNAR_NONE;
+        }
+        ids->extra = grown;
+        ids->extra_capacity = capacity;
+    }
+    if (id_index_put(&ids->extra_numbers, id, (int)ids->extra_count) != 0) {
+        return COLUMNAR_NONE;
+    }
+    ids->extra[ids->extra_count] = id;
+    return first_extra + ids->extra_count++;
+}
+
+static int name_code(ColumnarCodes *codes, int ticket, const char *name)
+{
+    uint32_t i = 0;
+    while (i < codes->count && strcmp(codes->names[i], name) != 0) {
+        i++;
+    }
+    if (i == COLUMNAR_MAX_NAMES) {
+        return 1;
+    }
+    if (i == codes->count) {
+        codes->names[codes->count++] = name;
+    }
+    codes->codes[ticket] = (uint8_t)i;
+    return 0;
+}
+
+static uint64_t names_size(const ColumnarCodes *codes)
+{
+    uint64_t size = 0;
+    for (uint32_t i = 0; i < codes->count; i++) {
+        size += strlen(codes->names[i]);
+    }
+    return size;
+}
+
+static int number_list(ColumnarIds *ids, const char **list, int count, uint64_t *total)
+{
+    for (int i = 0; i < count; i++) {
+        if (id_number(ids, list[i]) == COLUMNAR_NONE) {
+            return 1;
+        }
+    }
+    *total += (uint64_t)count;
+    return 0;
+}
+
+/* First pass: numbers every id, status and type, and sizes the columns. */
+static int number_ids(ColumnarIds *ids, ColumnarHeader *header)
+{
+    const TicketStore *store = ids->store;
+    ids->statuses.codes = malloc((size_t)store->count + 1);
+    ids->types.codes = malloc((size_t)store->count + 1);
+    if (ids->statuses.codes == NULL || ids->types.codes == NULL) {
+        return 1;
+    }
+
+    uint64_t deps = 0;
+    uint64_t links = 0;
+    uint64_t strings = 0;
+    for (int i = 0; i < store->count; i++) {
+        const Ticket *t = store->tickets[i];
+        if (name_code(&ids->statuses, i, t->status) != 0 ||
+            name_code(&ids->types, i, t->type) != 0 ||
+            (t->parent[0] != '\0' && id_number(ids, t->parent) == COLUMNAR_NONE) ||
+            number_list(ids, t->deps, t->dep_count, &deps) != 0 ||
+            number_list(ids, t->links, t->link_count, &links) != 0) {
+            return 1;
+        }
+        strings += strlen(t->id) + strlen(t->title) + strlen(t->assignee);
+    }
+    for (uint32_t i = 0; i < ids->extra_count; i++) {
+        strings += strlen(ids->extra[i]);
+    }
+    strings += names_size(&ids->statuses) + names_size(&ids->types);
+    if (strings > UINT32_MAX || deps > UINT32_MAX || links > UINT32_MAX) {
+        return 1;
+    }
+
+    memcpy(header->magic, COLUMNAR_MAGIC, sizeof(header->magic));
+    header->version = COLUMNAR_VERSION;
+    header->byte_order = COLUMNAR_BYTE_ORDER;
+    header->ticket_count = (uint32_t)store->count;
+    header->id_count = (uint32_t)store->count + ids->extra_count;
+    header->status_count = ids->statuses.count;
+    header->type_count = ids->types.count;
+    header->dep_count = (uint32_t)deps;
+    header->link_count = (uint32_t)links;
+    header->strings_size = (uint32_t)strings;
+    return 0;
+}
+
+static void write_u32(OutBuf *out, uint32_t value)
+{
+    out_buf_write(out, (const char *)&value, sizeof(value));
+}
+
+/* Moves *offset past the string and writes where it ends. */
+static void write_end(OutBuf *out, const char *str, uint32_t *offset)
+{
+    *offset += (uint32_t)strlen(str);
+    write_u32(out, *offset);
+}
+
+static void write_names_end(OutBuf *out, const ColumnarCodes *codes, uint32_t *offset)
+{
+    for (uint32_t i = 0; i < codes->count; i++) {
+        write_end(out, codes->names[i], offset);
+    }
+}
+
+static void write_id_lists(OutBuf *out, ColumnarIds *ids, int deps)
+{
+    const TicketStore *store = ids->store;
+    uint32_t start = 0;
+    write_u32(out, start);
+    for (int i = 0; i < store->count; i++) {
+        start += (uint32_t)(deps ? store->tickets[i]->dep_count : store->tickets[i]->link_count);
+        write_u32(out, start);
+    }
+    for (int i = 0; i < store->count; i++) {
+        const Ticket *t = store->tickets[i];
+        const char **list = deps ? t->deps : t->links;
+        int count = deps ? t->dep_count : t->link_count;
+        for (int j = 0; j < count; j++) {
+            write_u32(out, id_number(ids, list[j]));
+        }
+    }
+}
+
+/* Second pass: every id is numbered, so id_number only looks numbers up. */
+static void write_columns(OutBuf *out, ColumnarIds *ids, const ColumnarHeader *header)
+{
+    const TicketStore *store = ids->store;
+    out_buf_write(out, (const char *)header, sizeof(*header));
+
+    /* The strings are stored as the offsets list them: ids, titles, assignees, then status and
+     * type names. */
+    uint32_t offset = 0;
+    write_u32(out, offset);
+    for (int i = 0; i < store->count; i++) {
+        write_end(out, store->tickets[i]->id, &offset);
+    }
+    for (uint32_t i = 0; i < ids->extra_count; i++) {
+        write_end(out, ids->extra[i], &offset);
+    }
+    write_u32(out, offset);
+    for (int i = 0; i < store->count; i++) {
+        write_end(out, store->tickets[i]->title, &offset);
+    }
+    write_u32(out, offset);
+    for (int i = 0; i < store->count; i++) {
+        write_end(out, store->tickets[i]->assignee, &offset);
+    }
+    write_u32(out, offset);
+    write_names_end(out, &ids->statuses, &offset);
+    write_u32(out, offset);
+    write_names_end(out, &ids->types, &offset);
+
+    for (int i = 0; i < store->count; i++) {
+        int32_t priority = store->tickets[i]->priority;
+        out_buf_write(out, (const char *)&priority, sizeof(priority));
+    }
+    for (int i = 0; i < store->count; i++) {
+        const char *parent = store->tickets[i]->parent;
+        write_u32(out, parent[0] != '\0' ? id_number(ids, parent) : COLUMNAR_NONE);
+    }
+    write_id_lists(out, ids, 1);
+    write_id_lists(out, ids, 0);
+    out_buf_write(out, (const char *)ids->statuses.codes, (size_t)store->count);
+    out_buf_write(out, (const char *)ids->types.codes, (size_t)store->count);
+
+    for (int i = 0; i < store->count; i++) {
+        out_buf_puts(out, store->tickets[i]->id);
+    }
+    for (uint32_t i = 0; i < ids->extra_count; i++) {
+        out_buf_puts(out, ids->extra[i]);
+    }
+    for (int i = 0; i < store->count; i++) {
+        out_buf_puts(out, store->tickets[i]->title);
+    }
+    for (int i = 0; i < store->count; i++) {
+        out_buf_puts(out, store->tickets[i]->assignee);
+    }
+    for (uint32_t i = 0; i < ids->statuses.count; i++) {
+        out_buf_puts(out, ids->statuses.names[i]);
+    }
+    for (uint32_t i = 0; i < ids->types.count; i++) {
+        out_buf_puts(out, ids->types.names[i]);
+    }
+}
+
+int columnar_write(const TicketStore *store, OutBuf *out)
+{
+    ColumnarIds ids;
+    memset(&ids, 0, sizeof(ids));
+    ids.store = store;
+    id_index_init(&ids.extra_numbers);
+
+    ColumnarHeader header;
+    memset(&header, 0, sizeof(header));
+    int rc = number_ids(&ids, &header);
+    if (rc == 0) {
+        write_columns(out, &ids, &header);
+    }
+    columnar_ids_free(&ids);
+    return rc;
+}
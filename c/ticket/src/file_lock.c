@@ -0,0 +1,44 @@
+#define _DEFAULT_SOURCE
+
+#include "file_lock.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int file_lock_acquire(FileLock *lock, const char *path)
+{
+    for (;;) {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return 1;
+        }
+        int rc;
+        do {
+            rc = flock(fd, LOCK_EX);
+        } while (rc != 0 && errno == EINTR);
+        struct stat locked, current;
+        if (rc != 0 || fstat(fd, &locked) != 0) {
+            close(fd);
+            return 1;
+        }
+        if (stat(path, &current) == 0 && current.st_ino == locked.st_ino &&
+            current.st_dev == locked.st_dev) {
+            lock->fd = fd;
+            file_stamp_from_stat(&lock->stamp, &locked);
+            return 0;
+        }
+        /* Replaced or removed while we waited; lock whatever the path names now. */
+        close(fd);
+    }
+}
+
+void file_lock_release(FileLock *lock)
+{
+    if (lock->fd >= 0) {
+        close(lock->fd);
+        lock->fd = -1;
+    }
+}
@@ -0,0 +1,294 @@
+#define _DEFAULT_SOURCE
+
+#include "frontmatter.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/* Below this size one read() beats setting up and tearing down a mapping. */
+#define TICKET_FILE_MMAP_MIN (64 * 1024)
+
+static size_t line_end(const TicketFile *file, size_t pos)
+{
+    const char *nl = memchr(file->data + pos, '\n', file->size - pos);
+    return nl == NULL ? file->size : (size_t)(nl - file->data);
+}
+
+static size_t next_line(const TicketFile *file, size_t end)
+{
+    return end < file->size ? end + 1 : end;
+}
+
+static int is_delimiter(const TicketFile *file, size_t pos, size_t end)
+{
+    return end - pos == 3 && memcmp(file->data + pos, "---", 3) == 0;
+}
+
+static void locate_frontmatter(TicketFile *file)
+{
+    file->fm_open = file->fm_start = file->fm_end = file->body_start = file->size;
+
+    size_t pos = 0;
+    while (pos < file->size) {
+        size_t end = line_end(file, pos);
+        if (is_delimiter(file, pos, end)) {
+            file->fm_open = pos;
+            file->fm_start = next_line(file, end);
+            break;
+        }
+        pos = next_line(file, end);
+    }
+
+    pos = file->fm_start;
+    while (pos < file->size) {
+        size_t end = line_end(file, pos);
+        if (is_delimiter(file, pos, end)) {
+            file->fm_end = pos;
+            file->body_start = next_line(file, end);
+            return;
+        }
+        pos = next_line(file, end);
+    }
+    file->fm_end = file->size;
+}
+
+static int read_small_file(TicketFile *file, int fd, size_t size)
+{
+    char *buffer = malloc(size);
+    if (buffer == NULL) {
+        return 1;
+    }
+    size_t total = 0;
+    while (total < size) {
+        ssize_t n = read(fd, buffer + total, size - total);
+        if (n < 0) {
+            free(buffer);
+            return 1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+    file->buffer = buffer;
+    file->data = buffer;
+    file->size = total;
+    return 0;
+}
+
+int ticket_file_open(TicketFile *file, const char *path)
+{
+    memset(file, 0, sizeof(*file));
+    file->data = "";
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 1;
+    }
+
+    int rc = 0;
+    size_t size = (size_t)st.st_size;
+    TRACE_COUNT(TRACE_FILES_OPENED, 1);
+    TRACE_COUNT(TRACE_BYTES_READ, size);
+    if (size > 0 && size <= TICKET_FILE_MMAP_MIN) {
+        rc = read_small_file(file, fd, size);
+    } else if (size > 0) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            rc = 1;
+        } else {
+            file->map = map;
+            file->data = map;
+            file->size = size;
+        }
+    }
+    close(fd);
+    if (rc != 0) {
+        return 1;
+    }
+
+    locate_frontmatter(file);
+    return 0;
+}
+
+void ticket_file_view(TicketFile *file, const char *data, size_t size)
+{
+    memset(file, 0, sizeof(*file));
+    file->data = data;
+    file->size = size;
+    locate_frontmatter(file);
+}
+
+void ticket_file_close(TicketFile *file)
+{
+    if (file->map != NULL) {
+        munmap(file->map, file->size);
+    }
+    free(file->buffer);
+    memset(file, 0, sizeof(*file));
+}
+
+int frontmatter_next(const TicketFile *file, size_t *cursor, StrView *key, StrView *value)
+{
+    size_t pos = *cursor < file->fm_start ? file->fm_start : *cursor;
+    while (pos < file->fm_end) {
+        size_t end = line_end(file, pos);
+        const char *line = file->data + pos;
+        const char *colon = memchr(line, ':', end - pos);
+        pos = next_line(file, end);
+        if (colon == NULL) {
+            continue;
+        }
+
+        const char *val = colon + 1;
+        const char *val_end = file->data + end;
+        while (val < val_end && *val == ' ')
+            val++;
+
+        key->ptr = line;
+        key->len = (size_t)(colon - line);
+        value->ptr = val;
+        value->len = (size_t)(val_end - val);
+        *cursor = pos;
+        return 1;
+    }
+    *cursor = pos;
+    return 0;
+}
+
+int frontmatter_get(const TicketFile *file, const char *key, StrView *value)
+{
+    size_t cursor = 0;
+    StrView k;
+    while (frontmatter_next(file, &cursor, &k, value)) {
+        if (strview_eq(k, key)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int find_title(const TicketFile *file, size_t pos, size_t limit, StrView *title)
+{
+    while (pos < limit) {
+        size_t end = line_end(file, pos);
+        if (end - pos >= 2 && file->data[pos] == '#' && file->data[pos + 1] == ' ') {
+            title->ptr = file->data + pos + 2;
+            title->len = end - pos - 2;
+            return 1;
+        }
+        pos = next_line(file, end);
+    }
+    return 0;
+}
+
+StrView ticket_file_title(const TicketFile *file)
+{
+    StrView title = {"", 0};
+    if (!find_title(file, 0, file->fm_open, &title)) {
+        find_title(file, file->body_start, file->size, &title);
+    }
+    return title;
+}
+
+StrView frontmatter_list(StrView value)
+{
+    StrView list = {NULL, 0};
+    const char *open = memchr(value.ptr, '[', value.len);
+    if (open == NULL) {
+        return list;
+    }
+    open++;
+    const char *close = memchr(open, ']', value.len - (size_t)(open - value.ptr));
+    if (close == NULL) {
+        return list;
+    }
+    list.ptr = open;
+    list.len = (size_t)(close - open);
+    return list;
+}
+
+int frontmatter_list_next(StrView *list, StrView *item)
+{
+    while (list->len > 0) {
+        const char *comma = memchr(list->ptr, ',', list->len);
+        size_t len = comma == NULL ? list->len : (size_t)(comma - list->ptr);
+        const char *start = list->ptr;
+
+        list->ptr += comma == NULL ? len : len + 1;
+        list->len -= comma == NULL ? len : len + 1;
+
+        while (len > 0 && *start == ' ') {
+            start++;
+            len--;
+        }
+        while (len > 0 && start[len - 1] == ' ') {
+            len--;
+        }
+        if (len > 0) {
+            item->ptr = start;
+            item->len = len;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int strview_eq(StrView view, const char *str)
+{
+    size_t len = strlen(str);
+    return view.len == len && memcmp(view.ptr, str, len) == 0;
+}
+
+StrView strview_token(StrView view)
+{
+    size_t start = 0;
+    while (start < view.len && isspace((unsigned char)view.ptr[start])) {
+        start++;
+    }
+    size_t end = start;
+    while (end < view.len && !isspace((unsigned char)view.ptr[end])) {
+        end++;
+    }
+    StrView token = {view.ptr + start, end - start};
+    return token;
+}
+
+int strview_to_int(StrView view, int *out)
+{
+    StrView token = strview_token(view);
+    size_t i = 0;
+    int negative = 0;
+    if (i < token.len && (token.ptr[i] == '-' || token.ptr[i] == '+')) {
+        negative = token.ptr[i] == '-';
+        i++;
+    }
+    if (i == token.len || !isdigit((unsigned char)token.ptr[i])) {
+        return 1;
+    }
+    long long value = 0;
+    while (i < token.len && isdigit((unsigned char)token.ptr[i])) {
+        if (value < INT_MAX) {
+            value = value * 10 + (token.ptr[i] - '0');
+        }
+        i++;
+    }
+    if (value > INT_MAX) {
+        value = INT_MAX;
+    }
+    *out = negative ? (int)-value : (int)value;
+    return 0;
+}
@@ -0,0 +1,215 @@
+#define _DEFAULT_SOURCE
+
+#include "frontmatter_patch.h"
+
+#include <string.h>
+
+static size_t line_end(const TicketFile *file, size_t pos)
+{
+    const char *nl = memchr(file->data + pos, '\n', file->size - pos);
+    return nl == NULL ? file->size : (size_t)(nl - file->data);
+}
+
+static size_t next_line(const TicketFile *file, size_t end)
+{
+    return end < file->size ? end + 1 : end;
+}
+
+/* Splits a frontmatter line as frontmatter_next does; key.ptr is NULL if it has no colon. */
+static StrView split_line(const TicketFile *file, size_t pos, size_t end, StrView *value)
+{
+    StrView key = {NULL, 0};
+    const char *line = file->data + pos;
+    const char *colon = memchr(line, ':', end - pos);
+    if (colon == NULL) {
+        return key;
+    }
+    key.ptr = line;
+    key.len = (size_t)(colon - line);
+
+    const char *val = colon + 1;
+    const char *val_end = file->data + end;
+    while (val < val_end && *val == ' ')
+        val++;
+    value->ptr = val;
+    value->len = (size_t)(val_end - val);
+    return key;
+}
+
+static int same_key(StrView a, StrView b)
+{
+    return a.len == b.len && memcmp(a.ptr, b.ptr, a.len) == 0;
+}
+
+/* Whether a frontmatter line before limit has the key. */
+static int key_seen(const TicketFile *file, StrView key, size_t limit)
+{
+    size_t pos = file->fm_start;
+    while (pos < limit) {
+        size_t end = line_end(file, pos);
+        StrView value;
+        StrView line_key = split_line(file, pos, end, &value);
+        if (line_key.ptr != NULL && same_key(line_key, key)) {
+            return 1;
+        }
+        pos = next_line(file, end);
+    }
+    return 0;
+}
+
+static int list_contains(StrView list, const char *id)
+{
+    StrView item;
+    while (frontmatter_list_next(&list, &item)) {
+        if (strview_eq(item, id)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Writes the value the edit makes of value to out and returns 1, or returns 0 if the edit
+ * leaves it as it is. */
+static int patch_value(StrView value, const FrontmatterEdit *edit, OutBuf *out)
+{
+    if (edit->kind == FRONTMATTER_SET) {
+        if (strview_eq(value, edit->value)) {
+            return 0;
+        }
+        out_buf_puts(out, edit->value);
+        return 1;
+    }
+
+    StrView list = frontmatter_list(value);
+    if (list.ptr == NULL && value.len > 0) {
+        return 0;
+    }
+    int listed = list.ptr != NULL && list_contains(list, edit->value);
+    if (edit->kind == FRONTMATTER_LIST_ADD ? listed : !listed) {
+        return 0;
+    }
+
+    int kept = 0;
+    StrView item;
+    out_buf_putc(out, '[');
+    while (list.ptr != NULL && frontmatter_list_next(&list, &item)) {
+        if (edit->kind == FRONTMATTER_LIST_REMOVE && strview_eq(item, edit->value)) {
+            continue;
+        }
+        if (kept++ > 0) {
+            out_buf_puts(out, ", ");
+        }
+        out_buf_write(out, item.ptr, item.len);
+    }
+    if (edit->kind == FRONTMATTER_LIST_ADD) {
+        if (kept > 0) {
+            out_buf_puts(out, ", ");
+        }
+        out_buf_puts(out, edit->value);
+    }
+    out_buf_putc(out, ']');
+    return 1;
+}
+
+/* Applies the key's edits to value in turn, alternating between the two scratch buffers so
+ * each edit reads the previous result. Returns how many changed it; *value is the result. */
+static int patch_key(StrView key, StrView *value, const FrontmatterEdit *edits, int count,
+                     OutBuf scratch[2])
+{
+    int changes = 0;
+    int next = 0;
+    for (int i = 0; i < count; i++) {
+        if (!strview_eq(key, edits[i].key)) {
+            continue;
+        }
+        OutBuf *dst = &scratch[next];
+        dst->len = 0;
+        if (patch_value(*value, &edits[i], dst)) {
+            value->ptr = dst->data;
+            value->len = dst->len;
+            next = !next;
+            changes++;
+        }
+    }
+    return changes;
+}
+
+static void write_line(OutBuf *out, StrView key, StrView value)
+{
+    out_buf_write(out, key.ptr, key.len);
+    out_buf_puts(out, ": ");
+    out_buf_write(out, value.ptr, value.len);
+    out_buf_putc(out, '\n');
+}
+
+static int first_edit_of_key(const FrontmatterEdit *edits, int i)
+{
+    for (int j = 0; j < i; j++) {
+        if (strcmp(edits[j].key, edits[i].key) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int frontmatter_patch(const TicketFile *file, const FrontmatterEdit *edits, int count,
+                      OutBuf *out)
+{
+    if (file->fm_open == file->size) {
+        out_buf_write(out, file->data, file->size);
+        return out->failed ? -1 : 0;
+    }
+
+    OutBuf scratch[2];
+    if (out_buf_init_memory(&scratch[0]) != 0) {
+        return -1;
+    }
+    if (out_buf_init_memory(&scratch[1]) != 0) {
+        out_buf_close(&scratch[0]);
+        return -1;
+    }
+
+    /* Lines up to `copied` are in out; unchanged runs are written when the next patched line,
+     * or the end of the frontmatter, is reached. */
+    int changes = 0;
+    size_t copied = 0;
+    size_t pos = file->fm_start;
+    while (pos < file->fm_end) {
+        size_t end = line_end(file, pos);
+        StrView value;
+        StrView key = split_line(file, pos, end, &value);
+        if (key.ptr != NULL) {
+            int changed = patch_key(key, &value, edits, count, scratch);
+            if (changed > 0 && !key_seen(file, key, pos)) {
+                out_buf_write(out, file->data + copied, pos - copied);
+                write_line(out, key, value);
+                copied = next_line(file, end);
+                changes += changed;
+            }
+        }
+        pos = next_line(file, end);
+    }
+    out_buf_write(out, file->data + copied, file->fm_end - copied);
+
+    for (int i = 0; i < count; i++) {
+        StrView key = {edits[i].key, strlen(edits[i].key)};
+        if (!first_edit_of_key(edits, i) || key_seen(file, key, file->fm_end)) {
+            continue;
+        }
+        StrView value = {"", 0};
+        int changed = patch_key(key, &value, edits, count, scratch);
+        if (changed > 0) {
+            if (out->len > 0 && out->data[out->len - 1] != '\n') {
+                out_buf_putc(out, '\n');
+            }
+            write_line(out, key, value);
+            changes += changed;
+        }
+    }
+    out_buf_write(out, file->data + file->fm_end, file->size - file->fm_end);
+
+    int failed = scratch[0].failed || scratch[1].failed || out->failed;
+    out_buf_close(&scratch[0]);
+    out_buf_close(&scratch[1]);
+    return failed ? -1 : changes;
+}
@@ -0,0 +1,327 @@
+#include "graph.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+static int status_is_active(const char *status)
+{
+    return strcmp(status, "open") == 0 || strcmp(status, "in_progress") == 0;
+}
+
+/* Fills dependent_start/dependents, skipping repeated deps so each dependent appears once. */
+static int build_dependents(TicketGraph *graph)
+{
+    int count = graph->count;
+    int *last_source = malloc(sizeof(int) * (size_t)(count + 1));
+    if (last_source == NULL) {
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        last_source[i] = -1;
+    }
+    memset(graph->dependent_start, 0, sizeof(int) * (size_t)(count + 1));
+    for (int i = 0; i < count; i++) {
+        for (int e = graph->dep_start[i]; e < graph->dep_start[i + 1]; e++) {
+            int target = graph->dep_targets[e];
+            if (target >= 0 && last_source[target] != i) {
+                last_source[target] = i;
+                graph->dependent_start[target + 1]++;
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        graph->dependent_start[i + 1] += graph->dependent_start[i];
+    }
+
+    graph->dependents = malloc(sizeof(int) * (size_t)(graph->dependent_start[count] + 1));
+    if (graph->dependents == NULL) {
+        free(last_source);
+        return 1;
+    }
+
+    /* Reuse the scratch array as each target's fill cursor. Sources arrive in ascending order,
+     * so a target whose last entry is already i lists this ticket. */
+    int *fill = last_source;
+    memcpy(fill, graph->dependent_start, sizeof(int) * (size_t)count);
+    for (int i = 0; i < count; i++) {
+        for (int e = graph->dep_start[i]; e < graph->dep_start[i + 1]; e++) {
+            int target = graph->dep_targets[e];
+            if (target >= 0 && (fill[target] == graph->dependent_start[target] ||
+                                graph->dependents[fill[target] - 1] != i)) {
+                graph->dependents[fill[target]++] = i;
+            }
+        }
+    }
+
+    free(last_source);
+    return 0;
+}
+
+static int build_children(TicketGraph *graph, const TicketStore *store)
+{
+    int count = graph->count;
+    int *parents = malloc(sizeof(int) * (size_t)(count + 1));
+    if (parents == NULL) {
+        return 1;
+    }
+
+    memset(graph->child_start, 0, sizeof(int) * (size_t)(count + 1));
+    for (int i = 0; i < count; i++) {
+        parents[i] = find_ticket_interned(store, store->tickets[i]->parent);
+        if (parents[i] >= 0) {
+            graph->child_start[parents[i] + 1]++;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        graph->child_start[i + 1] += graph->child_start[i];
+    }
+
+    graph->children = malloc(sizeof(int) * (size_t)(graph->child_start[count] + 1));
+    int *fill = malloc(sizeof(int) * (size_t)(count + 1));
+    if (graph->children == NULL || fill == NULL) {
+        free(fill);
+        free(parents);
+        return 1;
+    }
+    memcpy(fill, graph->child_start, sizeof(int) * (size_t)count);
+    for (int i = 0; i < count; i++) {
+        if (parents[i] >= 0) {
+            graph->children[fill[parents[i]]++] = i;
+        }
+    }
+
+    free(fill);
+    free(parents);
+    return 0;
+}
+
+int ticket_graph_build(TicketGraph *graph, const TicketStore *store)
+{
+    TRACE_BEGIN(start);
+    memset(graph, 0, sizeof(*graph));
+    int count = store->count;
+    graph->count = count;
+
+    size_t edge_count = 0;
+    for (int i = 0; i < count; i++) {
+        edge_count += (size_t)store->tickets[i]->dep_count;
+    }
+
+    graph->dep_start = malloc(sizeof(int) * (size_t)(count + 1));
+    graph->dep_targets = malloc(sizeof(int) * (edge_count + 1));
+    graph->dependent_start = malloc(sizeof(int) * (size_t)(count + 1));
+    graph->child_start = malloc(sizeof(int) * (size_t)(count + 1));
+    graph->unresolved = malloc(sizeof(int) * (size_t)(count + 1));
+    graph->closed = malloc((size_t)count + 1);
+    if (graph->dep_start == NULL || graph->dep_targets == NULL ||
+        graph->dependent_start == NULL || graph->child_start == NULL ||
+        graph->unresolved == NULL || graph->closed == NULL) {
+        ticket_graph_free(graph);
+        return 1;
+    }
+
+    int edge = 0;
+    for (int i = 0; i < count; i++) {
+        const Ticket *t = store->tickets[i];
+        graph->dep_start[i] = edge;
+        graph->closed[i] = strcmp(t->status, "closed") == 0;
+        for (int j = 0; j < t->dep_count; j++) {
+            graph->dep_targets[edge++] = find_ticket_interned(store, t->deps[j]);
+        }
+    }
+    graph->dep_start[count] = edge;
+
+    if (build_dependents(graph) != 0 || build_children(graph, store) != 0) {
+        ticket_graph_free(graph);
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int unresolved = 0;
+        for (int e = graph->dep_start[i]; e < graph->dep_start[i + 1]; e++) {
+            unresolved += ticket_graph_edge_unresolved(graph, e);
+        }
+        graph->unresolved[i] = unresolved;
+    }
+    TRACE_END(TRACE_GRAPH, start);
+    return 0;
+}
+
+void ticket_graph_free(TicketGraph *graph)
+{
+    free(graph->dep_start);
+    free(graph->dep_targets);
+    free(graph->dependent_start);
+    free(graph->dependents);
+    free(graph->child_start);
+    free(graph->children);
+    free(graph->unresolved);
+    free(graph->closed);
+    memset(graph, 0, sizeof(*graph));
+}
+
+void ticket_graph_set_status(TicketGraph *graph, TicketStore *store, int ticket,
+                             const char *status)
+{
+    Ticket *t = store->tickets[ticket];
+    const char *interned = intern(&store->strings, status, strlen(status));
+    if (interned != NULL) {
+        t->status = interned;
+    }
+
+    unsigned char closed = strcmp(t->status, "closed") == 0;
+    if (closed == graph->closed[ticket]) {
+        return;
+    }
+    graph->closed[ticket] = closed;
+
+    for (int d = graph->dependent_start[ticket]; d < graph->dependent_start[ticket + 1]; d++) {
+        int dependent = graph->dependents[d];
+        for (int e = graph->dep_start[dependent]; e < graph->dep_start[dependent + 1]; e++) {
+            if (graph->dep_targets[e] == ticket) {
+                graph->unresolved[dependent] += closed ? -1 : 1;
+            }
+        }
+    }
+}
+
+int ticket_graph_edge_unresolved(const TicketGraph *graph, int edge)
+{
+    int target = graph->dep_targets[edge];
+    return target < 0 || !graph->closed[target];
+}
+
+int ticket_graph_is_ready(const TicketGraph *graph, const TicketStore *store, int ticket)
+{
+    return graph->unresolved[ticket] == 0 && status_is_active(store->tickets[ticket]->status);
+}
+
+int ticket_graph_is_blocked(const TicketGraph *graph, const TicketStore *store, int ticket)
+{
+    return graph->unresolved[ticket] > 0 && status_is_active(store->tickets[ticket]->status);
+}
+
+static int bit_test(const uint64_t *bits, size_t i)
+{
+    return (bits[i / 64] >> (i % 64)) & 1;
+}
+
+static void bit_set(uint64_t *bits, size_t i)
+{
+    bits[i / 64] |= (uint64_t)1 << (i % 64);
+}
+
+static void bit_clear(uint64_t *bits, size_t i)
+{
+    bits[i / 64] &= ~((uint64_t)1 << (i % 64));
+}
+
+/* Iterative DFS from root. Fills order with the reachable tickets in post-order and marks
+ * in back_edges every edge that points at a ticket still on the DFS stack. */
+static int dfs_post_order(const TicketGraph *graph, int root, int *order, int *order_count,
+                          uint64_t *back_edges)
+{
+    int count = graph->count;
+    size_t words = (size_t)count / 64 + 1;
+    int *stack = malloc(sizeof(int) * 2 * (size_t)(count + 1));
+    uint64_t *visited = calloc(words * 2, sizeof(uint64_t));
+    if (stack == NULL || visited == NULL) {
+        free(stack);
+        free(visited);
+        return 1;
+    }
+    int *cursor = stack + count + 1;
+    uint64_t *on_stack = visited + words;
+
+    int n = 0;
+    int depth = 1;
+    stack[0] = root;
+    cursor[0] = graph->dep_start[root];
+    bit_set(visited, (size_t)root);
+    bit_set(on_stack, (size_t)root);
+    while (depth > 0) {
+        int u = stack[depth - 1];
+        int e = cursor[depth - 1];
+        if (e == graph->dep_start[u + 1]) {
+            bit_clear(on_stack, (size_t)u);
+            order[n++] = u;
+            depth--;
+            continue;
+        }
+        cursor[depth - 1]++;
+
+        int v = graph->dep_targets[e];
+        if (v < 0) {
+            continue;
+        }
+        if (bit_test(on_stack, (size_t)v)) {
+            bit_set(back_edges, (size_t)e);
+        } else if (!bit_test(visited, (size_t)v)) {
+            bit_set(visited, (size_t)v);
+            bit_set(on_stack, (size_t)v);
+            stack[depth] = v;
+            cursor[depth] = graph->dep_start[v];
+            depth++;
+        }
+    }
+
+    *order_count = n;
+    free(stack);
+    free(visited);
+    return 0;
+}
+
+int ticket_graph_tree_depths(const TicketGraph *graph, int root, int *max_depth,
+                             int *subtree_depth)
+{
+    TRACE_BEGIN(start);
+    int count = graph->count;
+    int *order = malloc(sizeof(int) * (size_t)(count + 1));
+    uint64_t *back_edges = calloc((size_t)graph->dep_start[count] / 64 + 1, sizeof(uint64_t));
+    int order_count = 0;
+    if (order == NULL || back_edges == NULL ||
+        dfs_post_order(graph, root, order, &order_count, back_edges) != 0) {
+        free(order);
+        free(back_edges);
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        max_depth[i] = -1;
+        subtree_depth[i] = -1;
+    }
+
+    /* Reverse post-order is a topological order of the remaining DAG, so every ticket's
+     * longest path is final before its own edges are relaxed. */
+    max_depth[root] = 0;
+    for (int k = order_count - 1; k >= 0; k--) {
+        int u = order[k];
+        for (int e = graph->dep_start[u]; e < graph->dep_start[u + 1]; e++) {
+            int v = graph->dep_targets[e];
+            if (v >= 0 && !bit_test(back_edges, (size_t)e) && max_depth[u] + 1 > max_depth[v]) {
+                max_depth[v] = max_depth[u] + 1;
+            }
+        }
+    }
+
+    for (int k = 0; k < order_count; k++) {
+        int u = order[k];
+        int deepest = max_depth[u];
+        for (int e = graph->dep_start[u]; e < graph->dep_start[u + 1]; e++) {
+            int v = graph->dep_targets[e];
+            if (v >= 0 && !bit_test(back_edges, (size_t)e) && subtree_depth[v] > deepest) {
+                deepest = subtree_depth[v];
+            }
+        }
+        subtree_depth[u] = deepest;
+    }
+
+    free(order);
+    free(back_edges);
+    TRACE_END(TRACE_GRAPH, start);
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "id_index.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define ID_INDEX_MIN_CAPACITY 256
+
+void id_index_init(IdIndex *index)
+{
+    index->keys = NULL;
+    index->values = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
+
+void id_index_free(IdIndex *index)
+{
+    free(index->keys);
+    free(index->values);
+    id_index_init(index);
+}
+
+static size_t id_index_slot(const IdIndex *index, const char *key)
+{
+    uint64_t hash = (uint64_t)(uintptr_t)key * 0x9e3779b97f4a7c15ull;
+    size_t mask = index->capacity - 1;
+    size_t pos = (size_t)(hash >> 32) & mask;
+    while (index->keys[pos] != NULL && index->keys[pos] != key) {
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+static int id_index_grow(IdIndex *index)
+{
+    IdIndex grown;
+    grown.capacity = index->capacity ? index->capacity * 2 : ID_INDEX_MIN_CAPACITY;
+    grown.count = index->count;
+    grown.keys = calloc(grown.capacity, sizeof(const char *));
+    grown.values = malloc(grown.capacity * sizeof(int));
+    if (grown.keys == NULL || grown.values == NULL) {
+        free(grown.keys);
+        free(grown.values);
+        return 1;
+    }
+
+    for (size_t i = 0; i < index->capacity; i++) {
+        if (index->keys[i] != NULL) {
+            size_t pos = id_index_slot(&grown, index->keys[i]);
+            grown.keys[pos] = index->keys[i];
+            grown.values[pos] = index->values[i];
+        }
+    }
+
+    free(index->keys);
+    free(index->values);
+    *index = grown;
+    return 0;
+}
+
+int id_index_put(IdIndex *index, const char *key, int value)
+{
+    if ((index->count + 1) * 2 > index->capacity && id_index_grow(index) != 0) {
+        return 1;
+    }
+
+    size_t pos = id_index_slot(index, key);
+    if (index->keys[pos] == NULL) {
+        index->keys[pos] = key;
+        index->count++;
+    }
+    index->values[pos] = value;
+    return 0;
+}
+
+int id_index_get(const IdIndex *index, const char *key)
+{
+    if (index->capacity == 0 || key == NULL) {
+        return -1;
+    }
+    size_t pos = id_index_slot(index, key);
+    return index->keys[pos] != NULL ? index->values[pos] : -1;
+}
@@ -0,0 +1,290 @@
+#define _DEFAULT_SOURCE
+
+#include "id_resolver.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "index_cache.h"
+#include "trace.h"
+
+void id_matches_init(IdMatches *matches, const char *query)
+{
+    memset(matches, 0, sizeof(*matches));
+    arena_init(&matches->arena);
+    matches->query = query;
+    matches->query_len = strlen(query);
+}
+
+void id_matches_free(IdMatches *matches)
+{
+    free(matches->ids);
+    arena_free(&matches->arena);
+    memset(matches, 0, sizeof(*matches));
+}
+
+static int id_contains(const char *id, size_t len, const char *query, size_t query_len)
+{
+    if (query_len == 0) {
+        return 1;
+    }
+    for (size_t i = 0; i + query_len <= len; i++) {
+        if (id[i] == query[0] && memcmp(id + i, query, query_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void id_matches_offer(IdMatches *matches, const char *id, size_t len)
+{
+    if (matches->failed || !id_contains(id, len, matches->query, matches->query_len)) {
+        return;
+    }
+    if (matches->count == matches->capacity) {
+        int capacity = matches->capacity ? matches->capacity * 2 : 8;
+        const char **grown = realloc(matches->ids, sizeof(char *) * (size_t)capacity);
+        if (grown == NULL) {
+            matches->failed = 1;
+            return;
+        }
+        matches->ids = grown;
+        matches->capacity = capacity;
+    }
+    const char *copy = arena_strndup(&matches->arena, id, len);
+    if (copy == NULL) {
+        matches->failed = 1;
+        return;
+    }
+    matches->ids[matches->count++] = copy;
+    if (len == matches->query_len) {
+        matches->exact = copy;
+    }
+}
+
+/* Queries shorter than a trigram still avoid the directory, but check every indexed id. */
+static void offer_index_ids(IdMatches *matches, const IndexCache *cache)
+{
+    const uint32_t *entries = NULL;
+    uint32_t count = cache->entry_count;
+    for (size_t p = 0; p + INDEX_GRAM_LEN <= matches->query_len; p++) {
+        uint32_t gram_count;
+        const uint32_t *gram_entries =
+            index_cache_gram_entries(cache, matches->query + p, &gram_count);
+        if (gram_entries == NULL) {
+            return;
+        }
+        if (entries == NULL || gram_count < count) {
+            entries = gram_entries;
+            count = gram_count;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        size_t len;
+        const char *id = index_cache_entry_id(cache, entries ? entries[i] : i, &len);
+        if (id != NULL) {
+            id_matches_offer(matches, id, len);
+        }
+    }
+}
+
+static int offer_directory_ids(IdMatches *matches)
+{
+    TRACE_BEGIN(scan);
+    DIR *dir = opendir(TICKETS_DIR);
+    if (dir == NULL) {
+        return 1;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (entry->d_name[0] == '.' || len < 4 || strcmp(entry->d_name + len - 3, ".md") != 0) {
+            continue;
+        }
+        id_matches_offer(matches, entry->d_name, len - 3);
+    }
+
+    closedir(dir);
+    TRACE_END(TRACE_SCAN, scan);
+    return 0;
+}
+
+int id_match_tickets(IdMatches *matches)
+{
+    IndexCache cache;
+    if (index_cache_enabled() && index_cache_map(&cache) == 0) {
+        int current = index_cache_is_current(&cache);
+        if (current) {
+            offer_index_ids(matches, &cache);
+        }
+        index_cache_close(&cache);
+        if (current) {
+            return 0;
+        }
+    }
+    return offer_directory_ids(matches);
+}
+
+void id_grams_init(IdGrams *grams)
+{
+    memset(grams, 0, sizeof(*grams));
+}
+
+void id_grams_free(IdGrams *grams)
+{
+    free(grams->ids);
+    free(grams->pairs);
+    memset(grams, 0, sizeof(*grams));
+}
+
+int id_grams_add(IdGrams *grams, const char *id)
+{
+    if (grams->count == grams->capacity) {
+        int capacity = grams->capacity ? grams->capacity * 2 : 256;
+        const char **grown = realloc(grams->ids, sizeof(char *) * (size_t)capacity);
+        if (grown == NULL) {
+            return 1;
+        }
+        grams->ids = grown;
+        grams->capacity = capacity;
+    }
+    grams->ids[grams->count++] = id;
+    grams->built = 0;
+    return 0;
+}
+
+static uint64_t id_gram(const char *text)
+{
+    const unsigned char *b = (const unsigned char *)text;
+    return (uint64_t)b[0] << 16 | (uint64_t)b[1] << 8 | b[2];
+}
+
+static int compare_pairs(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int build_grams(IdGrams *grams)
+{
+    size_t n = 0;
+    for (int i = 0; i < grams->count; i++) {
+        size_t len = strlen(grams->ids[i]);
+        n += len >= INDEX_GRAM_LEN ? len - INDEX_GRAM_LEN + 1 : 0;
+    }
+    uint64_t *pairs = malloc(sizeof(uint64_t) * (n + 1));
+    if (pairs == NULL) {
+        return 1;
+    }
+
+    size_t count = 0;
+    for (int i = 0; i < grams->count; i++) {
+        const char *id = grams->ids[i];
+        size_t len = strlen(id);
+        for (size_t p = 0; p + INDEX_GRAM_LEN <= len; p++) {
+            pairs[count++] = id_gram(id + p) << 32 | (uint32_t)i;
+        }
+    }
+    qsort(pairs, count, sizeof(uint64_t), compare_pairs);
+
+    free(grams->pairs);
+    grams->pairs = pairs;
+    grams->pair_count = count;
+    grams->built = 1;
+    return 0;
+}
+
+/* The first pair at or after key. */
+static size_t lower_bound(const IdGrams *grams, uint64_t key)
+{
+    size_t lo = 0;
+    size_t hi = grams->pair_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (grams->pairs[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void id_match_grams(IdMatches *matches, IdGrams *grams)
+{
+    if (matches->query_len < INDEX_GRAM_LEN) {
+        for (int i = 0; i < grams->count; i++) {
+            id_matches_offer(matches, grams->ids[i], strlen(grams->ids[i]));
+        }
+        return;
+    }
+    if (!grams->built && build_grams(grams) != 0) {
+        matches->failed = 1;
+        return;
+    }
+
+    size_t first = 0;
+    size_t end = 0;
+    for (size_t p = 0; p + INDEX_GRAM_LEN <= matches->query_len; p++) {
+        uint64_t gram = id_gram(matches->query + p);
+        size_t lo = lower_bound(grams, gram << 32);
+        size_t hi = lower_bound(grams, (gram + 1) << 32);
+        if (p == 0 || hi - lo < end - first) {
+            first = lo;
+            end = hi;
+        }
+    }
+
+    /* An id repeating the gram has adjacent pairs; it is offered once. */
+    for (size_t i = first; i < end; i++) {
+        if (i > first && grams->pairs[i] == grams->pairs[i - 1]) {
+            continue;
+        }
+        const char *id = grams->ids[(uint32_t)grams->pairs[i]];
+        id_matches_offer(matches, id, strlen(id));
+    }
+}
+
+static int compare_ids(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+const char *id_matches_resolve(IdMatches *matches)
+{
+    return id_matches_resolve_in(matches, "");
+}
+
+const char *id_matches_resolve_in(IdMatches *matches, const char *context)
+{
+    if (matches->failed) {
+        fprintf(stderr, "Error: %sout of memory\n", context);
+        return NULL;
+    }
+    if (matches->exact != NULL) {
+        return matches->exact;
+    }
+    if (matches->count == 0) {
+        fprintf(stderr, "Error: %sticket '%s' not found\n", context, matches->query);
+        return NULL;
+    }
+    if (matches->count == 1) {
+        return matches->ids[0];
+    }
+
+    fprintf(stderr, "Error: %sambiguous ID '%s' matches multiple tickets\n", context,
+            matches->query);
+    qsort(matches->ids, (size_t)matches->count, sizeof(char *), compare_ids);
+    for (int i = 0; i < matches->count && i < ID_MATCHES_SHOWN; i++) {
+        fprintf(stderr, "  %s\n", matches->ids[i]);
+    }
+    if (matches->count > ID_MATCHES_SHOWN) {
+        fprintf(stderr, "  ... and %d more\n", matches->count - ID_MATCHES_SHOWN);
+    }
+    return NULL;
+}
@@ -0,0 +1,655 @@
+#define _DEFAULT_SOURCE
+
+#include "index_cache.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "atomic_write.h"
+#include "graph.h"
+
+#define INDEX_MAGIC "TKTINDEX"
+#define INDEX_VERSION 4
+#define INDEX_BYTE_ORDER 0x01020304u
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t entry_count;
+    uint32_t ref_count;
+    uint32_t strings_size;
+    uint32_t gram_count;
+    uint32_t posting_count;
+    uint32_t edge_count;
+    FileStamp dir_stamp;
+} IndexHeader;
+
+int index_cache_enabled(void)
+{
+    const char *disabled = getenv("TICKET_NO_INDEX");
+    if (disabled != NULL && disabled[0] != '\0') {
+        return 0;
+    }
+    return access(INDEX_CACHE_PATH, F_OK) == 0;
+}
+
+void file_stamp_from_stat(FileStamp *stamp, const struct stat *st)
+{
+#ifdef __APPLE__
+    long nsec = st->st_mtimespec.tv_nsec;
+#else
+    long nsec = st->st_mtim.tv_nsec;
+#endif
+    stamp->mtime_ns = (int64_t)st->st_mtime * 1000000000 + nsec;
+    stamp->size = (int64_t)st->st_size;
+    stamp->ino = (uint64_t)st->st_ino;
+}
+
+int file_stamp_equal(const FileStamp *a, const FileStamp *b)
+{
+    return a->mtime_ns == b->mtime_ns && a->size == b->size && a->ino == b->ino;
+}
+
+int index_cache_dir_stamp(FileStamp *stamp)
+{
+    struct stat st;
+    if (stat(TICKETS_DIR, &st) != 0) {
+        return 1;
+    }
+    file_stamp_from_stat(stamp, &st);
+    return 0;
+}
+
+static int string_in_bounds(IndexString s, uint32_t strings_size)
+{
+    return s.offset <= strings_size && s.len <= strings_size - s.offset;
+}
+
+static int refs_in_bounds(uint32_t offset, uint32_t count, uint32_t ref_count)
+{
+    return offset <= ref_count && count <= ref_count - offset;
+}
+
+static int index_cache_validate(const IndexCache *cache, uint32_t ref_count, uint32_t strings_size)
+{
+    for (uint32_t i = 0; i < ref_count; i++) {
+        if (!string_in_bounds(cache->refs[i], strings_size)) {
+            return 1;
+        }
+    }
+    for (uint32_t i = 0; i < cache->edge_count; i++) {
+        if (cache->edges[i] >= cache->entry_count) {
+            return 1;
+        }
+    }
+    for (uint32_t i = 0; i < cache->entry_count; i++) {
+        const IndexEntry *e = &cache->entries[i];
+        if (e->id.len == 0 || !string_in_bounds(e->id, strings_size) ||
+            !string_in_bounds(e->status, strings_size) ||
+            !string_in_bounds(e->title, strings_size) ||
+            !string_in_bounds(e->parent, strings_size) ||
+            !string_in_bounds(e->type, strings_size) ||
+            !string_in_bounds(e->assignee, strings_size) ||
+            !refs_in_bounds(e->deps_offset, e->dep_count, ref_count) ||
+            !refs_in_bounds(e->links_offset, e->link_count, ref_count) ||
+            !refs_in_bounds(e->dependents_offset, e->dependent_count, cache->edge_count) ||
+            !refs_in_bounds(e->children_offset, e->child_count, cache->edge_count)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int index_cache_map(IndexCache *cache)
+{
+    memset(cache, 0, sizeof(*cache));
+    id_index_init(&cache->by_id);
+
+    int fd = open(INDEX_CACHE_PATH, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IndexHeader)) {
+        close(fd);
+        return 1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return 1;
+    }
+    cache->map = map;
+    cache->map_size = (size_t)st.st_size;
+
+    const IndexHeader *header = map;
+    uint64_t expected = sizeof(IndexHeader) + (uint64_t)header->entry_count * sizeof(IndexEntry) +
+                        (uint64_t)header->ref_count * sizeof(IndexString) +
+                        (uint64_t)header->gram_count * sizeof(IndexGram) +
+                        (uint64_t)header->posting_count * sizeof(uint32_t) +
+                        (uint64_t)header->edge_count * sizeof(uint32_t) + header->strings_size;
+    if (memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != INDEX_VERSION || header->byte_order != INDEX_BYTE_ORDER ||
+        expected != (uint64_t)cache->map_size) {
+        index_cache_close(cache);
+        return 1;
+    }
+
+    const char *base = map;
+    cache->entry_count = header->entry_count;
+    cache->entries = (const IndexEntry *)(base + sizeof(IndexHeader));
+    cache->refs = (const IndexString *)(cache->entries + header->entry_count);
+    cache->grams = (const IndexGram *)(cache->refs + header->ref_count);
+    cache->postings = (const uint32_t *)(cache->grams + header->gram_count);
+    cache->edges = cache->postings + header->posting_count;
+    cache->strings = (const char *)(cache->edges + header->edge_count);
+    cache->gram_count = header->gram_count;
+    cache->posting_count = header->posting_count;
+    cache->edge_count = header->edge_count;
+    cache->strings_size = header->strings_size;
+    cache->dir_stamp = header->dir_stamp;
+    return 0;
+}
+
+int index_cache_open(IndexCache *cache, Interner *ids)
+{
+    if (index_cache_map(cache) != 0) {
+        return 1;
+    }
+    const IndexHeader *header = cache->map;
+    if (index_cache_validate(cache, header->ref_count, header->strings_size) != 0) {
+        index_cache_close(cache);
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < cache->entry_count; i++) {
+        const IndexEntry *e = &cache->entries[i];
+        const char *id = intern(ids, cache->strings + e->id.offset, e->id.len);
+        if (id == NULL || id_index_put(&cache->by_id, id, (int)i) != 0) {
+            index_cache_close(cache);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void index_cache_close(IndexCache *cache)
+{
+    if (cache->map != NULL) {
+        munmap(cache->map, cache->map_size);
+    }
+    id_index_free(&cache->by_id);
+    memset(cache, 0, sizeof(*cache));
+}
+
+const IndexEntry *index_cache_lookup(const IndexCache *cache, const char *interned_id,
+                                     const FileStamp *stamp)
+{
+    int i = id_index_get(&cache->by_id, interned_id);
+    if (i < 0) {
+        return NULL;
+    }
+    const IndexEntry *e = &cache->entries[i];
+    if (e->stamp.mtime_ns != stamp->mtime_ns || e->stamp.size != stamp->size ||
+        e->stamp.ino != stamp->ino) {
+        return NULL;
+    }
+    return e;
+}
+
+int index_cache_is_current(const IndexCache *cache)
+{
+    FileStamp now;
+    return cache->dir_stamp.ino != 0 && index_cache_dir_stamp(&now) == 0 &&
+           file_stamp_equal(&cache->dir_stamp, &now);
+}
+
+const char *index_cache_entry_id(const IndexCache *cache, uint32_t entry, size_t *len)
+{
+    if (entry >= cache->entry_count ||
+        !string_in_bounds(cache->entries[entry].id, cache->strings_size)) {
+        return NULL;
+    }
+    *len = cache->entries[entry].id.len;
+    return cache->strings + cache->entries[entry].id.offset;
+}
+
+static uint32_t index_gram(const char *text)
+{
+    const unsigned char *b = (const unsigned char *)text;
+    return (uint32_t)b[0] << 16 | (uint32_t)b[1] << 8 | b[2];
+}
+
+const uint32_t *index_cache_gram_entries(const IndexCache *cache, const char *text,
+                                         uint32_t *count)
+{
+    uint32_t gram = index_gram(text);
+    uint32_t lo = 0;
+    uint32_t hi = cache->gram_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (cache->grams[mid].gram < gram) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *count = 0;
+    if (lo == cache->gram_count || cache->grams[lo].gram != gram ||
+        !refs_in_bounds(cache->grams[lo].first, cache->grams[lo].count, cache->posting_count)) {
+        return NULL;
+    }
+    *count = cache->grams[lo].count;
+    return cache->postings + cache->grams[lo].first;
+}
+
+static const char *cache_intern(const IndexCache *cache, TicketStore *store, IndexString s)
+{
+    return intern(&store->strings, cache->strings + s.offset, s.len);
+}
+
+static int fill_id_list(const IndexCache *cache, TicketStore *store, uint32_t offset,
+                        uint32_t count, const char ***items, int *item_count)
+{
+    *items = NULL;
+    *item_count = 0;
+    if (count == 0) {
+        return 0;
+    }
+    const char **list = arena_alloc(&store->arena, sizeof(char *) * count);
+    if (list == NULL) {
+        return 1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        list[i] = cache_intern(cache, store, cache->refs[offset + i]);
+        if (list[i] == NULL) {
+            return 1;
+        }
+    }
+    *items = list;
+    *item_count = (int)count;
+    return 0;
+}
+
+int index_cache_fill_ticket(const IndexCache *cache, const IndexEntry *entry, TicketStore *store,
+                            Ticket *t)
+{
+    t->status = cache_intern(cache, store, entry->status);
+    t->parent = cache_intern(cache, store, entry->parent);
+    t->type = cache_intern(cache, store, entry->type);
+    t->assignee = cache_intern(cache, store, entry->assignee);
+    t->title = arena_strndup(&store->arena, cache->strings + entry->title.offset,
+                             entry->title.len);
+    t->priority = entry->priority;
+    if (t->status == NULL || t->parent == NULL || t->type == NULL || t->assignee == NULL ||
+        t->title == NULL) {
+        return 1;
+    }
+    if (fill_id_list(cache, store, entry->deps_offset, entry->dep_count, &t->deps,
+                     &t->dep_count) != 0) {
+        return 1;
+    }
+    return fill_id_list(cache, store, entry->links_offset, entry->link_count, &t->links,
+                        &t->link_count);
+}
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+} ByteBuf;
+
+static int byte_buf_append(ByteBuf *buf, const void *data, size_t len)
+{
+    if (buf->len + len > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        while (capacity < buf->len + len) {
+            capacity *= 2;
+        }
+        char *grown = realloc(buf->data, capacity);
+        if (grown == NULL) {
+            return 1;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return 0;
+}
+
+/* Strings are deduplicated by pointer, so each interned status, parent, type, assignee and id
+ * is stored once. */
+static int put_string(ByteBuf *strings, IdIndex *offsets, const char *s, IndexString *out)
+{
+    int offset = id_index_get(offsets, s);
+    if (offset < 0) {
+        if (strings->len > INT32_MAX) {
+            return 1;
+        }
+        offset = (int)strings->len;
+        if (byte_buf_append(strings, s, strlen(s)) != 0 || id_index_put(offsets, s, offset) != 0) {
+            return 1;
+        }
+    }
+    out->offset = (uint32_t)offset;
+    out->len = (uint32_t)strlen(s);
+    return 0;
+}
+
+static int put_id_list(ByteBuf *refs, ByteBuf *strings, IdIndex *offsets, const char **items,
+                       int count, uint32_t *offset_out)
+{
+    *offset_out = (uint32_t)(refs->len / sizeof(IndexString));
+    for (int i = 0; i < count; i++) {
+        IndexString ref;
+        if (put_string(strings, offsets, items[i], &ref) != 0 ||
+            byte_buf_append(refs, &ref, sizeof(ref)) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int write_dir_stamp(int fd, const FileStamp *stamp)
+{
+    ssize_t written = pwrite(fd, stamp, sizeof(*stamp), offsetof(IndexHeader, dir_stamp));
+    return written == (ssize_t)sizeof(*stamp) ? 0 : 1;
+}
+
+static int write_all(FILE *file, const ByteBuf *buf)
+{
+    return buf->len == 0 || fwrite(buf->data, 1, buf->len, file) == buf->len ? 0 : 1;
+}
+
+typedef struct {
+    ByteBuf entries;
+    ByteBuf refs;
+    ByteBuf grams;
+    ByteBuf postings;
+    ByteBuf edges;
+    ByteBuf strings;
+    IdIndex offsets;
+} IndexImage;
+
+/* Appends the graph's dependents, then its children, as entry numbers. */
+static int put_edges(ByteBuf *edges, const TicketGraph *graph)
+{
+    int dependents = graph->dependent_start[graph->count];
+    int children = graph->child_start[graph->count];
+    for (int i = 0; i < dependents; i++) {
+        uint32_t entry = (uint32_t)graph->dependents[i];
+        if (byte_buf_append(edges, &entry, sizeof(entry)) != 0) {
+            return 1;
+        }
+    }
+    for (int i = 0; i < children; i++) {
+        uint32_t entry = (uint32_t)graph->children[i];
+        if (byte_buf_append(edges, &entry, sizeof(entry)) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int build_index_image(IndexImage *image, const TicketStore *store, const FileStamp *stamps)
+{
+    TicketGraph graph;
+    if (ticket_graph_build(&graph, store) != 0) {
+        return 1;
+    }
+    if (put_edges(&image->edges, &graph) != 0) {
+        ticket_graph_free(&graph);
+        return 1;
+    }
+    uint32_t first_child = (uint32_t)graph.dependent_start[graph.count];
+
+    int rc = 0;
+    for (int i = 0; rc == 0 && i < store->count; i++) {
+        const Ticket *t = store->tickets[i];
+        IndexEntry e;
+        memset(&e, 0, sizeof(e));
+        e.stamp = stamps[i];
+        e.priority = t->priority;
+        e.dep_count = (uint32_t)t->dep_count;
+        e.link_count = (uint32_t)t->link_count;
+        e.dependents_offset = (uint32_t)graph.dependent_start[i];
+        e.dependent_count = (uint32_t)(graph.dependent_start[i + 1] - graph.dependent_start[i]);
+        e.children_offset = first_child + (uint32_t)graph.child_start[i];
+        e.child_count = (uint32_t)(graph.child_start[i + 1] - graph.child_start[i]);
+        if (put_string(&image->strings, &image->offsets, t->id, &e.id) != 0 ||
+            put_string(&image->strings, &image->offsets, t->status, &e.status) != 0 ||
+            put_string(&image->strings, &image->offsets, t->title, &e.title) != 0 ||
+            put_string(&image->strings, &image->offsets, t->parent, &e.parent) != 0 ||
+            put_string(&image->strings, &image->offsets, t->type, &e.type) != 0 ||
+            put_string(&image->strings, &image->offsets, t->assignee, &e.assignee) != 0 ||
+            put_id_list(&image->refs, &image->strings, &image->offsets, t->deps, t->dep_count,
+                        &e.deps_offset) != 0 ||
+            put_id_list(&image->refs, &image->strings, &image->offsets, t->links, t->link_count,
+                        &e.links_offset) != 0 ||
+            byte_buf_append(&image->entries, &e, sizeof(e)) != 0) {
+            rc = 1;
+        }
+    }
+    ticket_graph_free(&graph);
+    return rc;
+}
+
+static void radix_sort_grams(uint64_t **pairs, uint64_t **scratch, size_t n)
+{
+    for (int shift = 32; shift < 56; shift += 8) {
+        size_t offsets[257] = {0};
+        for (size_t i = 0; i < n; i++) {
+            offsets[(((*pairs)[i] >> shift) & 0xff) + 1]++;
+        }
+        for (int b = 0; b < 256; b++) {
+            offsets[b + 1] += offsets[b];
+        }
+        for (size_t i = 0; i < n; i++) {
+            (*scratch)[offsets[((*pairs)[i] >> shift) & 0xff]++] = (*pairs)[i];
+        }
+        uint64_t *swap = *pairs;
+        *pairs = *scratch;
+        *scratch = swap;
+    }
+}
+
+/* Pairs of (gram, entry) are sorted by gram with a stable radix sort, so each posting list
+ * comes out in entry order and an id repeating a gram yields adjacent duplicates. */
+static int build_id_grams(IndexImage *image, const TicketStore *store)
+{
+    size_t n = 0;
+    for (int i = 0; i < store->count; i++) {
+        size_t len = strlen(store->tickets[i]->id);
+        n += len >= INDEX_GRAM_LEN ? len - INDEX_GRAM_LEN + 1 : 0;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t *pairs = malloc(sizeof(uint64_t) * n);
+    uint64_t *scratch = malloc(sizeof(uint64_t) * n);
+    if (pairs == NULL || scratch == NULL) {
+        free(pairs);
+        free(scratch);
+        return 1;
+    }
+
+    size_t count = 0;
+    for (int i = 0; i < store->count; i++) {
+        const char *id = store->tickets[i]->id;
+        size_t len = strlen(id);
+        for (size_t p = 0; p + INDEX_GRAM_LEN <= len; p++) {
+            pairs[count++] = (uint64_t)index_gram(id + p) << 32 | (uint32_t)i;
+        }
+    }
+    radix_sort_grams(&pairs, &scratch, n);
+
+    int rc = 0;
+    IndexGram gram = {0, 0, 0};
+    for (size_t i = 0; rc == 0 && i < n; i++) {
+        if (i > 0 && pairs[i] == pairs[i - 1]) {
+            continue;
+        }
+        uint32_t value = (uint32_t)(pairs[i] >> 32);
+        uint32_t entry = (uint32_t)pairs[i];
+        if (gram.count > 0 && gram.gram != value) {
+            rc = byte_buf_append(&image->grams, &gram, sizeof(gram));
+            gram.first += gram.count;
+            gram.count = 0;
+        }
+        gram.gram = value;
+        gram.count++;
+        rc |= byte_buf_append(&image->postings, &entry, sizeof(entry));
+    }
+    if (rc == 0) {
+        rc = byte_buf_append(&image->grams, &gram, sizeof(gram));
+    }
+
+    free(pairs);
+    free(scratch);
+    return rc;
+}
+
+/* The directory stamp is written last, into the renamed file, and only when nothing but this
+ * write touched the directory since it was listed; otherwise it stays zero and resolvers list
+ * the directory themselves. */
+static int write_index_image(const IndexImage *image, uint32_t entry_count,
+                             const FileStamp *listed)
+{
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.byte_order = INDEX_BYTE_ORDER;
+    header.entry_count = entry_count;
+    header.ref_count = (uint32_t)(image->refs.len / sizeof(IndexString));
+    header.gram_count = (uint32_t)(image->grams.len / sizeof(IndexGram));
+    header.posting_count = (uint32_t)(image->postings.len / sizeof(uint32_t));
+    header.edge_count = (uint32_t)(image->edges.len / sizeof(uint32_t));
+    header.strings_size = (uint32_t)image->strings.len;
+
+    char temp_path[MAX_PATH];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp.%ld", INDEX_CACHE_PATH, (long)getpid());
+    FileStamp before, written, renamed;
+    FileStamp created = {0, 0, 0};
+    int current = listed != NULL && index_cache_dir_stamp(&before) == 0 &&
+                  file_stamp_equal(&before, listed);
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        return 1;
+    }
+    current = current && index_cache_dir_stamp(&created) == 0;
+    int failed = fwrite(&header, sizeof(header), 1, file) != 1 ||
+                 write_all(file, &image->entries) != 0 || write_all(file, &image->refs) != 0 ||
+                 write_all(file, &image->grams) != 0 || write_all(file, &image->postings) != 0 ||
+                 write_all(file, &image->edges) != 0 || write_all(file, &image->strings) != 0;
+    failed |= fflush(file) != 0;
+    current = current && index_cache_dir_stamp(&written) == 0 &&
+              file_stamp_equal(&written, &created);
+    if (failed || rename(temp_path, INDEX_CACHE_PATH) != 0) {
+        fclose(file);
+        unlink(temp_path);
+        return 1;
+    }
+    if (current && index_cache_dir_stamp(&renamed) == 0) {
+        write_dir_stamp(fileno(file), &renamed);
+    }
+    return fclose(file) != 0;
+}
+
+/* Writers of .tickets/.index, and commands committing a ticket file, hold an exclusive flock on
+ * .tickets itself, so refreshes, renames with their stamp carries and creates never interleave.
+ * Readers do not take it. Returns the locked descriptor, or -1 if the directory cannot be
+ * locked. */
+static int lock_index(void)
+{
+    int fd = open(TICKETS_DIR, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0 && flock(fd, LOCK_EX) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void index_cache_change_begin(IndexDirChange *change)
+{
+    change->lock = lock_index();
+    change->have_before = change->lock >= 0 && index_cache_dir_stamp(&change->before) == 0;
+}
+
+void index_cache_change_end(IndexDirChange *change, int ids_kept)
+{
+    int fd = open(INDEX_CACHE_PATH, O_RDWR);
+    if (fd >= 0) {
+        IndexHeader header;
+        FileStamp now;
+        if (pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+            header.version == INDEX_VERSION) {
+            if (!ids_kept) {
+                FileStamp cleared = {0, 0, 0};
+                write_dir_stamp(fd, &cleared);
+            } else if (change->have_before &&
+                       file_stamp_equal(&header.dir_stamp, &change->before) &&
+                       index_cache_dir_stamp(&now) == 0) {
+                write_dir_stamp(fd, &now);
+            }
+        }
+        close(fd);
+    }
+    if (change->lock >= 0) {
+        close(change->lock);
+    }
+}
+
+int index_cache_replace_file(const char *path, const char *data, size_t len)
+{
+    AtomicFile file;
+    if (atomic_file_open(&file, path, 0) != 0) {
+        return 1;
+    }
+    if (len > 0 && fwrite(data, 1, len, file.stream) != len) {
+        atomic_file_abort(&file);
+        return 1;
+    }
+
+    IndexDirChange change;
+    index_cache_change_begin(&change);
+    int rc = atomic_file_commit(&file);
+    index_cache_change_end(&change, 1);
+    return rc;
+}
+
+int index_cache_write(const TicketStore *store, const FileStamp *stamps, const FileStamp *listed)
+{
+    IndexImage image;
+    memset(&image, 0, sizeof(image));
+    id_index_init(&image.offsets);
+
+    int rc = build_index_image(&image, store, stamps);
+    if (rc == 0) {
+        rc = build_id_grams(&image, store);
+    }
+    int lock = rc == 0 ? lock_index() : -1;
+    if (lock >= 0) {
+        rc = write_index_image(&image, (uint32_t)store->count, listed);
+        close(lock);
+    } else {
+        rc = 1;
+    }
+
+    free(image.entries.data);
+    free(image.refs.data);
+    free(image.grams.data);
+    free(image.postings.data);
+    free(image.edges.data);
+    free(image.strings.data);
+    id_index_free(&image.offsets);
+    return rc;
+}
@@ -0,0 +1,101 @@
+#include "intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERN_MIN_CAPACITY 256
+
+void intern_init(Interner *interner, Arena *arena)
+{
+    interner->arena = arena;
+    interner->slots = NULL;
+    interner->capacity = 0;
+    interner->count = 0;
+}
+
+void intern_free(Interner *interner)
+{
+    free(interner->slots);
+    interner->slots = NULL;
+    interner->capacity = 0;
+    interner->count = 0;
+}
+
+uint32_t intern_hash(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static InternSlot *intern_find_slot(InternSlot *slots, size_t capacity, const char *str, size_t len,
+                                    uint32_t hash)
+{
+    size_t mask = capacity - 1;
+    size_t pos = hash & mask;
+    while (slots[pos].str != NULL) {
+        if (slots[pos].hash == hash && slots[pos].len == len &&
+            memcmp(slots[pos].str, str, len) == 0) {
+            return &slots[pos];
+        }
+        pos = (pos + 1) & mask;
+    }
+    return &slots[pos];
+}
+
+static int intern_grow(Interner *interner)
+{
+    size_t new_capacity = interner->capacity ? interner->capacity * 2 : INTERN_MIN_CAPACITY;
+    InternSlot *slots = calloc(new_capacity, sizeof(InternSlot));
+    if (slots == NULL) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < interner->capacity; i++) {
+        const InternSlot *old = &interner->slots[i];
+        if (old->str != NULL) {
+            *intern_find_slot(slots, new_capacity, old->str, old->len, old->hash) = *old;
+        }
+    }
+
+    free(interner->slots);
+    interner->slots = slots;
+    interner->capacity = new_capacity;
+    return 0;
+}
+
+const char *intern(Interner *interner, const char *str, size_t len)
+{
+    if ((interner->count + 1) * 10 > interner->capacity * 7 && intern_grow(interner) != 0) {
+        return NULL;
+    }
+
+    uint32_t hash = intern_hash(str, len);
+    InternSlot *slot = intern_find_slot(interner->slots, interner->capacity, str, len, hash);
+    if (slot->str != NULL) {
+        return slot->str;
+    }
+
+    char *copy = arena_strndup(interner->arena, str, len);
+    if (copy == NULL) {
+        return NULL;
+    }
+    slot->str = copy;
+    slot->hash = hash;
+    slot->len = (uint32_t)len;
+    interner->count++;
+    return copy;
+}
+
+const char *intern_lookup(const Interner *interner, const char *str, size_t len)
+{
+    if (interner->capacity == 0) {
+        return NULL;
+    }
+    const InternSlot *slot = intern_find_slot(interner->slots, interner->capacity, str, len,
+                                              intern_hash(str, len));
+    return slot->str;
+}
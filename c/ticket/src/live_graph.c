@@ -0,0 +1,272 @@
+#define _DEFAULT_SOURCE
+
+#include "live_graph.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+/* Edits in place leave the old strings in the arena; once that garbage outgrows the live data
+ * the store is loaded afresh. */
+#define LIVE_COMPACT_SLACK ((size_t)4 << 20)
+
+static void live_graph_unload(LiveGraph *live)
+{
+    ticket_graph_free(&live->graph);
+    ticket_store_free(&live->store);
+    live->valid = 0;
+}
+
+#ifdef __linux__
+
+/* A failed load keeps an empty store, so events can still be interned until the retry. */
+static void live_graph_load(LiveGraph *live)
+{
+    live->valid = 0;
+    if (load_all_tickets(&live->store) != 0) {
+        ticket_store_free(&live->store);
+        ticket_store_init(&live->store);
+        return;
+    }
+    if (ticket_graph_build(&live->graph, &live->store) != 0) {
+        return;
+    }
+    live->valid = 1;
+    live->loaded_size = live->store.arena.total;
+}
+
+#define LIVE_WATCH_MASK                                                                            \
+    (IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM |              \
+     IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+#define LIVE_LISTING_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+
+typedef struct {
+    IdIndex seen;
+    const char **ids;
+    int count;
+    int capacity;
+    int relist;
+    int reload;
+    int gone;
+} LiveEvents;
+
+/* The edges a ticket contributed to the graph, taken before it is re-parsed in place. */
+typedef struct {
+    int index;
+    const char *parent;
+    const char **deps;
+    int dep_count;
+} LiveSnapshot;
+
+int live_graph_open(LiveGraph *live, const char *sentinel)
+{
+    memset(live, 0, sizeof(*live));
+    live->sentinel = sentinel;
+    /* The watch goes in before the load, so no change can fall between the two. */
+    live->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (live->inotify_fd < 0 ||
+        inotify_add_watch(live->inotify_fd, TICKETS_DIR, LIVE_WATCH_MASK) < 0) {
+        fprintf(stderr, "Error: cannot watch %s\n", TICKETS_DIR);
+        if (live->inotify_fd >= 0) {
+            close(live->inotify_fd);
+        }
+        return 1;
+    }
+    live_graph_load(live);
+    return 0;
+}
+
+void live_graph_close(LiveGraph *live)
+{
+    close(live->inotify_fd);
+    free(live->changed);
+    live_graph_unload(live);
+}
+
+static int ticket_name_length(const char *name)
+{
+    size_t len = strlen(name);
+    return name[0] != '.' && len >= 4 && strcmp(name + len - 3, ".md") == 0 ? (int)len - 3 : 0;
+}
+
+static void note_ticket(LiveGraph *live, LiveEvents *events, const char *name, int len)
+{
+    const char *id = intern(&live->store.strings, name, (size_t)len);
+    if (id == NULL) {
+        events->reload = 1;
+        return;
+    }
+    if (id_index_get(&events->seen, id) >= 0) {
+        return;
+    }
+    if (events->count == events->capacity) {
+        int capacity = events->capacity ? events->capacity * 2 : 16;
+        const char **grown = realloc(events->ids, sizeof(char *) * (size_t)capacity);
+        if (grown == NULL) {
+            events->reload = 1;
+            return;
+        }
+        events->ids = grown;
+        events->capacity = capacity;
+    }
+    if (id_index_put(&events->seen, id, events->count) != 0) {
+        events->reload = 1;
+        return;
+    }
+    events->ids[events->count++] = id;
+}
+
+/* Reads every queued event without blocking. The index rewrites and temp files of commands
+ * are dot-files or lack the .md suffix, so they do not count as changes. The sentinel matters
+ * because a bound socket pins the directory: removing .tickets never raises IN_DELETE_SELF
+ * while serve's socket exists. */
+static void read_events(LiveGraph *live, LiveEvents *events)
+{
+    union {
+        char buf[4096];
+        struct inotify_event align;
+    } raw;
+
+    ssize_t n;
+    while ((n = read(live->inotify_fd, raw.buf, sizeof(raw.buf))) > 0) {
+        for (char *p = raw.buf; p < raw.buf + n;) {
+            const struct inotify_event *e = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + e->len;
+            const char *name = e->len > 0 ? e->name : "";
+            int len = ticket_name_length(name);
+            if ((e->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) ||
+                ((e->mask & (IN_DELETE | IN_MOVED_FROM)) && live->sentinel != NULL &&
+                 strcmp(name, live->sentinel) == 0)) {
+                events->gone = 1;
+            } else if (e->mask & IN_Q_OVERFLOW) {
+                events->reload = 1;
+            } else if (len > 0) {
+                events->relist |= (e->mask & LIVE_LISTING_MASK) != 0;
+                note_ticket(live, events, name, len);
+            }
+        }
+    }
+}
+
+static int same_edges(const Ticket *t, const LiveSnapshot *before)
+{
+    return t->parent == before->parent && t->dep_count == before->dep_count &&
+           (t->dep_count == 0 ||
+            memcmp(t->deps, before->deps, sizeof(char *) * (size_t)t->dep_count) == 0);
+}
+
+/* Re-parses the changed tickets, then brings the graph along: when only statuses moved, the
+ * counters of their dependents are adjusted; otherwise the graph is rebuilt from memory.
+ * Returns 1 when the store has to be loaded afresh. */
+static int apply_events(LiveGraph *live, const LiveEvents *events)
+{
+    TicketStore *store = &live->store;
+    int relist = events->relist;
+    LiveSnapshot *before = NULL;
+    if (!relist) {
+        before = malloc(sizeof(LiveSnapshot) * (size_t)events->count);
+        if (before == NULL) {
+            return 1;
+        }
+        for (int i = 0; i < events->count; i++) {
+            before[i].index = find_ticket_interned(store, events->ids[i]);
+            if (before[i].index >= 0) {
+                const Ticket *t = store->tickets[before[i].index];
+                before[i].parent = t->parent;
+                before[i].deps = t->deps;
+                before[i].dep_count = t->dep_count;
+            }
+        }
+    }
+
+    int rc = ticket_store_refresh(store, events->ids, events->count, relist);
+    if (rc == STORE_NEEDS_LISTING) {
+        relist = 1;
+        rc = ticket_store_refresh(store, events->ids, events->count, 1);
+    }
+    if (rc != 0) {
+        free(before);
+        return 1;
+    }
+
+    int statuses_only = !relist;
+    for (int i = 0; statuses_only && i < events->count; i++) {
+        statuses_only = before[i].index < 0 ||
+                        same_edges(store->tickets[before[i].index], &before[i]);
+    }
+    if (statuses_only) {
+        for (int i = 0; i < events->count; i++) {
+            if (before[i].index < 0) {
+                continue;
+            }
+            const char *status = store->tickets[before[i].index]->status;
+            ticket_graph_set_status(&live->graph, store, before[i].index, status);
+        }
+    } else {
+        ticket_graph_free(&live->graph);
+        rc = ticket_graph_build(&live->graph, store);
+    }
+    free(before);
+    live->relisted = relist;
+    return rc;
+}
+
+int live_graph_refresh(LiveGraph *live)
+{
+    LiveEvents events;
+    memset(&events, 0, sizeof(events));
+    id_index_init(&events.seen);
+    read_events(live, &events);
+
+    int result = LIVE_UNCHANGED;
+    if (events.gone) {
+        result = LIVE_GONE;
+    } else if (events.count > 0 || events.reload || !live->valid) {
+        int reload = events.reload || !live->valid ||
+                     live->store.arena.total > 2 * live->loaded_size + LIVE_COMPACT_SLACK;
+        if (reload || apply_events(live, &events) != 0) {
+            live_graph_unload(live);
+            live_graph_load(live);
+            live->relisted = 1;
+        }
+        /* After a reload the queued ids point into the freed store. */
+        free(live->changed);
+        live->changed = live->relisted ? NULL : events.ids;
+        live->changed_count = live->relisted ? 0 : events.count;
+        events.ids = live->relisted ? events.ids : NULL;
+        result = LIVE_CHANGED;
+    }
+    free(events.ids);
+    id_index_free(&events.seen);
+    return result;
+}
+
+#else
+
+int live_graph_open(LiveGraph *live, const char *sentinel)
+{
+    memset(live, 0, sizeof(*live));
+    live->sentinel = sentinel;
+    live->inotify_fd = -1;
+    fprintf(stderr, "Error: watching %s needs inotify, which this platform does not have\n",
+            TICKETS_DIR);
+    return 1;
+}
+
+void live_graph_close(LiveGraph *live)
+{
+    free(live->changed);
+    live_graph_unload(live);
+}
+
+int live_graph_refresh(LiveGraph *live)
+{
+    (void)live;
+    return LIVE_UNCHANGED;
+}
+
+#endif
@@ -1,4 +1,8 @@
+#define _DEFAULT_SOURCE
+
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <openssl/sha.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,40 +13,35 @@
 #include <time.h>
 #include <unistd.h>
 
-#define VERSION "0.1.0"
-#define TICKETS_DIR ".tickets"
-#define MAX_PATH 1024
-#define MAX_MATCHES 100
-#define MAX_LINKS 100
-#define MAX_DEPS 100
-#define MAX_TICKETS 1000
-
-typedef struct {
-    char id[MAX_PATH];
-    char status[64];
-    char title[256];
-    char deps[MAX_DEPS][MAX_PATH];
-    int dep_count;
-    char links[MAX_LINKS][MAX_PATH];
-    int link_count;
-    char parent[MAX_PATH];
-    int priority;
-    int subtree_depth;
-    int visited;
-} Ticket;
+#include "atomic_write.h"
+#include "batch.h"
+#include "columnar.h"
+#include "file_lock.h"
+#include "frontmatter.h"
+#include "frontmatter_patch.h"
+#include "graph.h"
+#include "id_resolver.h"
+#include "index_cache.h"
+#include "out_buf.h"
+#include "query_filter.h"
+#include "serve.h"
+#include "store.h"
+#include "trace.h"
+#include "watch.h"
 
-static int load_all_tickets(Ticket *tickets, int *ticket_count);
-static int find_ticket(Ticket *tickets, int ticket_count, const char *id);
+#define VERSION "0.1.0"
 
 static void print_usage(const char *program_name)
 {
     printf("Ticket CLI - C Implementation\n");
     printf("Version: %s\n\n", VERSION);
-    printf("Usage: %s <command> [arguments]\n\n", program_name);
+    printf("Usage: %s [--jobs=N] <command> [arguments]\n\n", program_name);
     printf("Commands:\n");
     printf("  create [title]              Create a new ticket\n");
     printf("  show <id>                   Show ticket details\n");
     printf("  list                        List all tickets\n");
+    printf("  ls [--status=S] [--watch]   List tickets, then follow changes with --watch\n");
+    printf("  ready [--watch]             List ready tickets, then follow changes with --watch\n");
     printf("  status <id> <status>        Update ticket status\n");
     printf("  start <id>                  Set status to in_progress\n");
     printf("  close <id>                  Set status to closed\n");
@@ -52,9 +51,13 @@ static void print_usage(const char *program_name)
     printf("  dep tree [--full] <id>      Show dependency tree\n");
     printf("  link <id> <id> [id...]      Add symmetric links\n");
     printf("  unlink <id> <id>            Remove symmetric link\n");
+    printf("  batch                       Apply status/dep/link operations read from stdin\n");
     printf("  edit <id>                   Edit ticket in $EDITOR\n");
     printf("  add-note <id> <note>        Add note to ticket\n");
     printf("  query [options]             Query tickets (JSON output)\n");
+    printf("  export --format=columnar    Write a binary snapshot of all tickets to stdout\n");
+    printf("  index [--drop]              Build or remove the .tickets/.index cache\n");
+    printf("  serve                       Keep tickets loaded and answer commands over a socket\n");
     printf("  help                        Show this help message\n");
     printf("  version                     Show version information\n");
     printf("\n");
@@ -78,48 +81,20 @@ static int resolve_ticket_id(const char *ticket_id, char *resolved_path, size_t
         return 0;
     }
 
-    DIR *dir = opendir(TICKETS_DIR);
-    if (dir == NULL) {
+    IdMatches matches;
+    id_matches_init(&matches, ticket_id);
+    if (id_match_tickets(&matches) != 0) {
         fprintf(stderr, "Error: cannot open tickets directory\n");
+        id_matches_free(&matches);
         return 1;
     }
 
-    char matches[MAX_MATCHES][MAX_PATH];
-    int match_count = 0;
-
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] == '.') {
-            continue;
-        }
-
-        size_t len = strlen(entry->d_name);
-        if (len < 4 || strcmp(entry->d_name + len - 3, ".md") != 0) {
-            continue;
-        }
-
-        if (strstr(entry->d_name, ticket_id) != NULL) {
-            if (match_count < MAX_MATCHES) {
-                snprintf(matches[match_count], MAX_PATH, "%s/%s", TICKETS_DIR, entry->d_name);
-                match_count++;
-            }
-        }
-    }
-
-    closedir(dir);
-
-    if (match_count == 0) {
-        fprintf(stderr, "Error: ticket '%s' not found\n", ticket_id);
-        return 1;
-    }
-
-    if (match_count > 1) {
-        fprintf(stderr, "Error: ambiguous ID '%s' matches multiple tickets\n", ticket_id);
-        return 1;
+    const char *id = id_matches_resolve(&matches);
+    if (id != NULL) {
+        snprintf(resolved_path, path_size, "%s/%s.md", TICKETS_DIR, id);
     }
-
-    snprintf(resolved_path, path_size, "%s", matches[0]);
-    return 0;
+    id_matches_free(&matches);
+    return id == NULL;
 }
 
 static void get_iso_date(char *buffer, size_t size)
@@ -181,6 +156,83 @@ static void ensure_tickets_dir(void)
     }
 }
 
+static int lock_ticket_file(FileLock *lock, const char *file_path)
+{
+    if (file_lock_acquire(lock, file_path) != 0) {
+        fprintf(stderr, "Error: cannot lock ticket file\n");
+        return 1;
+    }
+    return 0;
+}
+
+/* Reads the ticket once under its lock, applies the edits and writes it back once, if any of
+ * them changed it; *changes is how many did. Holding the lock means no other writer can slip
+ * in between the read and the rename. */
+static int patch_ticket_file(const char *file_path, const FrontmatterEdit *edits, int count,
+                             int *changes)
+{
+    FileLock lock;
+    if (lock_ticket_file(&lock, file_path) != 0) {
+        return 1;
+    }
+
+    TicketFile file;
+    if (ticket_file_open(&file, file_path) != 0) {
+        file_lock_release(&lock);
+        fprintf(stderr, "Error: cannot read ticket file\n");
+        return 1;
+    }
+
+    OutBuf text;
+    int rc = 0;
+    if (out_buf_init_memory(&text) != 0 ||
+        (*changes = frontmatter_patch(&file, edits, count, &text)) < 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        rc = 1;
+    } else if (*changes > 0 && index_cache_replace_file(file_path, text.data, text.len) != 0) {
+        fprintf(stderr, "Error: cannot update ticket file\n");
+        rc = 1;
+    }
+    out_buf_close(&text);
+    ticket_file_close(&file);
+    file_lock_release(&lock);
+    return rc;
+}
+
+static int patch_ticket_line(const char *file_path, FrontmatterEditKind kind, const char *key,
+                             const char *value, int *changed)
+{
+    FrontmatterEdit edit = {kind, key, value};
+    return patch_ticket_file(file_path, &edit, 1, changed);
+}
+
+/* Filled once by serve, so creates answered by the daemon skip the git subprocess. */
+static char cached_user_name[256];
+static int have_cached_user_name = 0;
+
+static void read_git_user_name(char *name, size_t size)
+{
+    FILE *git_cmd = popen("git config user.name 2>/dev/null", "r");
+    if (git_cmd != NULL) {
+        if (fgets(name, (int)size, git_cmd) != NULL) {
+            size_t len = strlen(name);
+            if (len > 0 && name[len - 1] == '\n') {
+                name[len - 1] = '\0';
+            }
+        }
+        pclose(git_cmd);
+    }
+}
+
+static void git_user_name(char *name, size_t size)
+{
+    if (have_cached_user_name) {
+        snprintf(name, size, "%s", cached_user_name);
+    } else {
+        read_git_user_name(name, size);
+    }
+}
+
 static int cmd_create(int argc, char *argv[])
 {
     ensure_tickets_dir();
@@ -195,16 +247,7 @@ static int cmd_create(int argc, char *argv[])
     char external_ref[256] = "";
     char parent[64] = "";
 
-    FILE *git_cmd = popen("git config user.name 2>/dev/null", "r");
-    if (git_cmd != NULL) {
-        if (fgets(assignee, sizeof(assignee), git_cmd) != NULL) {
-            size_t len = strlen(assignee);
-            if (len > 0 && assignee[len - 1] == '\n') {
-                assignee[len - 1] = '\0';
-            }
-        }
-        pclose(git_cmd);
-    }
+    git_user_name(assignee, sizeof(assignee));
 
     int i = 1;
     while (i < argc) {
@@ -287,12 +330,13 @@ static int cmd_create(int argc, char *argv[])
     char now[32];
     get_iso_date(now, sizeof(now));
 
-    FILE *file = fopen(file_path, "w");
-    if (file == NULL) {
+    AtomicFile created;
+    if (atomic_file_open(&created, file_path, ATOMIC_WRITE_CREATE) != 0) {
         fprintf(stderr, "Error: cannot create ticket file\n");
         return 1;
     }
 
+    FILE *file = created.stream;
     fprintf(file, "---\n");
     fprintf(file, "id: %s\n", ticket_id);
     fprintf(file, "status: open\n");
@@ -325,7 +369,15 @@ static int cmd_create(int argc, char *argv[])
         fprintf(file, "## Acceptance Criteria\n\n%s\n\n", acceptance);
     }
 
-    fclose(file);
+    /* A new id: the index stops vouching for the directory listing. */
+    IndexDirChange change;
+    index_cache_change_begin(&change);
+    int rc = atomic_file_commit(&created);
+    index_cache_change_end(&change, 0);
+    if (rc != 0) {
+        fprintf(stderr, "Error: cannot create ticket file\n");
+        return 1;
+    }
 
     printf("%s\n", ticket_id);
     return 0;
@@ -352,104 +404,85 @@ static int cmd_show(int argc, char *argv[])
     }
     snprintf(target_id, sizeof(target_id), "%.*s", (int)(strlen(base_name) - 3), base_name);
 
-    Ticket *tickets = malloc(sizeof(Ticket) * MAX_TICKETS);
-    if (tickets == NULL) {
-        fprintf(stderr, "Error: out of memory\n");
-        return 1;
-    }
-
-    int ticket_count = 0;
-    if (load_all_tickets(tickets, &ticket_count) != 0) {
+    /* Only the target's neighbourhood is needed; the graph below covers just those tickets. */
+    TicketStore store;
+    if (load_ticket_neighbourhood(&store, target_id) != 0 && load_all_tickets(&store) != 0) {
         fprintf(stderr, "Error: cannot load tickets\n");
-        free(tickets);
         return 1;
     }
 
-    int target_idx = find_ticket(tickets, ticket_count, target_id);
+    int target_idx = find_ticket(&store, target_id);
     if (target_idx < 0) {
         fprintf(stderr, "Error: ticket '%s' not found\n", argv[1]);
-        free(tickets);
+        ticket_store_free(&store);
         return 1;
     }
 
-    Ticket *target = &tickets[target_idx];
+    Ticket **tickets = store.tickets;
+    Ticket *target = tickets[target_idx];
 
-    struct {
-        char id[MAX_PATH];
-        char status[64];
-        char title[256];
-    } blockers[MAX_DEPS];
-    int blocker_count = 0;
+    TicketGraph graph;
+    if (ticket_graph_build(&graph, &store) != 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        ticket_store_free(&store);
+        return 1;
+    }
+    int first_dependent = graph.dependent_start[target_idx];
+    int dependent_count = graph.dependent_start[target_idx + 1] - first_dependent;
+    int first_child = graph.child_start[target_idx];
+    int child_count = graph.child_start[target_idx + 1] - first_child;
 
-    struct {
-        char id[MAX_PATH];
-        char status[64];
-        char title[256];
-    } blocking[MAX_TICKETS];
-    int blocking_count = 0;
+    const Ticket **related = malloc(sizeof(Ticket *) * (size_t)(target->dep_count +
+                                                                target->link_count +
+                                                                dependent_count + child_count +
+                                                                1));
+    if (related == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        ticket_graph_free(&graph);
+        ticket_store_free(&store);
+        return 1;
+    }
 
-    struct {
-        char id[MAX_PATH];
-        char status[64];
-        char title[256];
-    } children[MAX_TICKETS];
+    const Ticket **blockers = related;
+    int blocker_count = 0;
+    const Ticket **blocking = blockers + target->dep_count;
+    int blocking_count = 0;
+    const Ticket **children = blocking + dependent_count;
     int children_count = 0;
-
-    struct {
-        char id[MAX_PATH];
-        char status[64];
-        char title[256];
-    } linked[MAX_LINKS];
+    const Ticket **linked = children + child_count;
     int linked_count = 0;
 
-    for (int i = 0; i < target->dep_count; i++) {
-        int dep_idx = find_ticket(tickets, ticket_count, target->deps[i]);
-        if (dep_idx >= 0) {
-            Ticket *dep = &tickets[dep_idx];
-            if (strcmp(dep->status, "closed") != 0) {
-                strcpy(blockers[blocker_count].id, dep->id);
-                strcpy(blockers[blocker_count].status, dep->status);
-                strcpy(blockers[blocker_count].title, dep->title);
-                blocker_count++;
-            }
+    for (int e = graph.dep_start[target_idx]; e < graph.dep_start[target_idx + 1]; e++) {
+        int dep_idx = graph.dep_targets[e];
+        if (dep_idx >= 0 && !graph.closed[dep_idx]) {
+            blockers[blocker_count++] = tickets[dep_idx];
         }
     }
 
-    for (int i = 0; i < ticket_count; i++) {
-        Ticket *t = &tickets[i];
-        for (int j = 0; j < t->dep_count; j++) {
-            if (strcmp(t->deps[j], target_id) == 0 && strcmp(t->status, "closed") != 0) {
-                strcpy(blocking[blocking_count].id, t->id);
-                strcpy(blocking[blocking_count].status, t->status);
-                strcpy(blocking[blocking_count].title, t->title);
-                blocking_count++;
-                break;
-            }
+    for (int d = 0; d < dependent_count; d++) {
+        int dependent = graph.dependents[first_dependent + d];
+        if (!graph.closed[dependent]) {
+            blocking[blocking_count++] = tickets[dependent];
         }
+    }
 
-        if (strcmp(t->parent, target_id) == 0) {
-            strcpy(children[children_count].id, t->id);
-            strcpy(children[children_count].status, t->status);
-            strcpy(children[children_count].title, t->title);
-            children_count++;
-        }
+    for (int c = 0; c < child_count; c++) {
+        children[children_count++] = tickets[graph.children[first_child + c]];
     }
+    ticket_graph_free(&graph);
 
     for (int i = 0; i < target->link_count; i++) {
-        int link_idx = find_ticket(tickets, ticket_count, target->links[i]);
+        int link_idx = find_ticket_interned(&store, target->links[i]);
         if (link_idx >= 0) {
-            Ticket *link = &tickets[link_idx];
-            strcpy(linked[linked_count].id, link->id);
-            strcpy(linked[linked_count].status, link->status);
-            strcpy(linked[linked_count].title, link->title);
-            linked_count++;
+            linked[linked_count++] = tickets[link_idx];
         }
     }
 
     FILE *file = fopen(resolved_path, "r");
     if (file == NULL) {
         fprintf(stderr, "Error: cannot read ticket file\n");
-        free(tickets);
+        free(related);
+        ticket_store_free(&store);
         return 1;
     }
 
@@ -463,9 +496,9 @@ static int cmd_show(int argc, char *argv[])
         }
 
         if (in_frontmatter && strncmp(line, "parent:", 7) == 0 && target->parent[0] != '\0') {
-            int parent_idx = find_ticket(tickets, ticket_count, target->parent);
+            int parent_idx = find_ticket_interned(&store, target->parent);
             if (parent_idx >= 0) {
-                printf("%s  # %s\n", line, tickets[parent_idx].title);
+                printf("%s  # %s\n", line, tickets[parent_idx]->title);
             } else {
                 printf("%s", line);
             }
@@ -479,32 +512,33 @@ static int cmd_show(int argc, char *argv[])
     if (blocker_count > 0) {
         printf("\n## Blockers\n\n");
         for (int i = 0; i < blocker_count; i++) {
-            printf("- %s [%s] %s\n", blockers[i].id, blockers[i].status, blockers[i].title);
+            printf("- %s [%s] %s\n", blockers[i]->id, blockers[i]->status, blockers[i]->title);
         }
     }
 
     if (blocking_count > 0) {
         printf("\n## Blocking\n\n");
         for (int i = 0; i < blocking_count; i++) {
-            printf("- %s [%s] %s\n", blocking[i].id, blocking[i].status, blocking[i].title);
+            printf("- %s [%s] %s\n", blocking[i]->id, blocking[i]->status, blocking[i]->title);
         }
     }
 
     if (children_count > 0) {
         printf("\n## Children\n\n");
         for (int i = 0; i < children_count; i++) {
-            printf("- %s [%s] %s\n", children[i].id, children[i].status, children[i].title);
+            printf("- %s [%s] %s\n", children[i]->id, children[i]->status, children[i]->title);
         }
     }
 
     if (linked_count > 0) {
         printf("\n## Linked\n\n");
         for (int i = 0; i < linked_count; i++) {
-            printf("- %s [%s] %s\n", linked[i].id, linked[i].status, linked[i].title);
+            printf("- %s [%s] %s\n", linked[i]->id, linked[i]->status, linked[i]->title);
         }
     }
 
-    free(tickets);
+    free(related);
+    ticket_store_free(&store);
     return 0;
 }
 
@@ -534,43 +568,8 @@ static int cmd_status(int argc, char *argv[])
     char ticket_id[MAX_PATH];
     snprintf(ticket_id, sizeof(ticket_id), "%.*s", (int)(strlen(basename) - 3), basename);
 
-    FILE *file = fopen(resolved_path, "r");
-    if (file == NULL) {
-        fprintf(stderr, "Error: cannot read ticket file\n");
-        return 1;
-    }
-
-    char temp_path[MAX_PATH];
-    snprintf(temp_path, sizeof(temp_path), "%s.tmp", resolved_path);
-    FILE *temp_file = fopen(temp_path, "w");
-    if (temp_file == NULL) {
-        fclose(file);
-        fprintf(stderr, "Error: cannot write temp file\n");
-        return 1;
-    }
-
-    char line[1024];
-    int in_frontmatter = 0;
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (strcmp(line, "---\n") == 0) {
-            fprintf(temp_file, "%s", line);
-            in_frontmatter = !in_frontmatter;
-            continue;
-        }
-
-        if (in_frontmatter && strncmp(line, "status:", 7) == 0) {
-            fprintf(temp_file, "status: %s\n", new_status);
-        } else {
-            fprintf(temp_file, "%s", line);
-        }
-    }
-
-    fclose(file);
-    fclose(temp_file);
-
-    if (rename(temp_path, resolved_path) != 0) {
-        fprintf(stderr, "Error: cannot update ticket file\n");
-        unlink(temp_path);
+    int changed;
+    if (patch_ticket_line(resolved_path, FRONTMATTER_SET, "status", new_status, &changed) != 0) {
         return 1;
     }
 
@@ -608,9 +607,6 @@ static int cmd_reopen(int argc, char *argv[])
     return cmd_status(3, new_argv);
 }
 
-static int parse_deps(const char *file_path, char deps[MAX_DEPS][MAX_PATH], int *dep_count);
-static int has_dep(char deps[MAX_DEPS][MAX_PATH], int dep_count, const char *dep_id);
-static int add_dep_to_file(const char *file_path, const char *dep_id);
 static int cmd_dep_tree(int argc, char *argv[]);
 static int cmd_undep(int argc, char *argv[]);
 
@@ -652,595 +648,196 @@ static int cmd_dep(int argc, char *argv[])
     char dep_id[MAX_PATH];
     snprintf(dep_id, sizeof(dep_id), "%.*s", (int)(strlen(basename2) - 3), basename2);
 
-    char existing_deps[MAX_DEPS][MAX_PATH];
-    int dep_count = 0;
-
-    if (parse_deps(resolved_path, existing_deps, &dep_count) != 0) {
-        fprintf(stderr, "Error: cannot read ticket file\n");
+    int added;
+    if (patch_ticket_line(resolved_path, FRONTMATTER_LIST_ADD, "deps", dep_id, &added) != 0) {
         return 1;
     }
 
-    if (has_dep(existing_deps, dep_count, dep_id)) {
+    if (!added) {
         printf("Dependency already exists\n");
         return 0;
     }
 
-    if (add_dep_to_file(resolved_path, dep_id) != 0) {
-        return 1;
-    }
-
     printf("Added dependency: %s -> %s\n", ticket_id, dep_id);
     return 0;
 }
 
-static int parse_links(const char *file_path, char links[MAX_LINKS][MAX_PATH], int *link_count)
+static int cmd_link(int argc, char *argv[])
 {
-    FILE *file = fopen(file_path, "r");
-    if (file == NULL) {
+    if (argc < 3) {
+        fprintf(stderr, "Error: at least two ticket IDs required\n");
         return 1;
     }
 
-    *link_count = 0;
-    char line[1024];
-    int in_frontmatter = 0;
+    int num_tickets = argc - 1;
+    char (*resolved_paths)[MAX_PATH] = malloc(sizeof(*resolved_paths) * 2 * (size_t)num_tickets);
+    if (resolved_paths == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    char (*ticket_ids)[MAX_PATH] = resolved_paths + num_tickets;
 
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (strcmp(line, "---\n") == 0) {
-            in_frontmatter = !in_frontmatter;
-            continue;
+    for (int i = 0; i < num_tickets; i++) {
+        if (resolve_ticket_id(argv[i + 1], resolved_paths[i], sizeof(resolved_paths[i])) != 0) {
+            free(resolved_paths);
+            return 1;
         }
 
-        if (in_frontmatter && strncmp(line, "links:", 6) == 0) {
-            char *bracket = strchr(line, '[');
-            if (bracket != NULL) {
-                char *end = strchr(bracket, ']');
-                if (end != NULL) {
-                    *end = '\0';
-                    bracket++;
-                    if (*bracket != '\0' && *bracket != ']') {
-                        char *token = strtok(bracket, ",");
-                        while (token != NULL && *link_count < MAX_LINKS) {
-                            while (*token == ' ')
-                                token++;
-                            char *token_end = token + strlen(token) - 1;
-                            while (token_end > token && (*token_end == ' ' || *token_end == '\n')) {
-                                *token_end = '\0';
-                                token_end--;
-                            }
-                            if (*token != '\0') {
-                                strncpy(links[*link_count], token, MAX_PATH - 1);
-                                links[*link_count][MAX_PATH - 1] = '\0';
-                                (*link_count)++;
-                            }
-                            token = strtok(NULL, ",");
-                        }
-                    }
-                }
-            }
-            break;
-        }
+        const char *basename = strrchr(resolved_paths[i], '/');
+        basename = basename ? basename + 1 : resolved_paths[i];
+        snprintf(ticket_ids[i], sizeof(ticket_ids[i]), "%.*s", (int)(strlen(basename) - 3),
+                 basename);
     }
 
-    fclose(file);
-    return 0;
-}
+    FrontmatterEdit *edits = malloc(sizeof(FrontmatterEdit) * (size_t)num_tickets);
+    if (edits == NULL) {
+        free(resolved_paths);
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
 
-static int has_link(char links[MAX_LINKS][MAX_PATH], int link_count, const char *link_id)
-{
-    for (int i = 0; i < link_count; i++) {
-        if (strcmp(links[i], link_id) == 0) {
+    /* Each ticket gains all of its new links in one write. */
+    int total_added = 0;
+    for (int i = 0; i < num_tickets; i++) {
+        int count = 0;
+        for (int j = 0; j < num_tickets; j++) {
+            if (i != j) {
+                edits[count++] = (FrontmatterEdit){FRONTMATTER_LIST_ADD, "links", ticket_ids[j]};
+            }
+        }
+
+        int added;
+        if (patch_ticket_file(resolved_paths[i], edits, count, &added) != 0) {
+            free(edits);
+            free(resolved_paths);
             return 1;
         }
+        total_added += added;
+    }
+    free(edits);
+
+    if (total_added == 0) {
+        printf("All links already exist\n");
+    } else {
+        printf("Added %d link(s) between %d tickets\n", total_added, num_tickets);
     }
+
+    free(resolved_paths);
     return 0;
 }
 
-static int add_link_to_file(const char *file_path, const char *link_id)
+static int cmd_unlink(int argc, char *argv[])
 {
-    char existing_links[MAX_LINKS][MAX_PATH];
-    int link_count = 0;
-
-    if (parse_links(file_path, existing_links, &link_count) != 0) {
-        fprintf(stderr, "Error: cannot read ticket file\n");
+    if (argc != 3) {
+        fprintf(stderr, "Error: exactly two ticket IDs required\n");
         return 1;
     }
 
-    if (has_link(existing_links, link_count, link_id)) {
-        return 0;
-    }
-
-    FILE *file = fopen(file_path, "r");
-    if (file == NULL) {
-        fprintf(stderr, "Error: cannot read ticket file\n");
+    char resolved_path1[MAX_PATH];
+    if (resolve_ticket_id(argv[1], resolved_path1, sizeof(resolved_path1)) != 0) {
         return 1;
     }
 
-    char temp_path[MAX_PATH];
-    snprintf(temp_path, sizeof(temp_path), "%s.tmp", file_path);
-    FILE *temp_file = fopen(temp_path, "w");
-    if (temp_file == NULL) {
-        fclose(file);
-        fprintf(stderr, "Error: cannot write temp file\n");
+    char resolved_path2[MAX_PATH];
+    if (resolve_ticket_id(argv[2], resolved_path2, sizeof(resolved_path2)) != 0) {
         return 1;
     }
 
-    char line[1024];
-    int in_frontmatter = 0;
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (strcmp(line, "---\n") == 0) {
-            fprintf(temp_file, "%s", line);
-            in_frontmatter = !in_frontmatter;
-            continue;
-        }
+    char id1[MAX_PATH], id2[MAX_PATH];
+    const char *basename1 = strrchr(resolved_path1, '/');
+    basename1 = basename1 ? basename1 + 1 : resolved_path1;
+    snprintf(id1, sizeof(id1), "%.*s", (int)(strlen(basename1) - 3), basename1);
 
-        if (in_frontmatter && strncmp(line, "links:", 6) == 0) {
-            char *bracket = strchr(line, '[');
-            if (bracket != NULL) {
-                char *end = strchr(bracket, ']');
-                if (end != NULL) {
-                    *end = '\0';
-                    if (bracket[1] == ']' || bracket[1] == '\0') {
-                        fprintf(temp_file, "links: [%s]\n", link_id);
-                    } else {
-                        fprintf(temp_file, "%s, %s]\n", line, link_id);
-                    }
-                    continue;
-                }
-            }
-        }
-        fprintf(temp_file, "%s", line);
+    const char *basename2 = strrchr(resolved_path2, '/');
+    basename2 = basename2 ? basename2 + 1 : resolved_path2;
+    snprintf(id2, sizeof(id2), "%.*s", (int)(strlen(basename2) - 3), basename2);
+
+    int removed;
+    if (patch_ticket_line(resolved_path1, FRONTMATTER_LIST_REMOVE, "links", id2, &removed) != 0) {
+        return 1;
     }
 
-    fclose(file);
-    fclose(temp_file);
+    if (!removed) {
+        printf("Link not found\n");
+        return 1;
+    }
 
-    if (rename(temp_path, file_path) != 0) {
-        fprintf(stderr, "Error: cannot update ticket file\n");
-        unlink(temp_path);
+    if (patch_ticket_line(resolved_path2, FRONTMATTER_LIST_REMOVE, "links", id1, &removed) != 0) {
         return 1;
     }
 
+    printf("Removed link: %s <-> %s\n", id1, id2);
     return 0;
 }
 
-static int remove_link_from_file(const char *file_path, const char *link_id)
+static int cmd_batch(int argc, char *argv[])
 {
-    FILE *file = fopen(file_path, "r");
-    if (file == NULL) {
-        fprintf(stderr, "Error: cannot read ticket file\n");
+    (void)argc;
+    (void)argv;
+    return batch_run(stdin);
+}
+
+static int cmd_edit(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: ticket edit <id>\n");
         return 1;
     }
 
-    char temp_path[MAX_PATH];
-    snprintf(temp_path, sizeof(temp_path), "%s.tmp", file_path);
-    FILE *temp_file = fopen(temp_path, "w");
-    if (temp_file == NULL) {
-        fclose(file);
-        fprintf(stderr, "Error: cannot write temp file\n");
+    char resolved_path[MAX_PATH];
+    if (resolve_ticket_id(argv[1], resolved_path, sizeof(resolved_path)) != 0) {
         return 1;
     }
 
-    char line[1024];
-    int in_frontmatter = 0;
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (strcmp(line, "---\n") == 0) {
-            fprintf(temp_file, "%s", line);
-            in_frontmatter = !in_frontmatter;
-            continue;
+    if (isatty(STDIN_FILENO) && isatty(STDOUT_FILENO)) {
+        const char *editor = getenv("EDITOR");
+        if (editor == NULL) {
+            editor = "vi";
         }
 
-        if (in_frontmatter && strncmp(line, "links:", 6) == 0) {
-            char existing_links[MAX_LINKS][MAX_PATH];
-            int link_count = 0;
-
-            char *bracket = strchr(line, '[');
-            if (bracket != NULL) {
-                char *end = strchr(bracket, ']');
-                if (end != NULL) {
-                    *end = '\0';
-                    bracket++;
-                    if (*bracket != '\0' && *bracket != ']') {
-                        char *token = strtok(bracket, ",");
-                        while (token != NULL && link_count < MAX_LINKS) {
-                            while (*token == ' ')
-                                token++;
-                            char *token_end = token + strlen(token) - 1;
-                            while (token_end > token && (*token_end == ' ' || *token_end == '\n')) {
-                                *token_end = '\0';
-                                token_end--;
-                            }
-                            if (*token != '\0' && strcmp(token, link_id) != 0) {
-                                strncpy(existing_links[link_count], token, MAX_PATH - 1);
-                                existing_links[link_count][MAX_PATH - 1] = '\0';
-                                link_count++;
-                            }
-                            token = strtok(NULL, ",");
-                        }
-                    }
-                }
-            }
+        pid_t pid = fork();
+        if (pid == -1) {
+            fprintf(stderr, "Error: failed to fork process\n");
+            return 1;
+        }
 
-            fprintf(temp_file, "links: [");
-            for (int i = 0; i < link_count; i++) {
-                if (i > 0)
-                    fprintf(temp_file, ", ");
-                fprintf(temp_file, "%s", existing_links[i]);
+        if (pid == 0) {
+            execlp(editor, editor, resolved_path, (char *)NULL);
+            fprintf(stderr, "Error: failed to execute editor '%s'\n", editor);
+            exit(1);
+        } else {
+            int status;
+            if (waitpid(pid, &status, 0) == -1) {
+                fprintf(stderr, "Error: failed to wait for editor process\n");
+                return 1;
+            }
+            if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+                return 1;
             }
-            fprintf(temp_file, "]\n");
-            continue;
         }
-        fprintf(temp_file, "%s", line);
-    }
-
-    fclose(file);
-    fclose(temp_file);
-
-    if (rename(temp_path, file_path) != 0) {
-        fprintf(stderr, "Error: cannot update ticket file\n");
-        unlink(temp_path);
-        return 1;
-    }
-
-    return 0;
-}
-
-static int parse_deps(const char *file_path, char deps[MAX_DEPS][MAX_PATH], int *dep_count)
-{
-    FILE *file = fopen(file_path, "r");
-    if (file == NULL) {
-        return 1;
-    }
-
-    *dep_count = 0;
-    char line[1024];
-    int in_frontmatter = 0;
-
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (strcmp(line, "---\n") == 0) {
-            in_frontmatter = !in_frontmatter;
-            continue;
-        }
-
-        if (in_frontmatter && strncmp(line, "deps:", 5) == 0) {
-            char *bracket = strchr(line, '[');
-            if (bracket != NULL) {
-                char *end = strchr(bracket, ']');
-                if (end != NULL) {
-                    *end = '\0';
-                    bracket++;
-                    if (*bracket != '\0' && *bracket != ']') {
-                        char *token = strtok(bracket, ",");
-                        while (token != NULL && *dep_count < MAX_DEPS) {
-                            while (*token == ' ')
-                                token++;
-                            char *token_end = token + strlen(token) - 1;
-                            while (token_end > token && (*token_end == ' ' || *token_end == '\n')) {
-                                *token_end = '\0';
-                                token_end--;
-                            }
-                            if (*token != '\0') {
-                                strncpy(deps[*dep_count], token, MAX_PATH - 1);
-                                deps[*dep_count][MAX_PATH - 1] = '\0';
-                                (*dep_count)++;
-                            }
-                            token = strtok(NULL, ",");
-                        }
-                    }
-                }
-            }
-            break;
-        }
-    }
-
-    fclose(file);
-    return 0;
-}
-
-static int has_dep(char deps[MAX_DEPS][MAX_PATH], int dep_count, const char *dep_id)
-{
-    for (int i = 0; i < dep_count; i++) {
-        if (strcmp(deps[i], dep_id) == 0) {
-            return 1;
-        }
-    }
-    return 0;
-}
-
-static int add_dep_to_file(const char *file_path, const char *dep_id)
-{
-    char existing_deps[MAX_DEPS][MAX_PATH];
-    int dep_count = 0;
-
-    if (parse_deps(file_path, existing_deps, &dep_count) != 0) {
-        fprintf(stderr, "Error: cannot read ticket file\n");
-        return 1;
-    }
-
-    if (has_dep(existing_deps, dep_count, dep_id)) {
-        return 0;
-    }
-
-    FILE *file = fopen(file_path, "r");
-    if (file == NULL) {
-        fprintf(stderr, "Error: cannot read ticket file\n");
-        return 1;
-    }
-
-    char temp_path[MAX_PATH];
-    snprintf(temp_path, sizeof(temp_path), "%s.tmp", file_path);
-    FILE *temp_file = fopen(temp_path, "w");
-    if (temp_file == NULL) {
-        fclose(file);
-        fprintf(stderr, "Error: cannot write temp file\n");
-        return 1;
-    }
-
-    char line[1024];
-    int in_frontmatter = 0;
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (strcmp(line, "---\n") == 0) {
-            fprintf(temp_file, "%s", line);
-            in_frontmatter = !in_frontmatter;
-            continue;
-        }
-
-        if (in_frontmatter && strncmp(line, "deps:", 5) == 0) {
-            char *bracket = strchr(line, '[');
-            if (bracket != NULL) {
-                char *end = strchr(bracket, ']');
-                if (end != NULL) {
-                    *end = '\0';
-                    if (bracket[1] == ']' || bracket[1] == '\0') {
-                        fprintf(temp_file, "deps: [%s]\n", dep_id);
-                    } else {
-                        fprintf(temp_file, "%s, %s]\n", line, dep_id);
-                    }
-                    continue;
-                }
-            }
-        }
-        fprintf(temp_file, "%s", line);
-    }
-
-    fclose(file);
-    fclose(temp_file);
-
-    if (rename(temp_path, file_path) != 0) {
-        fprintf(stderr, "Error: cannot update ticket file\n");
-        unlink(temp_path);
-        return 1;
-    }
-
-    return 0;
-}
-
-static int remove_dep_from_file(const char *file_path, const char *dep_id)
-{
-    FILE *file = fopen(file_path, "r");
-    if (file == NULL) {
-        fprintf(stderr, "Error: cannot read ticket file\n");
-        return 1;
-    }
-
-    char temp_path[MAX_PATH];
-    snprintf(temp_path, sizeof(temp_path), "%s.tmp", file_path);
-    FILE *temp_file = fopen(temp_path, "w");
-    if (temp_file == NULL) {
-        fclose(file);
-        fprintf(stderr, "Error: cannot write temp file\n");
-        return 1;
-    }
-
-    char line[1024];
-    int in_frontmatter = 0;
-    while (fgets(line, sizeof(line), file) != NULL) {
-        if (strcmp(line, "---\n") == 0) {
-            fprintf(temp_file, "%s", line);
-            in_frontmatter = !in_frontmatter;
-            continue;
-        }
-
-        if (in_frontmatter && strncmp(line, "deps:", 5) == 0) {
-            char existing_deps[MAX_DEPS][MAX_PATH];
-            int dep_count = 0;
-
-            char *bracket = strchr(line, '[');
-            if (bracket != NULL) {
-                char *end = strchr(bracket, ']');
-                if (end != NULL) {
-                    *end = '\0';
-                    bracket++;
-                    if (*bracket != '\0' && *bracket != ']') {
-                        char *token = strtok(bracket, ",");
-                        while (token != NULL && dep_count < MAX_DEPS) {
-                            while (*token == ' ')
-                                token++;
-                            char *token_end = token + strlen(token) - 1;
-                            while (token_end > token && (*token_end == ' ' || *token_end == '\n')) {
-                                *token_end = '\0';
-                                token_end--;
-                            }
-                            if (*token != '\0' && strcmp(token, dep_id) != 0) {
-                                strncpy(existing_deps[dep_count], token, MAX_PATH - 1);
-                                existing_deps[dep_count][MAX_PATH - 1] = '\0';
-                                dep_count++;
-                            }
-                            token = strtok(NULL, ",");
-                        }
-                    }
-                }
-            }
-
-            fprintf(temp_file, "deps: [");
-            for (int i = 0; i < dep_count; i++) {
-                if (i > 0)
-                    fprintf(temp_file, ", ");
-                fprintf(temp_file, "%s", existing_deps[i]);
-            }
-            fprintf(temp_file, "]\n");
-            continue;
-        }
-        fprintf(temp_file, "%s", line);
-    }
-
-    fclose(file);
-    fclose(temp_file);
-
-    if (rename(temp_path, file_path) != 0) {
-        fprintf(stderr, "Error: cannot update ticket file\n");
-        unlink(temp_path);
-        return 1;
+    } else {
+        printf("Edit ticket file: %s\n", resolved_path);
     }
 
     return 0;
 }
 
-static int cmd_link(int argc, char *argv[])
+/* Whether text occurs anywhere in the size bytes at data. */
+static int contains_text(const char *data, size_t size, const char *text)
 {
-    if (argc < 3) {
-        fprintf(stderr, "Error: at least two ticket IDs required\n");
-        return 1;
-    }
-
-    int num_tickets = argc - 1;
-    char resolved_paths[MAX_TICKETS][MAX_PATH];
-    char ticket_ids[MAX_TICKETS][MAX_PATH];
-
-    for (int i = 0; i < num_tickets; i++) {
-        if (resolve_ticket_id(argv[i + 1], resolved_paths[i], sizeof(resolved_paths[i])) != 0) {
-            return 1;
-        }
-
-        const char *basename = strrchr(resolved_paths[i], '/');
-        basename = basename ? basename + 1 : resolved_paths[i];
-        snprintf(ticket_ids[i], sizeof(ticket_ids[i]), "%.*s", (int)(strlen(basename) - 3),
-                 basename);
-    }
-
-    int total_added = 0;
-
-    for (int i = 0; i < num_tickets; i++) {
-        for (int j = 0; j < num_tickets; j++) {
-            if (i != j) {
-                char existing_links[MAX_LINKS][MAX_PATH];
-                int link_count = 0;
-
-                if (parse_links(resolved_paths[i], existing_links, &link_count) != 0) {
-                    return 1;
-                }
-
-                if (!has_link(existing_links, link_count, ticket_ids[j])) {
-                    if (add_link_to_file(resolved_paths[i], ticket_ids[j]) != 0) {
-                        return 1;
-                    }
-                    total_added++;
-                }
-            }
-        }
-    }
-
-    if (total_added == 0) {
-        printf("All links already exist\n");
-    } else {
-        printf("Added %d link(s) between %d tickets\n", total_added, num_tickets);
-    }
-
-    return 0;
-}
-
-static int cmd_unlink(int argc, char *argv[])
-{
-    if (argc != 3) {
-        fprintf(stderr, "Error: exactly two ticket IDs required\n");
-        return 1;
-    }
-
-    char resolved_path1[MAX_PATH];
-    if (resolve_ticket_id(argv[1], resolved_path1, sizeof(resolved_path1)) != 0) {
-        return 1;
-    }
-
-    char resolved_path2[MAX_PATH];
-    if (resolve_ticket_id(argv[2], resolved_path2, sizeof(resolved_path2)) != 0) {
-        return 1;
-    }
-
-    char id1[MAX_PATH], id2[MAX_PATH];
-    const char *basename1 = strrchr(resolved_path1, '/');
-    basename1 = basename1 ? basename1 + 1 : resolved_path1;
-    snprintf(id1, sizeof(id1), "%.*s", (int)(strlen(basename1) - 3), basename1);
-
-    const char *basename2 = strrchr(resolved_path2, '/');
-    basename2 = basename2 ? basename2 + 1 : resolved_path2;
-    snprintf(id2, sizeof(id2), "%.*s", (int)(strlen(basename2) - 3), basename2);
-
-    char existing_links[MAX_LINKS][MAX_PATH];
-    int link_count = 0;
-
-    if (parse_links(resolved_path1, existing_links, &link_count) != 0) {
-        fprintf(stderr, "Error: cannot read ticket file\n");
-        return 1;
-    }
-
-    if (!has_link(existing_links, link_count, id2)) {
-        printf("Link not found\n");
-        return 1;
-    }
-
-    if (remove_link_from_file(resolved_path1, id2) != 0) {
-        return 1;
-    }
-
-    if (remove_link_from_file(resolved_path2, id1) != 0) {
-        return 1;
-    }
-
-    printf("Removed link: %s <-> %s\n", id1, id2);
-    return 0;
-}
-
-static int cmd_edit(int argc, char *argv[])
-{
-    if (argc < 2) {
-        fprintf(stderr, "Usage: ticket edit <id>\n");
-        return 1;
-    }
-
-    char resolved_path[MAX_PATH];
-    if (resolve_ticket_id(argv[1], resolved_path, sizeof(resolved_path)) != 0) {
-        return 1;
-    }
-
-    if (isatty(STDIN_FILENO) && isatty(STDOUT_FILENO)) {
-        const char *editor = getenv("EDITOR");
-        if (editor == NULL) {
-            editor = "vi";
+    size_t len = strlen(text);
+    const char *end = data + size;
+    const char *p = data;
+    while ((size_t)(end - p) >= len) {
+        p = memchr(p, text[0], (size_t)(end - p) - len + 1);
+        if (p == NULL) {
+            return 0;
         }
-
-        pid_t pid = fork();
-        if (pid == -1) {
-            fprintf(stderr, "Error: failed to fork process\n");
+        if (memcmp(p, text, len) == 0) {
             return 1;
         }
-
-        if (pid == 0) {
-            execlp(editor, editor, resolved_path, (char *)NULL);
-            fprintf(stderr, "Error: failed to execute editor '%s'\n", editor);
-            exit(1);
-        } else {
-            int status;
-            if (waitpid(pid, &status, 0) == -1) {
-                fprintf(stderr, "Error: failed to wait for editor process\n");
-                return 1;
-            }
-            if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
-                return 1;
-            }
-        }
-    } else {
-        printf("Edit ticket file: %s\n", resolved_path);
+        p++;
     }
-
     return 0;
 }
 
@@ -1293,39 +890,47 @@ static int cmd_add_note(int argc, char *argv[])
     char timestamp[64];
     get_iso_date(timestamp, sizeof(timestamp));
 
-    FILE *file = fopen(resolved_path, "r");
-    if (file == NULL) {
+    /* Notes always go at the end of the file, so the ticket is only scanned for an existing
+     * Notes heading and never rewritten; whatever it already holds is left untouched. The lock
+     * keeps a concurrent rewrite from replacing the file between the scan and the append. */
+    FileLock lock;
+    if (lock_ticket_file(&lock, resolved_path) != 0) {
+        return 1;
+    }
+    TicketFile file;
+    if (ticket_file_open(&file, resolved_path) != 0) {
         fprintf(stderr, "Error: cannot read ticket file\n");
+        file_lock_release(&lock);
         return 1;
     }
+    int has_notes = contains_text(file.data, file.size, "## Notes");
+    ticket_file_close(&file);
 
-    char content[65536];
-    size_t content_len = 0;
-    size_t bytes_read;
-    while ((bytes_read = fread(content + content_len, 1, sizeof(content) - content_len - 1, file)) >
-           0) {
-        content_len += bytes_read;
+    OutBuf out;
+    int fd = open(resolved_path, O_WRONLY | O_APPEND);
+    int failed = fd < 0 || out_buf_init(&out, fd) != 0;
+    if (!failed) {
+        /* The entry fits the buffer, so it reaches the file in a single append. */
+        if (!has_notes) {
+            out_buf_puts(&out, "\n## Notes\n");
+        }
+        out_buf_puts(&out, "\n**");
+        out_buf_puts(&out, timestamp);
+        out_buf_puts(&out, "**\n\n");
+        out_buf_puts(&out, note);
+        out_buf_putc(&out, '\n');
     }
-    content[content_len] = '\0';
-    fclose(file);
-
-    if (strstr(content, "## Notes") == NULL) {
-        strncat(content, "\n## Notes\n", sizeof(content) - strlen(content) - 1);
+    if (fd >= 0) {
+        failed |= out_buf_close(&out);
+        failed |= atomic_write_sync_fd(fd);
+        failed |= close(fd) != 0;
     }
-
-    char note_entry[4096];
-    snprintf(note_entry, sizeof(note_entry), "\n**%s**\n\n%s\n", timestamp, note);
-    strncat(content, note_entry, sizeof(content) - strlen(content) - 1);
-
-    file = fopen(resolved_path, "w");
-    if (file == NULL) {
+    file_lock_release(&lock);
+    if (failed) {
         fprintf(stderr, "Error: cannot write ticket file\n");
         return 1;
     }
 
-    fputs(content, file);
-    fclose(file);
-
     printf("Note added to %s\n", target_id);
     return 0;
 }
@@ -1357,177 +962,24 @@ static int cmd_undep(int argc, char *argv[])
     char dep_id[MAX_PATH];
     snprintf(dep_id, sizeof(dep_id), "%.*s", (int)(strlen(basename2) - 3), basename2);
 
-    char existing_deps[MAX_DEPS][MAX_PATH];
-    int dep_count = 0;
-
-    if (parse_deps(resolved_path, existing_deps, &dep_count) != 0) {
-        fprintf(stderr, "Error: cannot read ticket file\n");
+    int removed;
+    if (patch_ticket_line(resolved_path, FRONTMATTER_LIST_REMOVE, "deps", dep_id, &removed) != 0) {
         return 1;
     }
 
-    if (!has_dep(existing_deps, dep_count, dep_id)) {
+    if (!removed) {
         printf("Dependency not found\n");
         return 1;
     }
 
-    if (remove_dep_from_file(resolved_path, dep_id) != 0) {
-        return 1;
-    }
-
     printf("Removed dependency: %s -/-> %s\n", ticket_id, dep_id);
     return 0;
 }
 
-static int load_all_tickets(Ticket *tickets, int *ticket_count)
-{
-    DIR *dir = opendir(TICKETS_DIR);
-    if (dir == NULL) {
-        return 1;
-    }
-
-    *ticket_count = 0;
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL && *ticket_count < MAX_TICKETS) {
-        if (entry->d_name[0] == '.') {
-            continue;
-        }
-
-        size_t len = strlen(entry->d_name);
-        if (len < 4 || strcmp(entry->d_name + len - 3, ".md") != 0) {
-            continue;
-        }
-
-        char file_path[MAX_PATH];
-        snprintf(file_path, sizeof(file_path), "%s/%s", TICKETS_DIR, entry->d_name);
-
-        FILE *file = fopen(file_path, "r");
-        if (file == NULL) {
-            continue;
-        }
-
-        Ticket *t = &tickets[*ticket_count];
-        snprintf(t->id, sizeof(t->id), "%.*s", (int)(len - 3), entry->d_name);
-        strcpy(t->status, "open");
-        strcpy(t->title, "");
-        t->dep_count = 0;
-        t->link_count = 0;
-        t->parent[0] = '\0';
-        t->priority = 2;
-        t->subtree_depth = 0;
-        t->visited = 0;
-
-        char line[1024];
-        int in_frontmatter = 0;
-        int got_title = 0;
-
-        while (fgets(line, sizeof(line), file) != NULL) {
-            if (strcmp(line, "---\n") == 0) {
-                in_frontmatter = !in_frontmatter;
-                continue;
-            }
-
-            if (in_frontmatter) {
-                if (strncmp(line, "status:", 7) == 0) {
-                    sscanf(line, "status: %63s", t->status);
-                } else if (strncmp(line, "priority:", 9) == 0) {
-                    sscanf(line, "priority: %d", &t->priority);
-                } else if (strncmp(line, "parent:", 7) == 0) {
-                    char *val = line + 7;
-                    while (*val == ' ')
-                        val++;
-                    strncpy(t->parent, val, sizeof(t->parent) - 1);
-                    t->parent[sizeof(t->parent) - 1] = '\0';
-                    size_t parent_len = strlen(t->parent);
-                    if (parent_len > 0 && t->parent[parent_len - 1] == '\n') {
-                        t->parent[parent_len - 1] = '\0';
-                    }
-                } else if (strncmp(line, "deps:", 5) == 0) {
-                    char *bracket = strchr(line, '[');
-                    if (bracket != NULL) {
-                        char *end = strchr(bracket, ']');
-                        if (end != NULL) {
-                            *end = '\0';
-                            bracket++;
-                            if (*bracket != '\0' && *bracket != ']') {
-                                char *token = strtok(bracket, ",");
-                                while (token != NULL && t->dep_count < MAX_DEPS) {
-                                    while (*token == ' ')
-                                        token++;
-                                    char *token_end = token + strlen(token) - 1;
-                                    while (token_end > token && *token_end == ' ') {
-                                        *token_end = '\0';
-                                        token_end--;
-                                    }
-                                    if (*token != '\0') {
-                                        strncpy(t->deps[t->dep_count], token, MAX_PATH - 1);
-                                        t->deps[t->dep_count][MAX_PATH - 1] = '\0';
-                                        t->dep_count++;
-                                    }
-                                    token = strtok(NULL, ",");
-                                }
-                            }
-                        }
-                    }
-                } else if (strncmp(line, "links:", 6) == 0) {
-                    char *bracket = strchr(line, '[');
-                    if (bracket != NULL) {
-                        char *end = strchr(bracket, ']');
-                        if (end != NULL) {
-                            *end = '\0';
-                            bracket++;
-                            if (*bracket != '\0' && *bracket != ']') {
-                                char *token = strtok(bracket, ",");
-                                while (token != NULL && t->link_count < MAX_LINKS) {
-                                    while (*token == ' ')
-                                        token++;
-                                    char *token_end = token + strlen(token) - 1;
-                                    while (token_end > token && *token_end == ' ') {
-                                        *token_end = '\0';
-                                        token_end--;
-                                    }
-                                    if (*token != '\0') {
-                                        strncpy(t->links[t->link_count], token, MAX_PATH - 1);
-                                        t->links[t->link_count][MAX_PATH - 1] = '\0';
-                                        t->link_count++;
-                                    }
-                                    token = strtok(NULL, ",");
-                                }
-                            }
-                        }
-                    }
-                }
-            } else if (!got_title && strncmp(line, "# ", 2) == 0) {
-                size_t title_len = strlen(line + 2);
-                if (title_len > 0 && line[2 + title_len - 1] == '\n') {
-                    title_len--;
-                }
-                snprintf(t->title, sizeof(t->title), "%.*s", (int)title_len, line + 2);
-                got_title = 1;
-            }
-        }
-
-        fclose(file);
-        (*ticket_count)++;
-    }
-
-    closedir(dir);
-    return 0;
-}
-
-static int find_ticket(Ticket *tickets, int ticket_count, const char *id)
-{
-    for (int i = 0; i < ticket_count; i++) {
-        if (strcmp(tickets[i].id, id) == 0) {
-            return i;
-        }
-    }
-    return -1;
-}
-
 static int ticket_compare_by_priority_and_id(const void *a, const void *b)
 {
-    const Ticket *t1 = (const Ticket *)a;
-    const Ticket *t2 = (const Ticket *)b;
+    const Ticket *t1 = *(const Ticket *const *)a;
+    const Ticket *t2 = *(const Ticket *const *)b;
 
     if (t1->priority != t2->priority) {
         return t1->priority - t2->priority;
@@ -1536,97 +988,109 @@ static int ticket_compare_by_priority_and_id(const void *a, const void *b)
     return strcmp(t1->id, t2->id);
 }
 
-static int ticket_is_ready(const Ticket *ticket, Ticket *all_tickets, int ticket_count)
+/* Listings go through an OutBuf on stdout. Returns non-zero, after saying so, if any of the
+ * output was lost. */
+static int close_listing(OutBuf *out)
 {
-    if (strcmp(ticket->status, "open") != 0 && strcmp(ticket->status, "in_progress") != 0) {
-        return 0;
+    if (out_buf_close(out) != 0) {
+        fprintf(stderr, "Error: failed to write output\n");
+        return 1;
     }
+    return 0;
+}
 
-    for (int i = 0; i < ticket->dep_count; i++) {
-        int dep_idx = find_ticket(all_tickets, ticket_count, ticket->deps[i]);
-        if (dep_idx < 0) {
-            return 0;
-        }
-        if (strcmp(all_tickets[dep_idx].status, "closed") != 0) {
-            return 0;
+static void print_ls_ticket(OutBuf *out, const Ticket *t)
+{
+    out_buf_pad(out, t->id, 8);
+    out_buf_puts(out, " [");
+    out_buf_puts(out, t->status);
+    out_buf_puts(out, "] - ");
+    out_buf_puts(out, t->title);
+
+    if (t->dep_count > 0) {
+        out_buf_puts(out, " <- [");
+        for (int j = 0; j < t->dep_count; j++) {
+            if (j > 0)
+                out_buf_puts(out, ", ");
+            out_buf_puts(out, t->deps[j]);
         }
+        out_buf_putc(out, ']');
     }
-
-    return 1;
 }
 
-static int ticket_is_blocked(const Ticket *ticket, Ticket *all_tickets, int ticket_count)
+static int ls_ticket_shows(const Ticket *t, const char *status_filter)
 {
-    if (strcmp(ticket->status, "open") != 0 && strcmp(ticket->status, "in_progress") != 0) {
-        return 0;
-    }
-
-    if (ticket->dep_count == 0) {
-        return 0;
-    }
+    return status_filter[0] == '\0' || strcmp(t->status, status_filter) == 0;
+}
 
-    for (int i = 0; i < ticket->dep_count; i++) {
-        int dep_idx = find_ticket(all_tickets, ticket_count, ticket->deps[i]);
-        if (dep_idx < 0) {
-            return 1;
-        }
-        if (strcmp(all_tickets[dep_idx].status, "closed") != 0) {
-            return 1;
-        }
-    }
+/* The WatchListing callbacks for ls. */
+static void print_ls_line(OutBuf *out, const TicketStore *store, const TicketGraph *graph,
+                          int ticket)
+{
+    (void)graph;
+    print_ls_ticket(out, store->tickets[ticket]);
+}
 
-    return 0;
+static int ls_shows(const TicketStore *store, const TicketGraph *graph, int ticket,
+                    const void *ctx)
+{
+    (void)graph;
+    return ls_ticket_shows(store->tickets[ticket], ctx);
 }
 
 static int cmd_ls(int argc, char *argv[])
 {
-    Ticket *tickets = malloc(sizeof(Ticket) * MAX_TICKETS);
-    if (tickets == NULL) {
-        fprintf(stderr, "Error: out of memory\n");
-        return 1;
-    }
-
-    int ticket_count = 0;
-
-    if (load_all_tickets(tickets, &ticket_count) != 0) {
-        free(tickets);
-        return 0;
-    }
-
     char status_filter[64] = "";
+    int watch = 0;
     for (int i = 1; i < argc; i++) {
         if (strncmp(argv[i], "--status=", 9) == 0) {
             strncpy(status_filter, argv[i] + 9, sizeof(status_filter) - 1);
             status_filter[sizeof(status_filter) - 1] = '\0';
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            watch = 1;
         }
     }
+    if (watch) {
+        WatchListing listing = {ls_shows, print_ls_line, ticket_compare_by_priority_and_id,
+                                status_filter};
+        return watch_listing(&listing);
+    }
 
-    qsort(tickets, ticket_count, sizeof(Ticket), ticket_compare_by_priority_and_id);
-
-    for (int i = 0; i < ticket_count; i++) {
-        Ticket *t = &tickets[i];
-
-        if (status_filter[0] != '\0' && strcmp(t->status, status_filter) != 0) {
-            continue;
-        }
-
-        printf("%-8s [%s] - %s", t->id, t->status, t->title);
+    TicketStore store;
+    if (load_all_tickets(&store) != 0) {
+        ticket_store_free(&store);
+        return 0;
+    }
 
-        if (t->dep_count > 0) {
-            printf(" <- [");
-            for (int j = 0; j < t->dep_count; j++) {
-                if (j > 0)
-                    printf(", ");
-                printf("%s", t->deps[j]);
-            }
-            printf("]");
+    const Ticket **sorted = malloc(sizeof(Ticket *) * (size_t)(store.count + 1));
+    OutBuf out;
+    if (out_buf_init(&out, STDOUT_FILENO) != 0 || sorted == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        out_buf_close(&out);
+        free(sorted);
+        ticket_store_free(&store);
+        return 1;
+    }
+    int shown = 0;
+    for (int i = 0; i < store.count; i++) {
+        if (ls_ticket_shows(store.tickets[i], status_filter)) {
+            sorted[shown++] = store.tickets[i];
         }
+    }
 
-        printf("\n");
+    qsort(sorted, (size_t)shown, sizeof(Ticket *), ticket_compare_by_priority_and_id);
+
+    TRACE_BEGIN(output);
+    for (int i = 0; i < shown; i++) {
+        print_ls_ticket(&out, sorted[i]);
+        out_buf_putc(&out, '\n');
     }
+    int rc = close_listing(&out);
+    TRACE_END(TRACE_OUTPUT, output);
 
-    free(tickets);
-    return 0;
+    free(sorted);
+    ticket_store_free(&store);
+    return rc;
 }
 
 static int cmd_list(int argc, char *argv[])
@@ -1634,49 +1098,94 @@ static int cmd_list(int argc, char *argv[])
     return cmd_ls(argc, argv);
 }
 
-static int cmd_ready(int argc, char *argv[])
+/* The "id [Pn][status] - title" head shared by ready and blocked lines. */
+static void print_ticket_head(OutBuf *out, const Ticket *t)
 {
-    (void)argc;
-    (void)argv;
+    out_buf_pad(out, t->id, 8);
+    out_buf_puts(out, " [P");
+    out_buf_int(out, t->priority);
+    out_buf_puts(out, "][");
+    out_buf_puts(out, t->status);
+    out_buf_puts(out, "] - ");
+    out_buf_puts(out, t->title);
+}
 
-    Ticket *tickets = malloc(sizeof(Ticket) * MAX_TICKETS);
-    if (tickets == NULL) {
-        fprintf(stderr, "Error: out of memory\n");
-        return 1;
-    }
+static void print_ready_line(OutBuf *out, const TicketStore *store, const TicketGraph *graph,
+                             int ticket)
+{
+    (void)graph;
+    print_ticket_head(out, store->tickets[ticket]);
+}
+
+static int ready_shows(const TicketStore *store, const TicketGraph *graph, int ticket,
+                       const void *ctx)
+{
+    (void)ctx;
+    return ticket_graph_is_ready(graph, store, ticket);
+}
 
-    int ticket_count = 0;
+static int cmd_ready(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--watch") == 0) {
+            WatchListing listing = {ready_shows, print_ready_line,
+                                    ticket_compare_by_priority_and_id, NULL};
+            return watch_listing(&listing);
+        }
+    }
 
-    if (load_all_tickets(tickets, &ticket_count) != 0) {
-        free(tickets);
+    TicketStore store;
+    if (load_all_tickets(&store) != 0) {
+        ticket_store_free(&store);
         return 0;
     }
 
-    Ticket *ready_tickets = malloc(sizeof(Ticket) * MAX_TICKETS);
-    if (ready_tickets == NULL) {
+    TicketGraph graph;
+    const Ticket **ready_tickets = malloc(sizeof(Ticket *) * (size_t)(store.count + 1));
+    OutBuf out;
+    if (out_buf_init(&out, STDOUT_FILENO) != 0 || ready_tickets == NULL ||
+        ticket_graph_build(&graph, &store) != 0) {
         fprintf(stderr, "Error: out of memory\n");
-        free(tickets);
+        out_buf_close(&out);
+        free(ready_tickets);
+        ticket_store_free(&store);
         return 1;
     }
 
     int ready_count = 0;
 
-    for (int i = 0; i < ticket_count; i++) {
-        if (ticket_is_ready(&tickets[i], tickets, ticket_count)) {
-            ready_tickets[ready_count++] = tickets[i];
+    for (int i = 0; i < store.count; i++) {
+        if (ready_shows(&store, &graph, i, NULL)) {
+            ready_tickets[ready_count++] = store.tickets[i];
         }
     }
+    ticket_graph_free(&graph);
 
-    qsort(ready_tickets, ready_count, sizeof(Ticket), ticket_compare_by_priority_and_id);
+    qsort(ready_tickets, ready_count, sizeof(Ticket *), ticket_compare_by_priority_and_id);
 
+    TRACE_BEGIN(output);
     for (int i = 0; i < ready_count; i++) {
-        Ticket *t = &ready_tickets[i];
-        printf("%-8s [P%d][%s] - %s\n", t->id, t->priority, t->status, t->title);
+        print_ticket_head(&out, ready_tickets[i]);
+        out_buf_putc(&out, '\n');
     }
+    int rc = close_listing(&out);
+    TRACE_END(TRACE_OUTPUT, output);
 
     free(ready_tickets);
-    free(tickets);
-    return 0;
+    ticket_store_free(&store);
+    return rc;
+}
+
+/* A blocked ticket and its store index, which locates its dep edges in the graph. */
+typedef struct {
+    const Ticket *ticket;
+    int index;
+} BlockedTicket;
+
+static int compare_blocked(const void *a, const void *b)
+{
+    return ticket_compare_by_priority_and_id(&((const BlockedTicket *)a)->ticket,
+                                             &((const BlockedTicket *)b)->ticket);
 }
 
 static int cmd_blocked(int argc, char *argv[])
@@ -1684,59 +1193,113 @@ static int cmd_blocked(int argc, char *argv[])
     (void)argc;
     (void)argv;
 
-    Ticket *tickets = malloc(sizeof(Ticket) * MAX_TICKETS);
-    if (tickets == NULL) {
-        fprintf(stderr, "Error: out of memory\n");
-        return 1;
-    }
-
-    int ticket_count = 0;
-
-    if (load_all_tickets(tickets, &ticket_count) != 0) {
-        free(tickets);
+    TicketStore store;
+    if (load_all_tickets(&store) != 0) {
+        ticket_store_free(&store);
         return 0;
     }
 
-    Ticket *blocked_tickets = malloc(sizeof(Ticket) * MAX_TICKETS);
-    if (blocked_tickets == NULL) {
+    TicketGraph graph;
+    BlockedTicket *blocked_tickets = malloc(sizeof(BlockedTicket) * (size_t)(store.count + 1));
+    OutBuf out;
+    if (out_buf_init(&out, STDOUT_FILENO) != 0 || blocked_tickets == NULL ||
+        ticket_graph_build(&graph, &store) != 0) {
         fprintf(stderr, "Error: out of memory\n");
-        free(tickets);
+        out_buf_close(&out);
+        free(blocked_tickets);
+        ticket_store_free(&store);
         return 1;
     }
 
     int blocked_count = 0;
 
-    for (int i = 0; i < ticket_count; i++) {
-        if (ticket_is_blocked(&tickets[i], tickets, ticket_count)) {
-            blocked_tickets[blocked_count++] = tickets[i];
+    for (int i = 0; i < store.count; i++) {
+        if (ticket_graph_is_blocked(&graph, &store, i)) {
+            blocked_tickets[blocked_count].ticket = store.tickets[i];
+            blocked_tickets[blocked_count].index = i;
+            blocked_count++;
         }
     }
 
-    qsort(blocked_tickets, blocked_count, sizeof(Ticket), ticket_compare_by_priority_and_id);
+    qsort(blocked_tickets, (size_t)blocked_count, sizeof(BlockedTicket), compare_blocked);
 
+    TRACE_BEGIN(output);
     for (int i = 0; i < blocked_count; i++) {
-        Ticket *t = &blocked_tickets[i];
-        printf("%-8s [P%d][%s] - %s", t->id, t->priority, t->status, t->title);
+        const Ticket *t = blocked_tickets[i].ticket;
+        print_ticket_head(&out, t);
 
         int first = 1;
-        printf(" <- [");
+        int edges = graph.dep_start[blocked_tickets[i].index];
+        out_buf_puts(&out, " <- [");
         for (int j = 0; j < t->dep_count; j++) {
-            int dep_idx = find_ticket(tickets, ticket_count, t->deps[j]);
-            if (dep_idx < 0 || strcmp(tickets[dep_idx].status, "closed") != 0) {
+            if (ticket_graph_edge_unresolved(&graph, edges + j)) {
                 if (!first)
-                    printf(", ");
-                printf("%s", t->deps[j]);
+                    out_buf_puts(&out, ", ");
+                out_buf_puts(&out, t->deps[j]);
                 first = 0;
             }
         }
-        printf("]\n");
+        out_buf_puts(&out, "]\n");
     }
+    int rc = close_listing(&out);
+    TRACE_END(TRACE_OUTPUT, output);
 
+    ticket_graph_free(&graph);
     free(blocked_tickets);
-    free(tickets);
-    return 0;
+    ticket_store_free(&store);
+    return rc;
+}
+
+/* A ticket file seen by `closed`; names live in the command's arena. */
+typedef struct {
+    const char *name;
+    size_t id_len;
+    FileStamp stamp;
+} ClosedCandidate;
+
+/* Newest first, as `ls -t` lists them: later mtime, then file name. */
+static int candidate_newer(const ClosedCandidate *a, const ClosedCandidate *b)
+{
+    if (a->stamp.mtime_ns != b->stamp.mtime_ns) {
+        return a->stamp.mtime_ns > b->stamp.mtime_ns;
+    }
+    return strcmp(a->name, b->name) < 0;
+}
+
+static void candidate_sift_down(ClosedCandidate *heap, int count, int i)
+{
+    for (;;) {
+        int newest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < count && candidate_newer(&heap[left], &heap[newest])) {
+            newest = left;
+        }
+        if (right < count && candidate_newer(&heap[right], &heap[newest])) {
+            newest = right;
+        }
+        if (newest == i) {
+            return;
+        }
+        ClosedCandidate temp = heap[i];
+        heap[i] = heap[newest];
+        heap[newest] = temp;
+        i = newest;
+    }
+}
+
+/* Removes the newest candidate from a non-empty heap. */
+static ClosedCandidate candidate_pop(ClosedCandidate *heap, int *count)
+{
+    ClosedCandidate newest = heap[0];
+    heap[0] = heap[--*count];
+    candidate_sift_down(heap, *count, 0);
+    return newest;
 }
 
+/* Stats every ticket file, then pops them newest first from a heap until `limit` closed ones
+ * are printed, so only as many files are ordered as are looked at. A file whose stamp matches
+ * .tickets/.index is judged from the index without being opened. */
 static int cmd_closed(int argc, char *argv[])
 {
     int limit = 20;
@@ -1747,21 +1310,21 @@ static int cmd_closed(int argc, char *argv[])
         }
     }
 
+    TRACE_BEGIN(scan);
     DIR *dir = opendir(TICKETS_DIR);
     if (dir == NULL) {
         return 0;
     }
 
-    typedef struct {
-        char path[MAX_PATH];
-        time_t mtime;
-    } FileInfo;
-
-    FileInfo files[MAX_TICKETS];
+    Arena arena;
+    arena_init(&arena);
+    ClosedCandidate *files = NULL;
     int file_count = 0;
+    int file_capacity = 0;
+    int failed = 0;
 
     struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL && file_count < MAX_TICKETS) {
+    while (!failed && (entry = readdir(dir)) != NULL) {
         if (entry->d_name[0] == '.')
             continue;
 
@@ -1773,206 +1336,269 @@ static int cmd_closed(int argc, char *argv[])
         snprintf(file_path, sizeof(file_path), "%s/%s", TICKETS_DIR, entry->d_name);
 
         struct stat st;
-        if (stat(file_path, &st) == 0) {
-            strncpy(files[file_count].path, file_path, MAX_PATH - 1);
-            files[file_count].path[MAX_PATH - 1] = '\0';
-            files[file_count].mtime = st.st_mtime;
-            file_count++;
+        if (stat(file_path, &st) != 0)
+            continue;
+
+        if (file_count == file_capacity) {
+            int new_capacity = file_capacity ? file_capacity * 2 : 256;
+            ClosedCandidate *grown =
+                realloc(files, sizeof(ClosedCandidate) * (size_t)new_capacity);
+            if (grown == NULL) {
+                failed = 1;
+                break;
+            }
+            files = grown;
+            file_capacity = new_capacity;
         }
+        ClosedCandidate *c = &files[file_count];
+        c->name = arena_strndup(&arena, entry->d_name, len);
+        c->id_len = len - 3;
+        file_stamp_from_stat(&c->stamp, &st);
+        failed = c->name == NULL;
+        file_count++;
     }
 
     closedir(dir);
+    TRACE_END(TRACE_SCAN, scan);
 
-    for (int i = 0; i < file_count - 1; i++) {
-        for (int j = i + 1; j < file_count; j++) {
-            if (files[i].mtime < files[j].mtime) {
-                FileInfo temp = files[i];
-                files[i] = files[j];
-                files[j] = temp;
-            }
-        }
+    OutBuf out;
+    if (out_buf_init(&out, STDOUT_FILENO) != 0 || failed) {
+        fprintf(stderr, "Error: out of memory\n");
+        out_buf_close(&out);
+        free(files);
+        arena_free(&arena);
+        return 1;
     }
 
-    int closed_count = 0;
-    int max_check = file_count < 100 ? file_count : 100;
-
-    for (int i = 0; i < max_check && closed_count < limit; i++) {
-        FILE *file = fopen(files[i].path, "r");
-        if (file == NULL)
-            continue;
+    Interner ids;
+    intern_init(&ids, &arena);
+    IndexCache cache;
+    TRACE_BEGIN(index_read);
+    int have_cache = index_cache_enabled() && index_cache_open(&cache, &ids) == 0;
+    TRACE_END(TRACE_INDEX_READ, index_read);
 
-        char ticket_id[MAX_PATH] = "";
-        char status[64] = "open";
-        char title[256] = "";
+    for (int i = file_count / 2 - 1; i >= 0; i--) {
+        candidate_sift_down(files, file_count, i);
+    }
 
-        const char *basename = strrchr(files[i].path, '/');
-        basename = basename ? basename + 1 : files[i].path;
-        size_t basename_len = strlen(basename);
-        snprintf(ticket_id, sizeof(ticket_id), "%.*s", (int)(basename_len - 3), basename);
+    int closed_count = 0;
+    while (file_count > 0 && closed_count < limit) {
+        ClosedCandidate c = candidate_pop(files, &file_count);
 
-        char line[1024];
-        int in_frontmatter = 0;
-        int got_title = 0;
+        const IndexEntry *cached = NULL;
+        if (have_cache) {
+            const char *id = intern_lookup(&ids, c.name, c.id_len);
+            cached = id != NULL ? index_cache_lookup(&cache, id, &c.stamp) : NULL;
+        }
 
-        while (fgets(line, sizeof(line), file) != NULL) {
-            if (strcmp(line, "---\n") == 0) {
-                in_frontmatter = !in_frontmatter;
+        TicketFile file;
+        StrView status = {"open", 4};
+        if (cached != NULL) {
+            TRACE_COUNT(TRACE_INDEX_HITS, 1);
+            status = (StrView){cache.strings + cached->status.offset, cached->status.len};
+        } else {
+            char file_path[MAX_PATH];
+            snprintf(file_path, sizeof(file_path), "%s/%s", TICKETS_DIR, c.name);
+            if (ticket_file_open(&file, file_path) != 0)
                 continue;
-            }
 
-            if (in_frontmatter && strncmp(line, "status:", 7) == 0) {
-                sscanf(line, "status: %63s", status);
-            } else if (!got_title && strncmp(line, "# ", 2) == 0) {
-                size_t title_len = strlen(line + 2);
-                if (title_len > 0 && line[2 + title_len - 1] == '\n') {
-                    title_len--;
+            size_t cursor = 0;
+            StrView key, value;
+            while (frontmatter_next(&file, &cursor, &key, &value)) {
+                if (strview_eq(key, "status")) {
+                    StrView token = strview_token(value);
+                    if (token.len > 0)
+                        status = token;
                 }
-                snprintf(title, sizeof(title), "%.*s", (int)title_len, line + 2);
-                got_title = 1;
             }
         }
 
-        fclose(file);
-
-        if (strcmp(status, "closed") == 0 || strcmp(status, "done") == 0) {
-            printf("%-8s [%s] - %s\n", ticket_id, status, title);
+        if (strview_eq(status, "closed") || strview_eq(status, "done")) {
+            StrView title = cached != NULL ? (StrView){cache.strings + cached->title.offset,
+                                                       cached->title.len}
+                                           : ticket_file_title(&file);
+            out_buf_write(&out, c.name, c.id_len);
+            for (size_t pad = c.id_len; pad < 8; pad++) {
+                out_buf_putc(&out, ' ');
+            }
+            out_buf_puts(&out, " [");
+            out_buf_write(&out, status.ptr, status.len);
+            out_buf_puts(&out, "] - ");
+            out_buf_write(&out, title.ptr, title.len);
+            out_buf_putc(&out, '\n');
             closed_count++;
         }
-    }
-
-    return 0;
-}
-
-static int compute_subtree_depth(Ticket *tickets, int ticket_count, int idx, int path_mask[],
-                                 int path_len)
-{
-    if (idx < 0 || idx >= ticket_count) {
-        return 0;
-    }
 
-    for (int i = 0; i < path_len; i++) {
-        if (path_mask[i] == idx) {
-            return 0;
+        if (cached == NULL) {
+            ticket_file_close(&file);
         }
     }
 
-    if (tickets[idx].visited) {
-        return tickets[idx].subtree_depth;
+    if (have_cache) {
+        index_cache_close(&cache);
     }
+    intern_free(&ids);
+    free(files);
+    arena_free(&arena);
+    return close_listing(&out);
+}
+
+typedef struct {
+    int node;
+    int depth;
+    int is_last;
+    size_t prefix_len;
+} TreeEntry;
 
-    int max_depth = 0;
-    path_mask[path_len] = idx;
+typedef struct {
+    int node;
+    int subtree_depth;
+    const char *id;
+} TreeChild;
 
-    for (int i = 0; i < tickets[idx].dep_count; i++) {
-        int dep_idx = find_ticket(tickets, ticket_count, tickets[idx].deps[i]);
-        if (dep_idx >= 0) {
-            int depth =
-                compute_subtree_depth(tickets, ticket_count, dep_idx, path_mask, path_len + 1);
-            if (depth + 1 > max_depth) {
-                max_depth = depth + 1;
-            }
-        }
+typedef struct {
+    const TicketStore *store;
+    const TicketGraph *graph;
+    const int *max_depth;
+    const int *subtree_depth;
+    unsigned char *printed;
+    unsigned char *on_path;
+    int full_mode;
+    TreeEntry *entries;
+    int entry_count;
+    int entry_capacity;
+    TreeChild *children;
+    char *prefix;
+    size_t prefix_capacity;
+} DepTree;
+
+static int compare_tree_children(const void *a, const void *b)
+{
+    const TreeChild *c1 = a;
+    const TreeChild *c2 = b;
+    if (c1->subtree_depth != c2->subtree_depth) {
+        return c1->subtree_depth < c2->subtree_depth ? -1 : 1;
     }
-
-    tickets[idx].subtree_depth = max_depth;
-    tickets[idx].visited = 1;
-    return max_depth;
+    return strcmp(c1->id, c2->id);
 }
 
-static void print_dep_tree_recursive(Ticket *tickets, int ticket_count, int idx, const char *prefix,
-                                     int is_last, int visited[], int visited_count, int full_mode)
+/* Queues the printable deps of node, shallowest subtree first, so they pop in print order. */
+static int push_tree_children(DepTree *tree, int node, int depth, size_t prefix_len)
 {
-    if (idx < 0)
-        return;
-
-    for (int i = 0; i < visited_count; i++) {
-        if (visited[i] == idx) {
-            return;
+    const TicketGraph *graph = tree->graph;
+    int n = 0;
+    for (int e = graph->dep_start[node]; e < graph->dep_start[node + 1]; e++) {
+        int child = graph->dep_targets[e];
+        if (child < 0 || tree->max_depth[child] < 0 || tree->on_path[child]) {
+            continue;
         }
+        if (!tree->full_mode &&
+            (tree->printed[child] || tree->max_depth[child] != depth + 1)) {
+            continue;
+        }
+        tree->children[n].node = child;
+        tree->children[n].subtree_depth = tree->subtree_depth[child];
+        tree->children[n].id = tree->store->tickets[child]->id;
+        n++;
     }
+    qsort(tree->children, (size_t)n, sizeof(TreeChild), compare_tree_children);
 
-    Ticket *t = &tickets[idx];
-
-    if (strcmp(prefix, "") == 0) {
-        printf("%s [%s] %s\n", t->id, t->status, t->title);
-    } else {
-        const char *connector = is_last ? "└── " : "├── ";
-        printf("%s%s%s [%s] %s\n", prefix, connector, t->id, t->status, t->title);
+    if (tree->entry_count + n > tree->entry_capacity) {
+        int capacity = tree->entry_capacity ? tree->entry_capacity : 256;
+        while (capacity < tree->entry_count + n) {
+            capacity *= 2;
+        }
+        TreeEntry *grown = realloc(tree->entries, sizeof(TreeEntry) * (size_t)capacity);
+        if (grown == NULL) {
+            return 1;
+        }
+        tree->entries = grown;
+        tree->entry_capacity = capacity;
     }
-
-    visited[visited_count] = idx;
-    visited_count++;
-
-    if (t->dep_count == 0) {
-        return;
+    for (int i = n - 1; i >= 0; i--) {
+        TreeEntry *entry = &tree->entries[tree->entry_count++];
+        entry->node = tree->children[i].node;
+        entry->depth = depth + 1;
+        entry->is_last = i == n - 1;
+        entry->prefix_len = prefix_len;
     }
+    return 0;
+}
 
-    int dep_indices[MAX_DEPS];
-    int sorted_positions[MAX_DEPS];
-    for (int i = 0; i < t->dep_count; i++) {
-        dep_indices[i] = find_ticket(tickets, ticket_count, t->deps[i]);
-        sorted_positions[i] = i;
+static int append_tree_prefix(DepTree *tree, size_t prefix_len, const char *indent)
+{
+    size_t len = strlen(indent);
+    if (prefix_len + len + 1 > tree->prefix_capacity) {
+        size_t capacity = tree->prefix_capacity ? tree->prefix_capacity : 256;
+        while (capacity < prefix_len + len + 1) {
+            capacity *= 2;
+        }
+        char *grown = realloc(tree->prefix, capacity);
+        if (grown == NULL) {
+            return 1;
+        }
+        tree->prefix = grown;
+        tree->prefix_capacity = capacity;
     }
+    memcpy(tree->prefix + prefix_len, indent, len);
+    return 0;
+}
 
-    for (int i = 0; i < t->dep_count - 1; i++) {
-        for (int j = i + 1; j < t->dep_count; j++) {
-            int idx_i = dep_indices[sorted_positions[i]];
-            int idx_j = dep_indices[sorted_positions[j]];
-
-            if (idx_i < 0 && idx_j >= 0) {
-                int temp = sorted_positions[i];
-                sorted_positions[i] = sorted_positions[j];
-                sorted_positions[j] = temp;
-            } else if (idx_i >= 0 && idx_j >= 0) {
-                Ticket *t_i = &tickets[idx_i];
-                Ticket *t_j = &tickets[idx_j];
-
-                int should_swap = 0;
-                if (t_i->subtree_depth != t_j->subtree_depth) {
-                    should_swap = t_i->subtree_depth < t_j->subtree_depth;
-                } else {
-                    should_swap = strcmp(t_i->id, t_j->id) > 0;
-                }
+static void print_tree_line(OutBuf *out, const Ticket *t)
+{
+    out_buf_puts(out, t->id);
+    out_buf_puts(out, " [");
+    out_buf_puts(out, t->status);
+    out_buf_puts(out, "] ");
+    out_buf_puts(out, t->title);
+    out_buf_putc(out, '\n');
+}
 
-                if (should_swap) {
-                    int temp = sorted_positions[i];
-                    sorted_positions[i] = sorted_positions[j];
-                    sorted_positions[j] = temp;
-                }
-            }
-        }
+/* Pre-order walk with an explicit stack. Each entry records how much of the shared prefix
+ * buffer belongs to it, and path[] holds the ancestors of the entry being printed. */
+static int print_dep_tree(DepTree *tree, OutBuf *out, int root, int *path)
+{
+    Ticket **tickets = tree->store->tickets;
+    print_tree_line(out, tickets[root]);
+    tree->printed[root] = 1;
+    tree->on_path[root] = 1;
+    path[0] = root;
+    int path_len = 1;
+    if (push_tree_children(tree, root, 0, 0) != 0) {
+        return 1;
     }
 
-    char new_prefix[MAX_PATH * 2];
-    for (int i = 0; i < t->dep_count; i++) {
-        int dep_pos = sorted_positions[i];
-        int dep_idx = dep_indices[dep_pos];
+    while (tree->entry_count > 0) {
+        TreeEntry entry = tree->entries[--tree->entry_count];
+        while (path_len > entry.depth) {
+            tree->on_path[path[--path_len]] = 0;
+        }
 
-        if (dep_idx < 0)
+        int node = entry.node;
+        if (tree->on_path[node]) {
             continue;
-
-        int is_last_child = (i == t->dep_count - 1);
-        if (!full_mode) {
-            is_last_child = 1;
-            for (int j = i + 1; j < t->dep_count; j++) {
-                if (dep_indices[sorted_positions[j]] >= 0) {
-                    is_last_child = 0;
-                    break;
-                }
-            }
         }
-
-        if (strcmp(prefix, "") == 0) {
-            strcpy(new_prefix, "");
-        } else if (is_last) {
-            snprintf(new_prefix, sizeof(new_prefix), "%s    ", prefix);
-        } else {
-            snprintf(new_prefix, sizeof(new_prefix), "%s│   ", prefix);
+        if (!tree->full_mode &&
+            (tree->printed[node] || entry.depth != tree->max_depth[node])) {
+            continue;
         }
 
-        print_dep_tree_recursive(tickets, ticket_count, dep_idx, new_prefix, is_last_child, visited,
-                                 visited_count, full_mode);
+        out_buf_write(out, tree->prefix, entry.prefix_len);
+        out_buf_puts(out, entry.is_last ? "└── " : "├── ");
+        print_tree_line(out, tickets[node]);
+        tree->printed[node] = 1;
+
+        const char *indent = entry.is_last ? "    " : "│   ";
+        if (append_tree_prefix(tree, entry.prefix_len, indent) != 0) {
+            return 1;
+        }
+        tree->on_path[node] = 1;
+        path[path_len++] = node;
+        if (push_tree_children(tree, node, entry.depth, entry.prefix_len + strlen(indent)) != 0) {
+            return 1;
+        }
     }
+    return 0;
 }
 
 static int cmd_dep_tree(int argc, char *argv[])
@@ -1993,124 +1619,160 @@ static int cmd_dep_tree(int argc, char *argv[])
         return 1;
     }
 
-    Ticket *tickets = malloc(sizeof(Ticket) * MAX_TICKETS);
-    if (tickets == NULL) {
-        fprintf(stderr, "Error: out of memory\n");
-        return 1;
-    }
-
-    int ticket_count = 0;
-
-    if (load_all_tickets(tickets, &ticket_count) != 0) {
+    TicketStore store;
+    if (load_all_tickets(&store) != 0) {
         fprintf(stderr, "Error: cannot load tickets\n");
-        free(tickets);
+        ticket_store_free(&store);
         return 1;
     }
 
-    int root_idx = -1;
-    int match_count = 0;
+    Ticket **tickets = store.tickets;
+    int ticket_count = store.count;
+
+    IdMatches matches;
+    id_matches_init(&matches, root_id);
     for (int i = 0; i < ticket_count; i++) {
-        if (strstr(tickets[i].id, root_id) != NULL) {
-            root_idx = i;
-            match_count++;
-        }
+        id_matches_offer(&matches, tickets[i]->id, strlen(tickets[i]->id));
     }
-
-    if (match_count == 0) {
-        fprintf(stderr, "Error: ticket '%s' not found\n", root_id);
-        free(tickets);
+    const char *root_match = id_matches_resolve(&matches);
+    int root_idx = root_match == NULL ? -1 : find_ticket(&store, root_match);
+    id_matches_free(&matches);
+    if (root_idx < 0) {
+        ticket_store_free(&store);
         return 1;
     }
 
-    if (match_count > 1) {
-        fprintf(stderr, "Error: ambiguous ID '%s' matches multiple tickets\n", root_id);
-        free(tickets);
+    TicketGraph graph;
+    if (ticket_graph_build(&graph, &store) != 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        ticket_store_free(&store);
         return 1;
     }
 
-    int path_mask[MAX_TICKETS];
-    for (int i = 0; i < ticket_count; i++) {
-        tickets[i].visited = 0;
-    }
+    int max_deps = 0;
     for (int i = 0; i < ticket_count; i++) {
-        compute_subtree_depth(tickets, ticket_count, i, path_mask, 0);
+        if (tickets[i]->dep_count > max_deps) {
+            max_deps = tickets[i]->dep_count;
+        }
+    }
+
+    DepTree tree;
+    memset(&tree, 0, sizeof(tree));
+    tree.store = &store;
+    tree.graph = &graph;
+    tree.full_mode = full_mode;
+    int *depths = malloc(sizeof(int) * 3 * (size_t)ticket_count);
+    unsigned char *flags = calloc(2 * (size_t)ticket_count, 1);
+    tree.children = malloc(sizeof(TreeChild) * (size_t)(max_deps + 1));
+    int rc = depths == NULL || flags == NULL || tree.children == NULL;
+    if (rc == 0) {
+        tree.max_depth = depths;
+        tree.subtree_depth = depths + ticket_count;
+        tree.printed = flags;
+        tree.on_path = flags + ticket_count;
+        rc = ticket_graph_tree_depths(&graph, root_idx, depths, depths + ticket_count);
+    }
+    OutBuf out;
+    if (rc == 0 && out_buf_init(&out, STDOUT_FILENO) != 0) {
+        out_buf_close(&out);
+        rc = 1;
+    }
+    if (rc == 0) {
+        TRACE_BEGIN(output);
+        rc = print_dep_tree(&tree, &out, root_idx, depths + 2 * ticket_count);
+        if (rc != 0) {
+            fprintf(stderr, "Error: out of memory\n");
+        }
+        /* The lines printed before running out of memory are still written. */
+        if (close_listing(&out) != 0) {
+            rc = 1;
+        }
+        TRACE_END(TRACE_OUTPUT, output);
+    } else {
+        fprintf(stderr, "Error: out of memory\n");
     }
 
-    int visited[MAX_TICKETS];
-    print_dep_tree_recursive(tickets, ticket_count, root_idx, "", 1, visited, 0, full_mode);
-
-    free(tickets);
-    return 0;
+    free(tree.entries);
+    free(tree.children);
+    free(tree.prefix);
+    free(flags);
+    free(depths);
+    ticket_graph_free(&graph);
+    ticket_store_free(&store);
+    return rc;
 }
 
-static void escape_json_string(const char *str, char *out, size_t out_size)
+static void write_ticket_json(OutBuf *out, const TicketFile *file)
 {
-    size_t j = 0;
-    for (size_t i = 0; str[i] != '\0' && j < out_size - 2; i++) {
-        if (str[i] == '"' || str[i] == '\\') {
-            out[j++] = '\\';
-            if (j >= out_size - 2)
-                break;
-            out[j++] = str[i];
-        } else if (str[i] == '\n') {
-            out[j++] = '\\';
-            if (j >= out_size - 2)
-                break;
-            out[j++] = 'n';
-        } else if (str[i] == '\r') {
-            out[j++] = '\\';
-            if (j >= out_size - 2)
-                break;
-            out[j++] = 'r';
-        } else if (str[i] == '\t') {
-            out[j++] = '\\';
-            if (j >= out_size - 2)
-                break;
-            out[j++] = 't';
+    out_buf_putc(out, '{');
+    int first_field = 1;
+    size_t cursor = 0;
+    StrView key, value;
+    while (frontmatter_next(file, &cursor, &key, &value)) {
+        if (!first_field) {
+            out_buf_putc(out, ',');
+        }
+        first_field = 0;
+        out_buf_json_string(out, key);
+        out_buf_putc(out, ':');
+
+        if (strview_eq(key, "deps") || strview_eq(key, "links")) {
+            StrView list = frontmatter_list(value);
+            StrView item;
+            int first_item = 1;
+            out_buf_putc(out, '[');
+            while (frontmatter_list_next(&list, &item)) {
+                if (!first_item) {
+                    out_buf_putc(out, ',');
+                }
+                first_item = 0;
+                out_buf_json_string(out, item);
+            }
+            out_buf_putc(out, ']');
+        } else if (strview_eq(key, "priority")) {
+            out_buf_write(out, value.ptr, value.len);
         } else {
-            out[j++] = str[i];
+            out_buf_json_string(out, value);
         }
     }
-    out[j] = '\0';
+    out_buf_puts(out, "}\n");
 }
 
-static void parse_array_field(const char *value, char items[MAX_DEPS][MAX_PATH], int *count)
+/* Redirects the rest of the output through `jq -c select(filter)`. Lines already written are
+ * exactly the ones jq would have kept, so switching part way through does not change output. */
+static int start_jq_filter(OutBuf *out, const char *jq_filter, pid_t *pid_out)
 {
-    *count = 0;
-    const char *bracket = strchr(value, '[');
-    if (bracket == NULL)
-        return;
+    if (out_buf_flush(out) != 0) {
+        return 1;
+    }
 
-    char *end = strchr(bracket, ']');
-    if (end == NULL)
-        return;
+    int pipefd[2];
+    if (pipe(pipefd) == -1) {
+        return 1;
+    }
 
-    char buffer[4096];
-    size_t len = end - bracket - 1;
-    if (len >= sizeof(buffer))
-        len = sizeof(buffer) - 1;
-    strncpy(buffer, bracket + 1, len);
-    buffer[len] = '\0';
+    pid_t pid = fork();
+    if (pid == -1) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return 1;
+    }
 
-    if (strlen(buffer) == 0)
-        return;
+    if (pid == 0) {
+        close(pipefd[1]);
+        dup2(pipefd[0], STDIN_FILENO);
+        close(pipefd[0]);
 
-    char *token = strtok(buffer, ",");
-    while (token != NULL && *count < MAX_DEPS) {
-        while (*token == ' ')
-            token++;
-        char *token_end = token + strlen(token) - 1;
-        while (token_end > token && (*token_end == ' ' || *token_end == '\n')) {
-            *token_end = '\0';
-            token_end--;
-        }
-        if (*token != '\0') {
-            strncpy(items[*count], token, MAX_PATH - 1);
-            items[*count][MAX_PATH - 1] = '\0';
-            (*count)++;
-        }
-        token = strtok(NULL, ",");
+        char filter_arg[1024];
+        snprintf(filter_arg, sizeof(filter_arg), "select(%s)", jq_filter);
+        execlp("jq", "jq", "-c", filter_arg, NULL);
+        exit(1);
     }
+
+    close(pipefd[0]);
+    out->fd = pipefd[1];
+    *pid_out = pid;
+    return 0;
 }
 
 static int cmd_query(int argc, char *argv[])
@@ -2122,15 +1784,24 @@ static int cmd_query(int argc, char *argv[])
         return 0;
     }
 
-    char **json_lines = malloc(MAX_TICKETS * sizeof(char *));
-    if (json_lines == NULL) {
+    OutBuf out;
+    if (out_buf_init(&out, STDOUT_FILENO) != 0) {
+        fprintf(stderr, "Error: out of memory\n");
         closedir(dir);
         return 1;
     }
-    int line_count = 0;
+
+    /* Tickets stream to stdout while the native filter can decide them; the first one it
+     * cannot hands this and every later ticket to jq. */
+    QueryFilter *filter = jq_filter ? query_filter_compile(jq_filter) : NULL;
+    pid_t jq_pid = -1;
+    int rc = 0;
+    if (jq_filter != NULL && filter == NULL) {
+        rc = start_jq_filter(&out, jq_filter, &jq_pid);
+    }
 
     struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL && line_count < MAX_TICKETS) {
+    while (rc == 0 && (entry = readdir(dir)) != NULL) {
         if (entry->d_name[0] == '.')
             continue;
 
@@ -2141,161 +1812,137 @@ static int cmd_query(int argc, char *argv[])
         char file_path[MAX_PATH];
         snprintf(file_path, sizeof(file_path), "%s/%s", TICKETS_DIR, entry->d_name);
 
-        FILE *file = fopen(file_path, "r");
-        if (file == NULL)
+        TicketFile file;
+        if (ticket_file_open(&file, file_path) != 0)
             continue;
 
-        char json[8192] = "{";
-        int in_frontmatter = 0;
-        int frontmatter_started = 0;
-        int first_field = 1;
-        char line[1024];
-
-        while (fgets(line, sizeof(line), file) != NULL) {
-            if (strcmp(line, "---\n") == 0) {
-                if (!frontmatter_started) {
-                    in_frontmatter = 1;
-                    frontmatter_started = 1;
-                } else {
-                    in_frontmatter = 0;
-                    break;
-                }
-                continue;
-            }
-
-            if (in_frontmatter && strchr(line, ':') != NULL) {
-                char key[256], value[4096];
-                char *colon = strchr(line, ':');
-                size_t key_len = colon - line;
-                if (key_len >= sizeof(key))
-                    key_len = sizeof(key) - 1;
-                strncpy(key, line, key_len);
-                key[key_len] = '\0';
-
-                char *val_start = colon + 1;
-                while (*val_start == ' ')
-                    val_start++;
-                strncpy(value, val_start, sizeof(value) - 1);
-                value[sizeof(value) - 1] = '\0';
-
-                size_t val_len = strlen(value);
-                if (val_len > 0 && value[val_len - 1] == '\n') {
-                    value[val_len - 1] = '\0';
-                }
-
-                if (!first_field) {
-                    strcat(json, ",");
-                }
-                first_field = 0;
-
-                char escaped_key[512];
-                escape_json_string(key, escaped_key, sizeof(escaped_key));
-
-                char field[4096];
-                snprintf(field, sizeof(field), "\"%s\":", escaped_key);
-                strcat(json, field);
-
-                if (strcmp(key, "deps") == 0 || strcmp(key, "links") == 0) {
-                    char items[MAX_DEPS][MAX_PATH];
-                    int count;
-                    parse_array_field(value, items, &count);
-
-                    strcat(json, "[");
-                    for (int i = 0; i < count; i++) {
-                        if (i > 0)
-                            strcat(json, ",");
-                        char escaped_item[MAX_PATH * 2];
-                        escape_json_string(items[i], escaped_item, sizeof(escaped_item));
-                        char item_json[MAX_PATH * 2 + 3];
-                        snprintf(item_json, sizeof(item_json), "\"%s\"", escaped_item);
-                        strcat(json, item_json);
-                    }
-                    strcat(json, "]");
-                } else if (strcmp(key, "priority") == 0) {
-                    char num[64];
-                    snprintf(num, sizeof(num), "%s", value);
-                    strcat(json, num);
-                } else {
-                    char escaped_value[4096];
-                    escape_json_string(value, escaped_value, sizeof(escaped_value));
-                    char value_json[4096];
-                    snprintf(value_json, sizeof(value_json), "\"%s\"", escaped_value);
-                    strcat(json, value_json);
-                }
-            }
+        int match = filter == NULL ? 1 : query_filter_match(filter, &file);
+        if (match == FILTER_NEEDS_JQ) {
+            query_filter_free(filter);
+            filter = NULL;
+            rc = start_jq_filter(&out, jq_filter, &jq_pid);
+            match = 1;
         }
-
-        strcat(json, "}");
-        fclose(file);
-
-        json_lines[line_count] = strdup(json);
-        line_count++;
+        if (rc == 0 && match == 1) {
+            write_ticket_json(&out, &file);
+        }
+        ticket_file_close(&file);
     }
-
+    query_filter_free(filter);
     closedir(dir);
 
-    if (jq_filter) {
-        int pipefd[2];
-        if (pipe(pipefd) == -1) {
-            for (int i = 0; i < line_count; i++)
-                free(json_lines[i]);
-            free(json_lines);
-            return 1;
+    TRACE_BEGIN(output);
+    if (out_buf_close(&out) != 0 && rc == 0) {
+        fprintf(stderr, "Error: failed to write query output\n");
+        rc = 1;
+    }
+    TRACE_END(TRACE_OUTPUT, output);
+    if (jq_pid > 0) {
+        close(out.fd);
+        int status;
+        TRACE_BEGIN(jq_wait);
+        waitpid(jq_pid, &status, 0);
+        TRACE_END(TRACE_JQ_WAIT, jq_wait);
+        if (rc == 0) {
+            rc = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
         }
+    }
+    return rc;
+}
 
-        pid_t pid = fork();
-        if (pid == -1) {
-            close(pipefd[0]);
-            close(pipefd[1]);
-            for (int i = 0; i < line_count; i++)
-                free(json_lines[i]);
-            free(json_lines);
-            return 1;
-        }
+static int cmd_export(int argc, char *argv[])
+{
+    if (argc != 2 || strncmp(argv[1], "--format=", 9) != 0) {
+        fprintf(stderr, "Usage: ticket export --format=columnar\n");
+        return 1;
+    }
+    if (strcmp(argv[1] + 9, "columnar") != 0) {
+        fprintf(stderr, "Error: unknown export format '%s'\n", argv[1] + 9);
+        return 1;
+    }
+    if (isatty(STDOUT_FILENO)) {
+        fprintf(stderr, "Error: refusing to write a columnar snapshot to a terminal\n");
+        return 1;
+    }
 
-        if (pid == 0) {
-            close(pipefd[1]);
-            dup2(pipefd[0], STDIN_FILENO);
-            close(pipefd[0]);
+    TicketStore store;
+    if (load_all_tickets(&store) != 0) {
+        fprintf(stderr, "Error: could not read %s\n", TICKETS_DIR);
+        ticket_store_free(&store);
+        return 1;
+    }
 
-            char filter_arg[1024];
-            snprintf(filter_arg, sizeof(filter_arg), "select(%s)", jq_filter);
-            execlp("jq", "jq", "-c", filter_arg, NULL);
-            exit(1);
-        } else {
-            close(pipefd[0]);
+    OutBuf out;
+    if (out_buf_init(&out, STDOUT_FILENO) != 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        ticket_store_free(&store);
+        return 1;
+    }
 
-            for (int i = 0; i < line_count; i++) {
-                write(pipefd[1], json_lines[i], strlen(json_lines[i]));
-                write(pipefd[1], "\n", 1);
-                free(json_lines[i]);
-            }
-            close(pipefd[1]);
+    TRACE_BEGIN(output);
+    int rc;
+    if (columnar_write(&store, &out) != 0) {
+        fprintf(stderr, "Error: cannot build the columnar snapshot\n");
+        out_buf_close(&out);
+        rc = 1;
+    } else {
+        rc = close_listing(&out);
+    }
+    TRACE_END(TRACE_OUTPUT, output);
 
-            int status;
-            waitpid(pid, &status, 0);
-            free(json_lines);
-            return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+    ticket_store_free(&store);
+    return rc;
+}
+
+static int cmd_index(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--drop") == 0) {
+        if (unlink(INDEX_CACHE_PATH) != 0 && errno != ENOENT) {
+            fprintf(stderr, "Error: could not remove %s\n", INDEX_CACHE_PATH);
+            return 1;
         }
+        return 0;
+    }
+
+    TicketStore store;
+    int rc = rebuild_ticket_index(&store);
+    if (rc == 1) {
+        fprintf(stderr, "Error: could not read %s\n", TICKETS_DIR);
+    } else if (rc == 2) {
+        fprintf(stderr, "Error: could not write %s\n", INDEX_CACHE_PATH);
     } else {
-        for (int i = 0; i < line_count; i++) {
-            printf("%s\n", json_lines[i]);
-            free(json_lines[i]);
-        }
-        free(json_lines);
+        printf("Indexed %d tickets\n", store.count);
     }
+    ticket_store_free(&store);
+    return rc == 0 ? 0 : 1;
+}
 
-    return 0;
+static int run_command(int argc, char *argv[]);
+
+static int cmd_serve(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    ensure_tickets_dir();
+    read_git_user_name(cached_user_name, sizeof(cached_user_name));
+    have_cached_user_name = 1;
+    return serve_run(run_command);
 }
 
-int main(int argc, char *argv[])
+static int dispatch_command(int argc, char *argv[])
 {
-    if (argc < 2) {
+    int arg = 1;
+    while (arg < argc && strncmp(argv[arg], "--jobs=", 7) == 0) {
+        set_load_workers(atoi(argv[arg] + 7));
+        arg++;
+    }
+
+    if (arg >= argc) {
         print_usage(argv[0]);
         return 1;
     }
 
-    const char *command = argv[1];
+    const char *command = argv[arg];
 
     if (strcmp(command, "help") == 0 || strcmp(command, "--help") == 0 ||
         strcmp(command, "-h") == 0) {
@@ -2310,41 +1957,49 @@ int main(int argc, char *argv[])
     }
 
     if (strcmp(command, "create") == 0) {
-        return cmd_create(argc - 1, &argv[1]);
+        return cmd_create(argc - arg, &argv[arg]);
     } else if (strcmp(command, "show") == 0) {
-        return cmd_show(argc - 1, &argv[1]);
+        return cmd_show(argc - arg, &argv[arg]);
     } else if (strcmp(command, "list") == 0) {
-        return cmd_list(argc - 1, &argv[1]);
+        return cmd_list(argc - arg, &argv[arg]);
     } else if (strcmp(command, "ls") == 0) {
-        return cmd_ls(argc - 1, &argv[1]);
+        return cmd_ls(argc - arg, &argv[arg]);
     } else if (strcmp(command, "ready") == 0) {
-        return cmd_ready(argc - 1, &argv[1]);
+        return cmd_ready(argc - arg, &argv[arg]);
     } else if (strcmp(command, "blocked") == 0) {
-        return cmd_blocked(argc - 1, &argv[1]);
+        return cmd_blocked(argc - arg, &argv[arg]);
     } else if (strcmp(command, "closed") == 0) {
-        return cmd_closed(argc - 1, &argv[1]);
+        return cmd_closed(argc - arg, &argv[arg]);
     } else if (strcmp(command, "status") == 0) {
-        return cmd_status(argc - 1, &argv[1]);
+        return cmd_status(argc - arg, &argv[arg]);
     } else if (strcmp(command, "start") == 0) {
-        return cmd_start(argc - 1, &argv[1]);
+        return cmd_start(argc - arg, &argv[arg]);
     } else if (strcmp(command, "close") == 0) {
-        return cmd_close(argc - 1, &argv[1]);
+        return cmd_close(argc - arg, &argv[arg]);
     } else if (strcmp(command, "reopen") == 0) {
-        return cmd_reopen(argc - 1, &argv[1]);
+        return cmd_reopen(argc - arg, &argv[arg]);
     } else if (strcmp(command, "dep") == 0) {
-        return cmd_dep(argc - 1, &argv[1]);
+        return cmd_dep(argc - arg, &argv[arg]);
     } else if (strcmp(command, "undep") == 0) {
-        return cmd_undep(argc - 1, &argv[1]);
+        return cmd_undep(argc - arg, &argv[arg]);
     } else if (strcmp(command, "link") == 0) {
-        return cmd_link(argc - 1, &argv[1]);
+        return cmd_link(argc - arg, &argv[arg]);
     } else if (strcmp(command, "unlink") == 0) {
-        return cmd_unlink(argc - 1, &argv[1]);
+        return cmd_unlink(argc - arg, &argv[arg]);
+    } else if (strcmp(command, "batch") == 0) {
+        return cmd_batch(argc - arg, &argv[arg]);
     } else if (strcmp(command, "edit") == 0) {
-        return cmd_edit(argc - 1, &argv[1]);
+        return cmd_edit(argc - arg, &argv[arg]);
     } else if (strcmp(command, "add-note") == 0) {
-        return cmd_add_note(argc - 1, &argv[1]);
+        return cmd_add_note(argc - arg, &argv[arg]);
     } else if (strcmp(command, "query") == 0) {
-        return cmd_query(argc - 1, &argv[1]);
+        return cmd_query(argc - arg, &argv[arg]);
+    } else if (strcmp(command, "export") == 0) {
+        return cmd_export(argc - arg, &argv[arg]);
+    } else if (strcmp(command, "index") == 0) {
+        return cmd_index(argc - arg, &argv[arg]);
+    } else if (strcmp(command, "serve") == 0) {
+        return cmd_serve(argc - arg, &argv[arg]);
     } else {
         fprintf(stderr, "Error: unknown command '%s'\n", command);
         fprintf(stderr, "Run '%s help' for usage information\n", argv[0]);
@@ -2353,3 +2008,53 @@ int main(int argc, char *argv[])
 
     return 0;
 }
+
+static int run_command(int argc, char *argv[])
+{
+    int arg = 1;
+    while (arg < argc && strncmp(argv[arg], "--jobs=", 7) == 0) {
+        arg++;
+    }
+    TRACE_COMMAND_BEGIN(arg < argc ? argv[arg] : "");
+    int status = dispatch_command(argc, argv);
+    /* The directory entries of every file the command replaced are made durable together. */
+    if (atomic_write_sync() != 0 && status == 0) {
+        fprintf(stderr, "Error: cannot sync %s\n", TICKETS_DIR);
+        status = 1;
+    }
+    TRACE_COMMAND_END();
+    return status;
+}
+
+/* edit stays in this process for the terminal and $EDITOR; serve must not reach itself. */
+static int forwards_to_daemon(int argc, char *argv[])
+{
+    int arg = 1;
+    while (arg < argc && strncmp(argv[arg], "--jobs=", 7) == 0) {
+        arg++;
+    }
+    if (arg >= argc || strcmp(argv[arg], "edit") == 0 || strcmp(argv[arg], "serve") == 0) {
+        return 0;
+    }
+    /* A traced command runs here, so the trace covers the load the daemon would skip. */
+    const char *trace = getenv("TICKET_TRACE");
+    if (trace != NULL && trace[0] != '\0') {
+        return 0;
+    }
+    /* Interrupting a forwarded watch would leave the daemon child writing to the terminal. */
+    for (int i = arg + 1; i < argc; i++) {
+        if (strcmp(argv[i], "--watch") == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    int status;
+    if (forwards_to_daemon(argc, argv) && serve_forward(argc, argv, &status) == 0) {
+        return status;
+    }
+    return run_command(argc, argv);
+}
@@ -0,0 +1,181 @@
+#define _DEFAULT_SOURCE
+
+#include "out_buf.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int out_buf_init(OutBuf *out, int fd)
+{
+    out->fd = fd;
+    out->failed = 0;
+    out->len = 0;
+    out->capacity = OUT_BUF_SIZE;
+    out->data = malloc(OUT_BUF_SIZE);
+    return out->data == NULL;
+}
+
+int out_buf_init_memory(OutBuf *out)
+{
+    out->fd = -1;
+    out->failed = 0;
+    out->len = 0;
+    out->capacity = 256;
+    out->data = malloc(out->capacity);
+    return out->data == NULL;
+}
+
+static void write_fd(OutBuf *out, const char *data, size_t len)
+{
+    while (len > 0 && !out->failed) {
+        ssize_t n = write(out->fd, data, len);
+        if (n < 0) {
+            if (errno != EINTR) {
+                out->failed = 1;
+            }
+            continue;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+int out_buf_flush(OutBuf *out)
+{
+    if (out->fd < 0) {
+        return out->failed;
+    }
+    write_fd(out, out->data, out->len);
+    out->len = 0;
+    return out->failed;
+}
+
+int out_buf_close(OutBuf *out)
+{
+    int failed = out->data != NULL ? out_buf_flush(out) : 1;
+    free(out->data);
+    out->data = NULL;
+    return failed;
+}
+
+/* Makes room for len more bytes in a memory buffer. Returns non-zero, marking the buffer
+ * failed, if it cannot grow. */
+static int grow(OutBuf *out, size_t len)
+{
+    size_t capacity = out->capacity;
+    while (capacity < out->len + len) {
+        capacity *= 2;
+    }
+    char *grown = out->failed ? NULL : realloc(out->data, capacity);
+    if (grown == NULL) {
+        out->failed = 1;
+        return 1;
+    }
+    out->data = grown;
+    out->capacity = capacity;
+    return 0;
+}
+
+void out_buf_write(OutBuf *out, const char *data, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    if (out->len + len > out->capacity) {
+        if (out->fd < 0) {
+            if (grow(out, len) != 0) {
+                return;
+            }
+        } else {
+            out_buf_flush(out);
+            if (len >= out->capacity) {
+                write_fd(out, data, len);
+                return;
+            }
+        }
+    }
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+}
+
+void out_buf_putc(OutBuf *out, char c)
+{
+    if (out->len == out->capacity) {
+        if (out->fd < 0) {
+            if (grow(out, 1) != 0) {
+                return;
+            }
+        } else {
+            out_buf_flush(out);
+        }
+    }
+    out->data[out->len++] = c;
+}
+
+void out_buf_puts(OutBuf *out, const char *s)
+{
+    out_buf_write(out, s, strlen(s));
+}
+
+void out_buf_pad(OutBuf *out, const char *s, size_t width)
+{
+    static const char spaces[] = "                ";
+    size_t len = strlen(s);
+    out_buf_write(out, s, len);
+    while (len < width) {
+        size_t n = width - len < sizeof(spaces) - 1 ? width - len : sizeof(spaces) - 1;
+        out_buf_write(out, spaces, n);
+        len += n;
+    }
+}
+
+void out_buf_int(OutBuf *out, long long value)
+{
+    char digits[24];
+    size_t start = sizeof(digits);
+    unsigned long long magnitude = value < 0 ? 0 - (unsigned long long)value
+                                             : (unsigned long long)value;
+    do {
+        digits[--start] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        digits[--start] = '-';
+    }
+    out_buf_write(out, digits + start, sizeof(digits) - start);
+}
+
+void out_buf_json_string(OutBuf *out, StrView str)
+{
+    out_buf_putc(out, '"');
+    size_t run = 0;
+    for (size_t i = 0; i < str.len; i++) {
+        const char *escape = NULL;
+        switch (str.ptr[i]) {
+        case '"':
+            escape = "\\\"";
+            break;
+        case '\\':
+            escape = "\\\\";
+            break;
+        case '\n':
+            escape = "\\n";
+            break;
+        case '\r':
+            escape = "\\r";
+            break;
+        case '\t':
+            escape = "\\t";
+            break;
+        default:
+            continue;
+        }
+        out_buf_write(out, str.ptr + run, i - run);
+        out_buf_write(out, escape, 2);
+        run = i + 1;
+    }
+    out_buf_write(out, str.ptr + run, str.len - run);
+    out_buf_putc(out, '"');
+}
@@ -0,0 +1,959 @@
+#include "query_filter.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+typedef enum {
+    N_IDENTITY,
+    N_FIELD,
+    N_LITERAL,
+    N_ARRAY,
+    N_PIPE,
+    N_AND,
+    N_OR,
+    N_COMPARE,
+    N_NOT,
+    N_LENGTH,
+    N_CONTAINS,
+    N_IN,
+    N_IN_SOURCE,
+    N_ANY,
+    N_ALL,
+    N_COMMA,
+    N_ITERATE
+} NodeKind;
+
+typedef enum { CMP_EQ, CMP_NE, CMP_LT, CMP_LE, CMP_GT, CMP_GE } CompareOp;
+
+/* jq orders values by kind first, in this order. */
+typedef enum { V_ERROR, V_NULL, V_FALSE, V_TRUE, V_NUMBER, V_STRING, V_ARRAY, V_OBJECT } ValueKind;
+
+typedef struct Node Node;
+
+typedef struct {
+    ValueKind kind;
+    double number;
+    StrView str;
+    StrView list;
+    const Node *items;
+} Value;
+
+struct Node {
+    NodeKind kind;
+    CompareOp op;
+    Node *left;
+    Node *right;
+    StrView name;
+    Value literal;
+    Node **elements;
+    int element_count;
+};
+
+struct QueryFilter {
+    Arena arena;
+    Node *root;
+};
+
+typedef struct {
+    Arena *arena;
+    const char *src;
+    size_t pos;
+} Parser;
+
+/* ---- parsing ---- */
+
+static void skip_space(Parser *p)
+{
+    while (isspace((unsigned char)p->src[p->pos])) {
+        p->pos++;
+    }
+}
+
+static int accept(Parser *p, const char *token)
+{
+    skip_space(p);
+    size_t len = strlen(token);
+    if (strncmp(p->src + p->pos, token, len) != 0) {
+        return 0;
+    }
+    if (isalpha((unsigned char)token[0])) {
+        char next = p->src[p->pos + len];
+        if (isalnum((unsigned char)next) || next == '_') {
+            return 0;
+        }
+    }
+    p->pos += len;
+    return 1;
+}
+
+static Node *new_node(Parser *p, NodeKind kind)
+{
+    Node *n = arena_alloc(p->arena, sizeof(Node));
+    if (n != NULL) {
+        memset(n, 0, sizeof(*n));
+        n->kind = kind;
+    }
+    return n;
+}
+
+static Node *new_binary(Parser *p, NodeKind kind, Node *left, Node *right)
+{
+    if (left == NULL || right == NULL) {
+        return NULL;
+    }
+    Node *n = new_node(p, kind);
+    if (n != NULL) {
+        n->left = left;
+        n->right = right;
+    }
+    return n;
+}
+
+static int append_utf8(char *out, size_t *len, unsigned long cp)
+{
+    if (cp < 0x80) {
+        out[(*len)++] = (char)cp;
+    } else if (cp < 0x800) {
+        out[(*len)++] = (char)(0xC0 | (cp >> 6));
+        out[(*len)++] = (char)(0x80 | (cp & 0x3F));
+    } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+        return 1;
+    } else {
+        out[(*len)++] = (char)(0xE0 | (cp >> 12));
+        out[(*len)++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[(*len)++] = (char)(0x80 | (cp & 0x3F));
+    }
+    return 0;
+}
+
+static int parse_string(Parser *p, StrView *out)
+{
+    skip_space(p);
+    if (p->src[p->pos] != '"') {
+        return 1;
+    }
+    p->pos++;
+    size_t start = p->pos;
+    while (p->src[p->pos] != '"') {
+        if (p->src[p->pos] == '\0') {
+            return 1;
+        }
+        p->pos += p->src[p->pos] == '\\' && p->src[p->pos + 1] != '\0' ? 2 : 1;
+    }
+    size_t raw_len = p->pos - start;
+    p->pos++;
+
+    char *buf = arena_alloc(p->arena, raw_len + 1);
+    if (buf == NULL) {
+        return 1;
+    }
+    size_t len = 0;
+    for (size_t i = start; i < start + raw_len; i++) {
+        char c = p->src[i];
+        if (c != '\\') {
+            buf[len++] = c;
+            continue;
+        }
+        c = p->src[++i];
+        switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+            buf[len++] = c;
+            break;
+        case 'n':
+            buf[len++] = '\n';
+            break;
+        case 't':
+            buf[len++] = '\t';
+            break;
+        case 'r':
+            buf[len++] = '\r';
+            break;
+        case 'b':
+            buf[len++] = '\b';
+            break;
+        case 'f':
+            buf[len++] = '\f';
+            break;
+        case 'u': {
+            unsigned long cp = 0;
+            for (int k = 1; k <= 4; k++) {
+                if (!isxdigit((unsigned char)p->src[i + k])) {
+                    return 1;
+                }
+                char hex[2] = {p->src[i + k], '\0'};
+                cp = cp * 16 + strtoul(hex, NULL, 16);
+            }
+            if (append_utf8(buf, &len, cp) != 0) {
+                return 1;
+            }
+            i += 4;
+            break;
+        }
+        default:
+            return 1;
+        }
+    }
+    out->ptr = buf;
+    out->len = len;
+    return 0;
+}
+
+static int parse_name(Parser *p, StrView *out)
+{
+    size_t start = p->pos;
+    if (!isalpha((unsigned char)p->src[p->pos]) && p->src[p->pos] != '_') {
+        return 1;
+    }
+    while (isalnum((unsigned char)p->src[p->pos]) || p->src[p->pos] == '_') {
+        p->pos++;
+    }
+    out->ptr = p->src + start;
+    out->len = p->pos - start;
+    return 0;
+}
+
+static Node *parse_pipe(Parser *p);
+static Node *parse_or(Parser *p);
+
+static Node *parse_literal(Parser *p)
+{
+    skip_space(p);
+    Node *n = new_node(p, N_LITERAL);
+    if (n == NULL) {
+        return NULL;
+    }
+    const char *s = p->src + p->pos;
+    if (*s == '"') {
+        n->literal.kind = V_STRING;
+        return parse_string(p, &n->literal.str) == 0 ? n : NULL;
+    }
+    if (isdigit((unsigned char)*s) || (*s == '-' && isdigit((unsigned char)s[1]))) {
+        char *end;
+        n->literal.kind = V_NUMBER;
+        n->literal.number = strtod(s, &end);
+        if (strspn(s, "0123456789.eE+-") < (size_t)(end - s)) {
+            return NULL;
+        }
+        p->pos += (size_t)(end - s);
+        return n;
+    }
+    if (accept(p, "true")) {
+        n->literal.kind = V_TRUE;
+    } else if (accept(p, "false")) {
+        n->literal.kind = V_FALSE;
+    } else if (accept(p, "null")) {
+        n->literal.kind = V_NULL;
+    } else {
+        return NULL;
+    }
+    return n;
+}
+
+static Node *parse_array_literal(Parser *p)
+{
+    Node *n = new_node(p, N_ARRAY);
+    if (n == NULL) {
+        return NULL;
+    }
+    n->literal.kind = V_ARRAY;
+    n->literal.items = n;
+    if (accept(p, "]")) {
+        return n;
+    }
+
+    int capacity = 0;
+    do {
+        Node *item = parse_literal(p);
+        if (item == NULL) {
+            return NULL;
+        }
+        if (n->element_count == capacity) {
+            capacity = capacity ? capacity * 2 : 4;
+            Node **grown = arena_alloc(p->arena, sizeof(Node *) * (size_t)capacity);
+            if (grown == NULL) {
+                return NULL;
+            }
+            if (n->element_count > 0) {
+                memcpy(grown, n->elements, sizeof(Node *) * (size_t)n->element_count);
+            }
+            n->elements = grown;
+        }
+        n->elements[n->element_count++] = item;
+    } while (accept(p, ","));
+    return accept(p, "]") ? n : NULL;
+}
+
+/* item := primary "[]" | or-expression; items are joined by "," into a stream. */
+static Node *parse_generator(Parser *p)
+{
+    Node *left = NULL;
+    do {
+        size_t start = p->pos;
+        Node *item = parse_or(p);
+        if (accept(p, "[")) {
+            p->pos = start;
+            skip_space(p);
+            if (p->src[p->pos] != '.') {
+                return NULL;
+            }
+            p->pos++;
+            item = new_node(p, N_FIELD);
+            if (item == NULL || parse_name(p, &item->name) != 0 || !accept(p, "[") ||
+                !accept(p, "]")) {
+                return NULL;
+            }
+            Node *iterate = new_node(p, N_ITERATE);
+            if (iterate == NULL) {
+                return NULL;
+            }
+            iterate->left = item;
+            item = iterate;
+        }
+        if (item == NULL) {
+            return NULL;
+        }
+        left = left == NULL ? item : new_binary(p, N_COMMA, left, item);
+    } while (left != NULL && accept(p, ","));
+    return left;
+}
+
+static Node *parse_primary(Parser *p)
+{
+    skip_space(p);
+    if (accept(p, "(")) {
+        Node *inner = parse_pipe(p);
+        return inner != NULL && accept(p, ")") ? inner : NULL;
+    }
+    if (accept(p, "[")) {
+        return parse_array_literal(p);
+    }
+    if (p->src[p->pos] == '.') {
+        p->pos++;
+        char next = p->src[p->pos];
+        if (next == '"' || isalpha((unsigned char)next) || next == '_') {
+            Node *n = new_node(p, N_FIELD);
+            if (n == NULL) {
+                return NULL;
+            }
+            int rc = next == '"' ? parse_string(p, &n->name) : parse_name(p, &n->name);
+            skip_space(p);
+            /* .a.b, .a[0] and friends are left to jq. */
+            if (rc != 0 || p->src[p->pos] == '.' || p->src[p->pos] == '[') {
+                return NULL;
+            }
+            return n;
+        }
+        skip_space(p);
+        return p->src[p->pos] == '[' ? NULL : new_node(p, N_IDENTITY);
+    }
+    if (accept(p, "not")) {
+        return new_node(p, N_NOT);
+    }
+    if (accept(p, "length")) {
+        return new_node(p, N_LENGTH);
+    }
+    if (accept(p, "contains")) {
+        if (!accept(p, "(")) {
+            return NULL;
+        }
+        Node *n = new_node(p, N_CONTAINS);
+        if (n == NULL || (n->left = parse_pipe(p)) == NULL || !accept(p, ")")) {
+            return NULL;
+        }
+        return n;
+    }
+    if (accept(p, "IN")) {
+        if (!accept(p, "(")) {
+            return NULL;
+        }
+        Node *n = new_node(p, N_IN);
+        if (n == NULL || (n->left = parse_generator(p)) == NULL) {
+            return NULL;
+        }
+        if (accept(p, ";")) {
+            n->kind = N_IN_SOURCE;
+            if ((n->right = parse_generator(p)) == NULL) {
+                return NULL;
+            }
+        }
+        return accept(p, ")") ? n : NULL;
+    }
+    int is_any = accept(p, "any");
+    if (is_any || accept(p, "all")) {
+        Node *n = new_node(p, is_any ? N_ANY : N_ALL);
+        if (n == NULL || !accept(p, "(") || (n->left = parse_generator(p)) == NULL ||
+            !accept(p, ";") || (n->right = parse_pipe(p)) == NULL || !accept(p, ")")) {
+            return NULL;
+        }
+        return n;
+    }
+    return parse_literal(p);
+}
+
+static int parse_compare_op(Parser *p, CompareOp *op)
+{
+    if (accept(p, "==")) {
+        *op = CMP_EQ;
+    } else if (accept(p, "!=")) {
+        *op = CMP_NE;
+    } else if (accept(p, "<=")) {
+        *op = CMP_LE;
+    } else if (accept(p, ">=")) {
+        *op = CMP_GE;
+    } else if (accept(p, "<")) {
+        *op = CMP_LT;
+    } else if (accept(p, ">")) {
+        *op = CMP_GT;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+static Node *parse_compare(Parser *p)
+{
+    Node *left = parse_primary(p);
+    CompareOp op;
+    if (left == NULL || !parse_compare_op(p, &op)) {
+        return left;
+    }
+    Node *n = new_binary(p, N_COMPARE, left, parse_primary(p));
+    if (n == NULL || parse_compare_op(p, &op)) {
+        return NULL;
+    }
+    n->op = op;
+    return n;
+}
+
+static Node *parse_and(Parser *p)
+{
+    Node *left = parse_compare(p);
+    while (left != NULL && accept(p, "and")) {
+        left = new_binary(p, N_AND, left, parse_compare(p));
+    }
+    return left;
+}
+
+static Node *parse_or(Parser *p)
+{
+    Node *left = parse_and(p);
+    while (left != NULL && accept(p, "or")) {
+        left = new_binary(p, N_OR, left, parse_and(p));
+    }
+    return left;
+}
+
+static Node *parse_pipe(Parser *p)
+{
+    Node *left = parse_or(p);
+    while (left != NULL && accept(p, "|")) {
+        left = new_binary(p, N_PIPE, left, parse_or(p));
+    }
+    return left;
+}
+
+QueryFilter *query_filter_compile(const char *source)
+{
+    QueryFilter *filter = malloc(sizeof(QueryFilter));
+    if (filter == NULL) {
+        return NULL;
+    }
+    arena_init(&filter->arena);
+
+    Parser p = {&filter->arena, source, 0};
+    filter->root = parse_pipe(&p);
+    skip_space(&p);
+    if (filter->root == NULL || p.src[p.pos] != '\0') {
+        query_filter_free(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+void query_filter_free(QueryFilter *filter)
+{
+    if (filter != NULL) {
+        arena_free(&filter->arena);
+        free(filter);
+    }
+}
+
+/* ---- ticket values ---- */
+
+static int is_canonical_integer(StrView v)
+{
+    size_t i = v.len > 0 && v.ptr[0] == '-' ? 1 : 0;
+    size_t digits = v.len - i;
+    if (digits == 0 || digits > 9 || (v.ptr[i] == '0' && (digits > 1 || i == 1))) {
+        return 0;
+    }
+    for (; i < v.len; i++) {
+        if (!isdigit((unsigned char)v.ptr[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* True when query's escaping of the bytes is what jq prints: valid UTF-8 and no control
+ * characters besides tab and carriage return. */
+static int is_plain_string(StrView v)
+{
+    const unsigned char *s = (const unsigned char *)v.ptr;
+    size_t i = 0;
+    while (i < v.len) {
+        unsigned char c = s[i];
+        if (c < 0x80) {
+            if ((c < 0x20 && c != '\t' && c != '\r') || c == 0x7F) {
+                return 0;
+            }
+            i++;
+            continue;
+        }
+        size_t extra;
+        uint32_t cp;
+        if (c >= 0xC2 && c <= 0xDF) {
+            extra = 1;
+            cp = c & 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            extra = 2;
+            cp = c & 0x0F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            extra = 3;
+            cp = c & 0x07;
+        } else {
+            return 0;
+        }
+        if (v.len - i <= extra) {
+            return 0;
+        }
+        for (size_t k = 1; k <= extra; k++) {
+            if ((s[i + k] & 0xC0) != 0x80) {
+                return 0;
+            }
+            cp = (cp << 6) | (s[i + k] & 0x3F);
+        }
+        if ((extra == 2 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) ||
+            (extra == 3 && (cp < 0x10000 || cp > 0x10FFFF))) {
+            return 0;
+        }
+        i += extra + 1;
+    }
+    return 1;
+}
+
+static int is_list_field(StrView key)
+{
+    return strview_eq(key, "deps") || strview_eq(key, "links");
+}
+
+static int ticket_is_canonical(const TicketFile *file)
+{
+    size_t cursor = 0;
+    StrView key, value;
+    while (frontmatter_next(file, &cursor, &key, &value)) {
+        if (!is_plain_string(key)) {
+            return 0;
+        }
+        size_t other = 0;
+        StrView other_key, other_value;
+        while (frontmatter_next(file, &other, &other_key, &other_value) && other < cursor) {
+            if (other_key.len == key.len && memcmp(other_key.ptr, key.ptr, key.len) == 0) {
+                return 0;
+            }
+        }
+
+        if (is_list_field(key)) {
+            StrView list = frontmatter_list(value);
+            StrView item;
+            while (frontmatter_list_next(&list, &item)) {
+                if (!is_plain_string(item)) {
+                    return 0;
+                }
+            }
+        } else if (strview_eq(key, "priority")) {
+            if (!is_canonical_integer(value)) {
+                return 0;
+            }
+        } else if (!is_plain_string(value)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static Value make_value(ValueKind kind)
+{
+    Value v;
+    memset(&v, 0, sizeof(v));
+    v.kind = kind;
+    return v;
+}
+
+static Value field_value(const TicketFile *file, StrView name)
+{
+    Value v = make_value(V_NULL);
+    size_t cursor = 0;
+    StrView key, value;
+    while (frontmatter_next(file, &cursor, &key, &value)) {
+        if (key.len != name.len || memcmp(key.ptr, name.ptr, name.len) != 0) {
+            continue;
+        }
+        if (is_list_field(key)) {
+            v = make_value(V_ARRAY);
+            v.list = frontmatter_list(value);
+            if (v.list.ptr == NULL) {
+                v.list.ptr = "";
+            }
+        } else if (strview_eq(key, "priority")) {
+            int priority = 0;
+            v = make_value(strview_to_int(value, &priority) == 0 ? V_NUMBER : V_ERROR);
+            v.number = priority;
+        } else {
+            v = make_value(V_STRING);
+            v.str = value;
+        }
+    }
+    return v;
+}
+
+typedef struct {
+    const Value *array;
+    StrView rest;
+    int index;
+} ArrayIter;
+
+static void array_iter_init(ArrayIter *it, const Value *array)
+{
+    it->array = array;
+    it->rest = array->list;
+    it->index = 0;
+}
+
+static int array_iter_next(ArrayIter *it, Value *out)
+{
+    if (it->array->items != NULL) {
+        if (it->index >= it->array->items->element_count) {
+            return 0;
+        }
+        *out = it->array->items->elements[it->index++]->literal;
+        return 1;
+    }
+    StrView item;
+    if (!frontmatter_list_next(&it->rest, &item)) {
+        return 0;
+    }
+    *out = make_value(V_STRING);
+    out->str = item;
+    it->index++;
+    return 1;
+}
+
+static int value_compare(const Value *a, const Value *b, int *error)
+{
+    if (a->kind != b->kind) {
+        return a->kind < b->kind ? -1 : 1;
+    }
+    switch (a->kind) {
+    case V_NUMBER:
+        return a->number < b->number ? -1 : a->number > b->number;
+    case V_STRING: {
+        size_t n = a->str.len < b->str.len ? a->str.len : b->str.len;
+        int c = memcmp(a->str.ptr, b->str.ptr, n);
+        if (c != 0) {
+            return c < 0 ? -1 : 1;
+        }
+        return a->str.len < b->str.len ? -1 : a->str.len > b->str.len;
+    }
+    case V_ARRAY: {
+        ArrayIter ia, ib;
+        array_iter_init(&ia, a);
+        array_iter_init(&ib, b);
+        Value ea, eb;
+        for (;;) {
+            int has_a = array_iter_next(&ia, &ea);
+            int has_b = array_iter_next(&ib, &eb);
+            if (!has_a || !has_b) {
+                return has_a - has_b;
+            }
+            int c = value_compare(&ea, &eb, error);
+            if (c != 0) {
+                return c;
+            }
+        }
+    }
+    case V_OBJECT:
+    case V_ERROR:
+        *error = 1;
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+static int string_contains(StrView haystack, StrView needle)
+{
+    if (needle.len == 0) {
+        return 1;
+    }
+    for (size_t i = 0; i + needle.len <= haystack.len; i++) {
+        if (memcmp(haystack.ptr + i, needle.ptr, needle.len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int value_contains(const Value *a, const Value *b, int *error)
+{
+    if (a->kind != b->kind) {
+        return 0;
+    }
+    if (a->kind == V_STRING) {
+        return string_contains(a->str, b->str);
+    }
+    if (a->kind == V_ARRAY) {
+        ArrayIter ib;
+        array_iter_init(&ib, b);
+        Value eb;
+        while (array_iter_next(&ib, &eb)) {
+            ArrayIter ia;
+            array_iter_init(&ia, a);
+            Value ea;
+            int found = 0;
+            while (!found && array_iter_next(&ia, &ea)) {
+                found = value_contains(&ea, &eb, error);
+            }
+            if (!found) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    return value_compare(a, b, error) == 0;
+}
+
+static int truthy(const Value *v)
+{
+    return v->kind != V_NULL && v->kind != V_FALSE;
+}
+
+static Value bool_value(int b)
+{
+    return make_value(b ? V_TRUE : V_FALSE);
+}
+
+/* ---- evaluation ---- */
+
+typedef struct {
+    const TicketFile *file;
+    const Value *input;
+    const Node *target;
+    const Value *needle;
+    int want_truthy;
+    int found;
+    int error;
+} StreamState;
+
+static Value eval(const Node *n, const Value *input, const TicketFile *file);
+
+/* Feeds each output of a generator to visit(); stops early once state->found is set. */
+static void each_output(const Node *n, const Value *input, StreamState *state,
+                        void (*visit)(StreamState *, const Value *))
+{
+    if (state->found || state->error) {
+        return;
+    }
+    if (n->kind == N_COMMA) {
+        each_output(n->left, input, state, visit);
+        each_output(n->right, input, state, visit);
+        return;
+    }
+    Value v = eval(n->kind == N_ITERATE ? n->left : n, input, state->file);
+    if (v.kind == V_ERROR || (n->kind == N_ITERATE && v.kind != V_ARRAY)) {
+        state->error = 1;
+        return;
+    }
+    if (n->kind != N_ITERATE) {
+        visit(state, &v);
+        return;
+    }
+    ArrayIter it;
+    array_iter_init(&it, &v);
+    Value element;
+    while (!state->found && !state->error && array_iter_next(&it, &element)) {
+        visit(state, &element);
+    }
+}
+
+static void visit_equals(StreamState *state, const Value *v)
+{
+    int error = 0;
+    if (value_compare(v, state->needle, &error) == 0 && !error) {
+        state->found = 1;
+    }
+    state->error |= error;
+}
+
+static void visit_source(StreamState *state, const Value *v)
+{
+    StreamState inner = *state;
+    inner.needle = v;
+    inner.found = 0;
+    each_output(state->target, state->input, &inner, visit_equals);
+    state->found = inner.found;
+    state->error = inner.error;
+}
+
+static void visit_condition(StreamState *state, const Value *v)
+{
+    Value c = eval(state->target, v, state->file);
+    if (c.kind == V_ERROR) {
+        state->error = 1;
+    } else if (truthy(&c) == state->want_truthy) {
+        state->found = 1;
+    }
+}
+
+static Value eval_length(const Value *v)
+{
+    Value out = make_value(V_NUMBER);
+    switch (v->kind) {
+    case V_NULL:
+        out.number = 0;
+        break;
+    case V_NUMBER:
+        out.number = v->number < 0 ? -v->number : v->number;
+        break;
+    case V_STRING:
+        for (size_t i = 0; i < v->str.len; i++) {
+            out.number += ((unsigned char)v->str.ptr[i] & 0xC0) != 0x80;
+        }
+        break;
+    case V_ARRAY: {
+        ArrayIter it;
+        array_iter_init(&it, v);
+        Value element;
+        while (array_iter_next(&it, &element)) {
+            out.number++;
+        }
+        break;
+    }
+    default:
+        return make_value(V_ERROR);
+    }
+    return out;
+}
+
+static Value eval_compare(const Node *n, const Value *input, const TicketFile *file)
+{
+    Value a = eval(n->left, input, file);
+    Value b = eval(n->right, input, file);
+    if (a.kind == V_ERROR || b.kind == V_ERROR) {
+        return make_value(V_ERROR);
+    }
+    int error = 0;
+    int c = value_compare(&a, &b, &error);
+    if (error) {
+        return make_value(V_ERROR);
+    }
+    switch (n->op) {
+    case CMP_EQ:
+        return bool_value(c == 0);
+    case CMP_NE:
+        return bool_value(c != 0);
+    case CMP_LT:
+        return bool_value(c < 0);
+    case CMP_LE:
+        return bool_value(c <= 0);
+    case CMP_GT:
+        return bool_value(c > 0);
+    default:
+        return bool_value(c >= 0);
+    }
+}
+
+static Value eval(const Node *n, const Value *input, const TicketFile *file)
+{
+    switch (n->kind) {
+    case N_IDENTITY:
+        return *input;
+    case N_FIELD:
+        if (input->kind == V_NULL) {
+            return make_value(V_NULL);
+        }
+        return input->kind == V_OBJECT ? field_value(file, n->name) : make_value(V_ERROR);
+    case N_LITERAL:
+    case N_ARRAY:
+        return n->literal;
+    case N_PIPE: {
+        Value left = eval(n->left, input, file);
+        return left.kind == V_ERROR ? left : eval(n->right, &left, file);
+    }
+    case N_AND:
+    case N_OR: {
+        Value left = eval(n->left, input, file);
+        if (left.kind == V_ERROR || truthy(&left) == (n->kind == N_OR)) {
+            return left.kind == V_ERROR ? left : bool_value(n->kind == N_OR);
+        }
+        Value right = eval(n->right, input, file);
+        return right.kind == V_ERROR ? right : bool_value(truthy(&right));
+    }
+    case N_COMPARE:
+        return eval_compare(n, input, file);
+    case N_NOT:
+        return input->kind == V_ERROR ? *input : bool_value(!truthy(input));
+    case N_LENGTH:
+        return eval_length(input);
+    case N_CONTAINS: {
+        Value needle = eval(n->left, input, file);
+        if (needle.kind == V_ERROR || needle.kind != input->kind || input->kind == V_OBJECT) {
+            return make_value(V_ERROR);
+        }
+        int error = 0;
+        int found = value_contains(input, &needle, &error);
+        return error ? make_value(V_ERROR) : bool_value(found);
+    }
+    case N_IN: {
+        StreamState state = {file, input, NULL, input, 0, 0, 0};
+        each_output(n->left, input, &state, visit_equals);
+        return state.error ? make_value(V_ERROR) : bool_value(state.found);
+    }
+    case N_IN_SOURCE: {
+        StreamState state = {file, input, n->left, NULL, 0, 0, 0};
+        each_output(n->right, input, &state, visit_source);
+        return state.error ? make_value(V_ERROR) : bool_value(state.found);
+    }
+    case N_ANY:
+    case N_ALL: {
+        /* all() is "no element fails the condition". */
+        StreamState state = {file, input, n->right, NULL, n->kind == N_ANY, 0, 0};
+        each_output(n->left, input, &state, visit_condition);
+        if (state.error) {
+            return make_value(V_ERROR);
+        }
+        return bool_value(n->kind == N_ANY ? state.found : !state.found);
+    }
+    default:
+        return make_value(V_ERROR);
+    }
+}
+
+int query_filter_match(const QueryFilter *filter, const TicketFile *file)
+{
+    if (!ticket_is_canonical(file)) {
+        return FILTER_NEEDS_JQ;
+    }
+    Value ticket = make_value(V_OBJECT);
+    Value result = eval(filter->root, &ticket, file);
+    if (result.kind == V_ERROR) {
+        return FILTER_NEEDS_JQ;
+    }
+    return truthy(&result);
+}
@@ -0,0 +1,419 @@
+#define _DEFAULT_SOURCE
+
+#include "serve.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "live_graph.h"
+#include "store.h"
+
+#define SERVE_FDS 3
+
+extern char **environ;
+
+static int serve_connect(void)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", SERVE_SOCKET_PATH);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int write_full(int fd, const void *data, size_t len)
+{
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, void *data, size_t len)
+{
+    char *p = data;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+typedef union {
+    char buf[CMSG_SPACE(sizeof(int) * SERVE_FDS)];
+    struct cmsghdr align;
+} FdControl;
+
+/* Variables with this prefix change what a command does, so they travel with the request. */
+#define SERVE_ENV_PREFIX "TICKET_"
+
+static int forwarded_var(const char *entry)
+{
+    return strncmp(entry, SERVE_ENV_PREFIX, strlen(SERVE_ENV_PREFIX)) == 0 &&
+           strchr(entry, '=') != NULL;
+}
+
+/* A request is a 32-bit payload length followed by the working directory, the client's
+ * TICKET_* variables as "NAME=value", an empty string and each argument, all NUL-terminated;
+ * the client's stdin, stdout and stderr ride along with the first byte. */
+static char *build_request(int argc, char *argv[], size_t *size)
+{
+    char cwd[MAX_PATH];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        return NULL;
+    }
+    size_t len = strlen(cwd) + 1;
+    for (char **env = environ; *env != NULL; env++) {
+        if (forwarded_var(*env)) {
+            len += strlen(*env) + 1;
+        }
+    }
+    len++;
+    for (int i = 0; i < argc; i++) {
+        len += strlen(argv[i]) + 1;
+    }
+    if (len > SERVE_MAX_REQUEST) {
+        return NULL;
+    }
+
+    char *request = malloc(sizeof(uint32_t) + len);
+    if (request == NULL) {
+        return NULL;
+    }
+    uint32_t header = (uint32_t)len;
+    memcpy(request, &header, sizeof(header));
+    char *p = request + sizeof(header);
+    size_t n = strlen(cwd) + 1;
+    memcpy(p, cwd, n);
+    p += n;
+    for (char **env = environ; *env != NULL; env++) {
+        if (forwarded_var(*env)) {
+            n = strlen(*env) + 1;
+            memcpy(p, *env, n);
+            p += n;
+        }
+    }
+    *p++ = '\0';
+    for (int i = 0; i < argc; i++) {
+        n = strlen(argv[i]) + 1;
+        memcpy(p, argv[i], n);
+        p += n;
+    }
+    *size = sizeof(header) + len;
+    return request;
+}
+
+int serve_forward(int argc, char *argv[], int *status)
+{
+    const char *disabled = getenv("TICKET_NO_DAEMON");
+    if (disabled != NULL && disabled[0] != '\0') {
+        return 1;
+    }
+
+    int fd = serve_connect();
+    if (fd < 0) {
+        return 1;
+    }
+    size_t size;
+    char *request = build_request(argc, argv, &size);
+    if (request == NULL) {
+        close(fd);
+        return 1;
+    }
+
+    int fds[SERVE_FDS] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    FdControl control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = {request, size};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    /* Until the first byte is out nothing has run, so the command can still run here. */
+    ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (sent <= 0) {
+        free(request);
+        close(fd);
+        return 1;
+    }
+    int failed = write_full(fd, request + sent, size - (size_t)sent);
+    free(request);
+
+    int32_t reply;
+    failed = failed || read_full(fd, &reply, sizeof(reply));
+    close(fd);
+    if (failed) {
+        fprintf(stderr, "Error: ticket serve closed the connection\n");
+        *status = 1;
+        return 0;
+    }
+    *status = reply;
+    return 0;
+}
+
+#ifdef __linux__
+
+static volatile sig_atomic_t serve_stopping = 0;
+
+static void serve_stop(int sig)
+{
+    (void)sig;
+    serve_stopping = 1;
+}
+
+static int serve_listen(void)
+{
+    int existing = serve_connect();
+    if (existing >= 0) {
+        close(existing);
+        fprintf(stderr, "Error: ticket serve is already running\n");
+        return -1;
+    }
+    unlink(SERVE_SOCKET_PATH);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", SERVE_SOCKET_PATH);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) != 0 ||
+        bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        fprintf(stderr, "Error: cannot listen on %s\n", SERVE_SOCKET_PATH);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+static int receive_request(int conn, int fds[SERVE_FDS], char **payload, uint32_t *len)
+{
+    FdControl control;
+    struct iovec iov = {len, sizeof(*len)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t n = recvmsg(conn, &msg, 0);
+    struct cmsghdr *cmsg = n > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int) * SERVE_FDS)) {
+        return 1;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * SERVE_FDS);
+    if ((size_t)n < sizeof(*len) && read_full(conn, (char *)len + n, sizeof(*len) - (size_t)n)) {
+        return 1;
+    }
+    if (*len == 0 || *len > SERVE_MAX_REQUEST) {
+        return 1;
+    }
+    *payload = malloc(*len);
+    return *payload == NULL || read_full(conn, *payload, *len) || (*payload)[*len - 1] != '\0';
+}
+
+/* Runs in the forked child; never returns. */
+static void serve_request(int conn, ServeHandler handler, TicketStore *resident)
+{
+    int fds[SERVE_FDS];
+    char *payload;
+    uint32_t len;
+    if (fcntl(conn, F_SETFD, FD_CLOEXEC) != 0 || receive_request(conn, fds, &payload, &len) != 0) {
+        _exit(1);
+    }
+
+    /* The daemon's own TICKET_* variables give way to the client's. */
+    char *p = payload + strlen(payload) + 1;
+    char *end = payload + len;
+    char **env = environ;
+    while (*env != NULL) {
+        if (forwarded_var(*env)) {
+            char *name = strndup(*env, (size_t)(strchr(*env, '=') - *env));
+            if (name == NULL || unsetenv(name) != 0) {
+                _exit(1);
+            }
+            free(name);
+            env = environ;
+        } else {
+            env++;
+        }
+    }
+    while (p < end && *p != '\0') {
+        if (forwarded_var(p)) {
+            putenv(p);
+        }
+        p += strlen(p) + 1;
+    }
+    if (p == end) {
+        _exit(1);
+    }
+    p++;
+
+    int argc = 0;
+    for (char *q = p; q < end; q++) {
+        argc += *q == '\0';
+    }
+    char **argv = malloc(sizeof(char *) * (size_t)(argc + 1));
+    if (argv == NULL || argc < 1) {
+        _exit(1);
+    }
+    for (int i = 0; i < argc; i++) {
+        argv[i] = p;
+        p += strlen(p) + 1;
+    }
+    argv[argc] = NULL;
+
+    for (int i = 0; i < SERVE_FDS; i++) {
+        dup2(fds[i], i);
+        if (fds[i] >= SERVE_FDS) {
+            close(fds[i]);
+        }
+    }
+
+    int32_t status;
+    if (chdir(payload) != 0) {
+        fprintf(stderr, "Error: cannot enter %s\n", payload);
+        status = 1;
+    } else {
+        if (resident != NULL) {
+            set_preloaded_store(resident);
+        }
+        /* A --jobs given to `ticket serve` was for its own load, not the client's. */
+        set_load_workers(0);
+        status = handler(argc, argv);
+    }
+    fflush(stdout);
+    fflush(stderr);
+    write_full(conn, &status, sizeof(status));
+    _exit(0);
+}
+
+int serve_run(ServeHandler handler)
+{
+    LiveGraph live;
+    if (live_graph_open(&live, SERVE_SOCKET_NAME) != 0) {
+        return 1;
+    }
+    int listen_fd = serve_listen();
+    if (listen_fd < 0) {
+        live_graph_close(&live);
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = serve_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Serving %s on %s\n", TICKETS_DIR, SERVE_SOCKET_PATH);
+    fflush(stdout);
+
+    int rc = 0;
+    int lost = 0;
+    while (!serve_stopping) {
+        while (waitpid(-1, NULL, WNOHANG) > 0) {
+        }
+        struct pollfd fds[2] = {{listen_fd, POLLIN, 0}, {live.inotify_fd, POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            rc = 1;
+            break;
+        }
+
+        /* The client's previous command has returned, so its writes are already queued on
+         * the inotify descriptor and applied here before the next request is accepted. */
+        if (live_graph_refresh(&live) == LIVE_GONE) {
+            fprintf(stderr, "Error: %s was removed, stopping\n", SERVE_SOCKET_PATH);
+            lost = 1;
+            rc = 1;
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        int conn = accept(listen_fd, NULL, NULL);
+        if (conn < 0) {
+            continue;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listen_fd);
+            close(live.inotify_fd);
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGPIPE, SIG_DFL);
+            serve_request(conn, handler, live.valid ? &live.store : NULL);
+        }
+        close(conn);
+    }
+
+    close(listen_fd);
+    if (!lost) {
+        unlink(SERVE_SOCKET_PATH);
+    }
+    live_graph_close(&live);
+    return rc;
+}
+
+#else
+
+int serve_run(ServeHandler handler)
+{
+    (void)handler;
+    fprintf(stderr, "Error: serve needs inotify, which this platform does not have\n");
+    return 1;
+}
+
+#endif
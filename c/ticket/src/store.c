@@ -0,0 +1,745 @@
+#define _DEFAULT_SOURCE
+
+#include "store.h"
+
+#include "frontmatter.h"
+#include "index_cache.h"
+#include "trace.h"
+#include "worker_pool.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define STORE_MIN_CAPACITY 256
+#define LOAD_BATCH_SIZE 4096
+#define LOAD_PARALLEL_MIN_FILES 64
+#define LOAD_MAX_WORKERS 64
+
+void ticket_store_init(TicketStore *store)
+{
+    arena_init(&store->arena);
+    intern_init(&store->strings, &store->arena);
+    id_index_init(&store->ids);
+    store->tickets = NULL;
+    store->count = 0;
+    store->capacity = 0;
+}
+
+void ticket_store_free(TicketStore *store)
+{
+    free(store->tickets);
+    id_index_free(&store->ids);
+    intern_free(&store->strings);
+    arena_free(&store->arena);
+    store->tickets = NULL;
+    store->count = 0;
+    store->capacity = 0;
+}
+
+static void reset_ticket(TicketStore *store, Ticket *t)
+{
+    const char *id = t->id;
+    memset(t, 0, sizeof(*t));
+    t->id = id;
+    t->status = intern(&store->strings, "open", 4);
+    t->title = "";
+    t->parent = "";
+    t->type = "";
+    t->assignee = "";
+    t->priority = 2;
+}
+
+static Ticket *new_ticket(TicketStore *store, const char *id, size_t id_len)
+{
+    Ticket *t = arena_alloc(&store->arena, sizeof(Ticket));
+    if (t == NULL) {
+        return NULL;
+    }
+    t->id = intern(&store->strings, id, id_len);
+    reset_ticket(store, t);
+    return t->id == NULL || t->status == NULL ? NULL : t;
+}
+
+Ticket *ticket_store_add(TicketStore *store, const char *id, size_t id_len)
+{
+    if (store->count == store->capacity) {
+        int new_capacity = store->capacity ? store->capacity * 2 : STORE_MIN_CAPACITY;
+        Ticket **tickets = realloc(store->tickets, sizeof(Ticket *) * (size_t)new_capacity);
+        if (tickets == NULL) {
+            return NULL;
+        }
+        store->tickets = tickets;
+        store->capacity = new_capacity;
+    }
+
+    Ticket *t = new_ticket(store, id, id_len);
+    if (t == NULL || id_index_put(&store->ids, t->id, store->count) != 0) {
+        return NULL;
+    }
+
+    store->tickets[store->count++] = t;
+    return t;
+}
+
+typedef enum { SLOT_SKIPPED, SLOT_CACHED, SLOT_PARSED, SLOT_FAILED } SlotState;
+
+/* One directory entry of a load batch. Workers fill it with copies in their own arena; the
+ * main thread interns it into the store in directory order. */
+typedef struct {
+    const char *id;
+    SlotState state;
+    FileStamp stamp;
+    const IndexEntry *cached;
+    StrView status;
+    StrView parent;
+    StrView type;
+    StrView assignee;
+    StrView title;
+    StrView *deps;
+    StrView *links;
+    int dep_count;
+    int link_count;
+    int priority;
+} LoadSlot;
+
+typedef struct {
+    const IndexCache *cache;
+    int use_index;
+    LoadSlot *slots;
+    Arena *arenas;
+} LoadBatch;
+
+static int load_workers = 0;
+
+void set_load_workers(int workers)
+{
+    load_workers = workers;
+}
+
+static int copy_view(Arena *arena, StrView *view)
+{
+    if (view->ptr == NULL) {
+        return 0;
+    }
+    char *copy = arena_strndup(arena, view->ptr, view->len);
+    if (copy == NULL) {
+        return 1;
+    }
+    view->ptr = copy;
+    return 0;
+}
+
+static int copy_id_list(Arena *arena, StrView value, StrView **items, int *count)
+{
+    *items = NULL;
+    *count = 0;
+
+    StrView list = frontmatter_list(value);
+    if (list.ptr == NULL) {
+        return 0;
+    }
+
+    int capacity = 1;
+    for (size_t i = 0; i < list.len; i++) {
+        if (list.ptr[i] == ',') {
+            capacity++;
+        }
+    }
+
+    StrView *ids = arena_alloc(arena, sizeof(StrView) * (size_t)capacity);
+    if (ids == NULL) {
+        return 1;
+    }
+
+    int n = 0;
+    while (frontmatter_list_next(&list, &ids[n])) {
+        if (copy_view(arena, &ids[n]) != 0) {
+            return 1;
+        }
+        n++;
+    }
+
+    *items = ids;
+    *count = n;
+    return 0;
+}
+
+static int parse_slot(Arena *arena, const TicketFile *file, LoadSlot *slot)
+{
+    size_t cursor = 0;
+    StrView key, value;
+    while (frontmatter_next(file, &cursor, &key, &value)) {
+        if (strview_eq(key, "status")) {
+            StrView status = strview_token(value);
+            if (status.len > 0) {
+                slot->status = status;
+            }
+        } else if (strview_eq(key, "priority")) {
+            strview_to_int(value, &slot->priority);
+        } else if (strview_eq(key, "parent")) {
+            slot->parent = value;
+        } else if (strview_eq(key, "type")) {
+            slot->type = strview_token(value);
+        } else if (strview_eq(key, "assignee")) {
+            slot->assignee = value;
+        } else if (strview_eq(key, "deps")) {
+            if (copy_id_list(arena, value, &slot->deps, &slot->dep_count) != 0) {
+                return 1;
+            }
+        } else if (strview_eq(key, "links")) {
+            if (copy_id_list(arena, value, &slot->links, &slot->link_count) != 0) {
+                return 1;
+            }
+        }
+    }
+
+    slot->title = ticket_file_title(file);
+    return copy_view(arena, &slot->status) != 0 || copy_view(arena, &slot->parent) != 0 ||
+           copy_view(arena, &slot->type) != 0 || copy_view(arena, &slot->assignee) != 0 ||
+           copy_view(arena, &slot->title) != 0;
+}
+
+static SlotState parse_ticket_file(Arena *arena, LoadSlot *slot)
+{
+    char file_path[MAX_PATH];
+    snprintf(file_path, sizeof(file_path), "%s/%s.md", TICKETS_DIR, slot->id);
+
+    TRACE_BEGIN(start);
+    TicketFile file;
+    if (ticket_file_open(&file, file_path) != 0) {
+        return SLOT_SKIPPED;
+    }
+    SlotState state = parse_slot(arena, &file, slot) == 0 ? SLOT_PARSED : SLOT_FAILED;
+    ticket_file_close(&file);
+    TRACE_ELAPSED(TRACE_PARSE_NS, start);
+    TRACE_COUNT(TRACE_FILES_PARSED, 1);
+    return state;
+}
+
+/* Runs on worker threads: writes only its own slot and arena, and reads the index cache. */
+static void load_slot(void *ctx, int worker, size_t index)
+{
+    LoadBatch *batch = ctx;
+    LoadSlot *slot = &batch->slots[index];
+    const char *id = slot->id;
+
+    memset(slot, 0, sizeof(*slot));
+    slot->id = id;
+    slot->priority = 2;
+    slot->state = SLOT_SKIPPED;
+
+    /* The stamp is taken before the read, so a concurrent edit leaves a stale stamp behind
+     * and the file is parsed again next time. */
+    if (batch->use_index) {
+        char file_path[MAX_PATH];
+        snprintf(file_path, sizeof(file_path), "%s/%s.md", TICKETS_DIR, id);
+        struct stat st;
+        if (stat(file_path, &st) != 0) {
+            return;
+        }
+        file_stamp_from_stat(&slot->stamp, &st);
+        if (batch->cache != NULL) {
+            slot->cached = index_cache_lookup(batch->cache, id, &slot->stamp);
+            if (slot->cached != NULL) {
+                slot->state = SLOT_CACHED;
+                TRACE_COUNT(TRACE_INDEX_HITS, 1);
+                return;
+            }
+        }
+    }
+
+    slot->state = parse_ticket_file(&batch->arenas[worker], slot);
+}
+
+static int intern_id_list(TicketStore *store, const StrView *items, int count,
+                          const char ***out, int *out_count)
+{
+    *out = NULL;
+    *out_count = 0;
+    if (items == NULL) {
+        return 0;
+    }
+    const char **ids = arena_alloc(&store->arena, sizeof(char *) * (size_t)(count ? count : 1));
+    if (ids == NULL) {
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        ids[i] = intern(&store->strings, items[i].ptr, items[i].len);
+        if (ids[i] == NULL) {
+            return 1;
+        }
+    }
+    *out = ids;
+    *out_count = count;
+    return 0;
+}
+
+static int fill_ticket(TicketStore *store, Ticket *t, const LoadSlot *slot)
+{
+    if (slot->status.ptr != NULL) {
+        t->status = intern(&store->strings, slot->status.ptr, slot->status.len);
+    }
+    if (slot->parent.ptr != NULL) {
+        t->parent = intern(&store->strings, slot->parent.ptr, slot->parent.len);
+    }
+    if (slot->type.ptr != NULL) {
+        t->type = intern(&store->strings, slot->type.ptr, slot->type.len);
+    }
+    if (slot->assignee.ptr != NULL) {
+        t->assignee = intern(&store->strings, slot->assignee.ptr, slot->assignee.len);
+    }
+    t->title = arena_strndup(&store->arena, slot->title.ptr, slot->title.len);
+    t->priority = slot->priority;
+    if (t->status == NULL || t->parent == NULL || t->type == NULL || t->assignee == NULL ||
+        t->title == NULL) {
+        return 1;
+    }
+    if (intern_id_list(store, slot->deps, slot->dep_count, &t->deps, &t->dep_count) != 0) {
+        return 1;
+    }
+    return intern_id_list(store, slot->links, slot->link_count, &t->links, &t->link_count);
+}
+
+static int merge_slot(TicketStore *store, const IndexCache *cache, const LoadSlot *slot)
+{
+    Ticket *t = ticket_store_add(store, slot->id, strlen(slot->id));
+    if (t == NULL) {
+        return 1;
+    }
+    if (slot->state == SLOT_CACHED) {
+        return index_cache_fill_ticket(cache, slot->cached, store, t);
+    }
+    return fill_ticket(store, t, slot);
+}
+
+static int collect_ticket_ids(TicketStore *store, const char ***ids, size_t *count)
+{
+    *ids = NULL;
+    *count = 0;
+
+    DIR *dir = opendir(TICKETS_DIR);
+    if (dir == NULL) {
+        return 1;
+    }
+
+    size_t capacity = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        size_t len = strlen(entry->d_name);
+        if (len < 4 || strcmp(entry->d_name + len - 3, ".md") != 0) {
+            continue;
+        }
+
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : STORE_MIN_CAPACITY;
+            const char **grown = realloc(*ids, sizeof(char *) * capacity);
+            if (grown == NULL) {
+                closedir(dir);
+                return 1;
+            }
+            *ids = grown;
+        }
+        (*ids)[*count] = intern(&store->strings, entry->d_name, len - 3);
+        if ((*ids)[*count] == NULL) {
+            closedir(dir);
+            return 2;
+        }
+        (*count)++;
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+static int resolve_worker_count(size_t files)
+{
+    int workers = load_workers > 0 ? load_workers : worker_pool_default_size();
+    if (files < LOAD_PARALLEL_MIN_FILES) {
+        return 1;
+    }
+    return workers > LOAD_MAX_WORKERS ? LOAD_MAX_WORKERS : workers;
+}
+
+/* Directory entries are collected first and parsed in batches across the worker pool; each
+ * batch is merged in directory order, so the store looks exactly like a sequential load. */
+static int load_tickets(TicketStore *store, int use_index, int force_write)
+{
+    ticket_store_init(store);
+
+    FileStamp listed;
+    int have_listed = use_index && index_cache_dir_stamp(&listed) == 0;
+    const char **ids;
+    size_t id_count;
+    TRACE_BEGIN(scan);
+    if (collect_ticket_ids(store, &ids, &id_count) != 0) {
+        free(ids);
+        return 1;
+    }
+    TRACE_END(TRACE_SCAN, scan);
+
+    TRACE_BEGIN(index_read);
+    IndexCache cache;
+    int have_cache = use_index && index_cache_open(&cache, &store->strings) == 0;
+    TRACE_END(TRACE_INDEX_READ, index_read);
+    int stale = !have_cache || force_write;
+
+    int workers = resolve_worker_count(id_count);
+    size_t batch_size = id_count < LOAD_BATCH_SIZE ? id_count : LOAD_BATCH_SIZE;
+    LoadSlot *slots = malloc(sizeof(LoadSlot) * (batch_size ? batch_size : 1));
+    Arena *arenas = malloc(sizeof(Arena) * (size_t)workers);
+    FileStamp *stamps = use_index ? malloc(sizeof(FileStamp) * (id_count ? id_count : 1)) : NULL;
+    WorkerPool pool;
+    if (slots == NULL || arenas == NULL || (use_index && stamps == NULL) ||
+        worker_pool_start(&pool, workers) != 0) {
+        free(slots);
+        free(arenas);
+        free(stamps);
+        free(ids);
+        if (have_cache) {
+            index_cache_close(&cache);
+        }
+        return 1;
+    }
+    for (int w = 0; w < workers; w++) {
+        arena_init(&arenas[w]);
+    }
+
+    TRACE_BEGIN(load);
+    int rc = 0;
+    LoadBatch batch = {have_cache ? &cache : NULL, use_index, slots, arenas};
+    for (size_t base = 0; rc == 0 && base < id_count; base += batch_size) {
+        size_t n = id_count - base < batch_size ? id_count - base : batch_size;
+        for (size_t i = 0; i < n; i++) {
+            slots[i].id = ids[base + i];
+        }
+
+        worker_pool_run(&pool, load_slot, &batch, n);
+
+        for (size_t i = 0; rc == 0 && i < n; i++) {
+            if (slots[i].state == SLOT_SKIPPED) {
+                have_listed = 0;
+                continue;
+            }
+            if (slots[i].state == SLOT_FAILED || merge_slot(store, batch.cache, &slots[i]) != 0) {
+                rc = 1;
+                break;
+            }
+            if (use_index) {
+                stamps[store->count - 1] = slots[i].stamp;
+                stale |= slots[i].state == SLOT_PARSED;
+            }
+        }
+
+        for (int w = 0; w < workers; w++) {
+            arena_free(&arenas[w]);
+            arena_init(&arenas[w]);
+        }
+    }
+
+    worker_pool_stop(&pool);
+    for (int w = 0; w < workers; w++) {
+        arena_free(&arenas[w]);
+    }
+    free(arenas);
+    free(slots);
+    free(ids);
+    TRACE_END(TRACE_LOAD, load);
+
+    /* A listing that covered every file also refreshes an index whose directory stamp is
+     * behind, so partial ids resolve against it again without a listing of their own. */
+    stale = stale || (have_listed && memcmp(&cache.dir_stamp, &listed, sizeof(listed)) != 0);
+    if (rc == 0 && use_index && (stale || (uint32_t)store->count != cache.entry_count)) {
+        TRACE_BEGIN(index_write);
+        if (index_cache_write(store, stamps, have_listed ? &listed : NULL) != 0 && force_write) {
+            rc = 2;
+        }
+        TRACE_END(TRACE_INDEX_WRITE, index_write);
+    }
+    if (have_cache) {
+        index_cache_close(&cache);
+    }
+    free(stamps);
+    return rc;
+}
+
+static TicketStore *preloaded_store = NULL;
+
+void set_preloaded_store(TicketStore *store)
+{
+    preloaded_store = store;
+}
+
+int load_all_tickets(TicketStore *store)
+{
+    if (preloaded_store != NULL) {
+        *store = *preloaded_store;
+        store->strings.arena = &store->arena;
+        preloaded_store = NULL;
+        return 0;
+    }
+    return load_tickets(store, index_cache_enabled(), 0);
+}
+
+int rebuild_ticket_index(TicketStore *store)
+{
+    return load_tickets(store, 1, 1);
+}
+
+typedef struct {
+    const IndexCache *cache;
+    const char **ids;
+    const IndexEntry **entries;
+} CheckBatch;
+
+/* Runs on worker threads: finds the entry of one listed file, or NULL when the index does not
+ * vouch for it. */
+static void check_slot(void *ctx, int worker, size_t index)
+{
+    (void)worker;
+    CheckBatch *batch = ctx;
+    char file_path[MAX_PATH];
+    snprintf(file_path, sizeof(file_path), "%s/%s.md", TICKETS_DIR, batch->ids[index]);
+    struct stat st;
+    FileStamp stamp;
+    batch->entries[index] = NULL;
+    if (stat(file_path, &st) == 0) {
+        file_stamp_from_stat(&stamp, &st);
+        batch->entries[index] = index_cache_lookup(batch->cache, batch->ids[index], &stamp);
+    }
+}
+
+/* Stats every listed file in parallel; 0 only if each one matches its entry and the index has
+ * no entry for a file that is gone. */
+static int check_index(const IndexCache *cache, const char **ids, size_t count,
+                       const IndexEntry **entries)
+{
+    if (count != cache->entry_count) {
+        return 1;
+    }
+    WorkerPool pool;
+    if (worker_pool_start(&pool, resolve_worker_count(count)) != 0) {
+        return 1;
+    }
+    CheckBatch batch = {cache, ids, entries};
+    worker_pool_run(&pool, check_slot, &batch, count);
+    worker_pool_stop(&pool);
+    for (size_t i = 0; i < count; i++) {
+        if (entries[i] == NULL) {
+            return 1;
+        }
+    }
+    TRACE_COUNT(TRACE_INDEX_HITS, count);
+    return 0;
+}
+
+static int want_id(const IndexCache *cache, TicketStore *store, IndexString s,
+                   unsigned char *wanted)
+{
+    const char *id = intern(&store->strings, cache->strings + s.offset, s.len);
+    if (id == NULL) {
+        return 1;
+    }
+    int entry = id_index_get(&cache->by_id, id);
+    if (entry >= 0) {
+        wanted[entry] = 1;
+    }
+    return 0;
+}
+
+/* Marks the entry and every entry show lists beside it. */
+static int want_neighbourhood(const IndexCache *cache, TicketStore *store, uint32_t target,
+                              unsigned char *wanted)
+{
+    const IndexEntry *e = &cache->entries[target];
+    wanted[target] = 1;
+    for (uint32_t i = 0; i < e->dependent_count; i++) {
+        wanted[cache->edges[e->dependents_offset + i]] = 1;
+    }
+    for (uint32_t i = 0; i < e->child_count; i++) {
+        wanted[cache->edges[e->children_offset + i]] = 1;
+    }
+    for (uint32_t i = 0; i < e->dep_count; i++) {
+        if (want_id(cache, store, cache->refs[e->deps_offset + i], wanted) != 0) {
+            return 1;
+        }
+    }
+    for (uint32_t i = 0; i < e->link_count; i++) {
+        if (want_id(cache, store, cache->refs[e->links_offset + i], wanted) != 0) {
+            return 1;
+        }
+    }
+    return want_id(cache, store, e->parent, wanted);
+}
+
+static int load_wanted(TicketStore *store, const char *id)
+{
+    const char **ids;
+    size_t id_count;
+    TRACE_BEGIN(scan);
+    if (collect_ticket_ids(store, &ids, &id_count) != 0) {
+        free(ids);
+        return 1;
+    }
+    TRACE_END(TRACE_SCAN, scan);
+
+    TRACE_BEGIN(index_read);
+    IndexCache cache;
+    if (index_cache_open(&cache, &store->strings) != 0) {
+        free(ids);
+        return 1;
+    }
+    TRACE_END(TRACE_INDEX_READ, index_read);
+
+    TRACE_BEGIN(load);
+    const IndexEntry **entries = malloc(sizeof(IndexEntry *) * (id_count ? id_count : 1));
+    unsigned char *wanted = calloc(cache.entry_count + 1, 1);
+    const char *target = intern(&store->strings, id, strlen(id));
+    int entry = target != NULL ? id_index_get(&cache.by_id, target) : -1;
+    int rc = entries == NULL || wanted == NULL || entry < 0 ||
+             check_index(&cache, ids, id_count, entries) != 0 ||
+             want_neighbourhood(&cache, store, (uint32_t)entry, wanted) != 0;
+    for (size_t i = 0; rc == 0 && i < id_count; i++) {
+        if (wanted[entries[i] - cache.entries]) {
+            Ticket *t = ticket_store_add(store, ids[i], strlen(ids[i]));
+            rc = t == NULL || index_cache_fill_ticket(&cache, entries[i], store, t) != 0;
+        }
+    }
+    TRACE_END(TRACE_LOAD, load);
+
+    free(wanted);
+    free(entries);
+    free(ids);
+    index_cache_close(&cache);
+    return rc;
+}
+
+int load_ticket_neighbourhood(TicketStore *store, const char *id)
+{
+    if (preloaded_store != NULL || !index_cache_enabled()) {
+        return 1;
+    }
+    ticket_store_init(store);
+    if (load_wanted(store, id) != 0) {
+        ticket_store_free(store);
+        return 1;
+    }
+    return 0;
+}
+
+/* Parses id's file into *t, allocating the record when *t is NULL and resetting it
+ * otherwise. Nothing is touched unless the file could be read. */
+static SlotState reload_ticket(TicketStore *store, Arena *scratch, const char *id, Ticket **t)
+{
+    LoadSlot slot;
+    memset(&slot, 0, sizeof(slot));
+    slot.id = id;
+    slot.priority = 2;
+    SlotState state = parse_ticket_file(scratch, &slot);
+    if (state != SLOT_PARSED) {
+        return state;
+    }
+    if (*t == NULL) {
+        *t = new_ticket(store, id, strlen(id));
+        if (*t == NULL) {
+            return SLOT_FAILED;
+        }
+    } else {
+        reset_ticket(store, *t);
+    }
+    return fill_ticket(store, *t, &slot) == 0 ? SLOT_PARSED : SLOT_FAILED;
+}
+
+static int refresh_in_place(TicketStore *store, Arena *scratch, const char *const *changed,
+                            int count)
+{
+    for (int i = 0; i < count; i++) {
+        int index = id_index_get(&store->ids, changed[i]);
+        if (index < 0) {
+            continue;
+        }
+        SlotState state = reload_ticket(store, scratch, changed[i], &store->tickets[index]);
+        if (state == SLOT_SKIPPED) {
+            return STORE_NEEDS_LISTING;
+        }
+        if (state == SLOT_FAILED) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int refresh_listing(TicketStore *store, Arena *scratch, const char *const *changed,
+                           int count)
+{
+    IdIndex changed_set;
+    IdIndex positions;
+    id_index_init(&changed_set);
+    id_index_init(&positions);
+    const char **ids;
+    size_t id_count;
+    int rc = collect_ticket_ids(store, &ids, &id_count) != 0;
+    Ticket **tickets = rc ? NULL : malloc(sizeof(Ticket *) * (id_count ? id_count : 1));
+    rc = rc || tickets == NULL;
+    for (int i = 0; rc == 0 && i < count; i++) {
+        rc = id_index_put(&changed_set, changed[i], i);
+    }
+
+    int kept = 0;
+    for (size_t i = 0; rc == 0 && i < id_count; i++) {
+        int index = id_index_get(&store->ids, ids[i]);
+        Ticket *t = index < 0 ? NULL : store->tickets[index];
+        if (t == NULL || id_index_get(&changed_set, ids[i]) >= 0) {
+            SlotState state = reload_ticket(store, scratch, ids[i], &t);
+            if (state == SLOT_SKIPPED) {
+                continue;
+            }
+            rc = state == SLOT_FAILED;
+        }
+        if (rc == 0) {
+            tickets[kept] = t;
+            rc = id_index_put(&positions, t->id, kept++);
+        }
+    }
+
+    free(ids);
+    id_index_free(&changed_set);
+    if (rc != 0) {
+        free(tickets);
+        id_index_free(&positions);
+        return 1;
+    }
+    free(store->tickets);
+    id_index_free(&store->ids);
+    store->tickets = tickets;
+    store->ids = positions;
+    store->count = kept;
+    store->capacity = id_count ? (int)id_count : 1;
+    return 0;
+}
+
+int ticket_store_refresh(TicketStore *store, const char *const *changed, int count, int relist)
+{
+    Arena scratch;
+    arena_init(&scratch);
+    int rc = relist ? refresh_listing(store, &scratch, changed, count)
+                    : refresh_in_place(store, &scratch, changed, count);
+    arena_free(&scratch);
+    return rc;
+}
+
+int find_ticket(const TicketStore *store, const char *id)
+{
+    return id_index_get(&store->ids, intern_lookup(&store->strings, id, strlen(id)));
+}
+
+int find_ticket_interned(const TicketStore *store, const char *id)
+{
+    return id_index_get(&store->ids, id);
+}
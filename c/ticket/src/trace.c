@@ -0,0 +1,160 @@
+#define _DEFAULT_SOURCE
+
+#include "trace.h"
+
+#ifndef TICKET_NO_TRACE
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Spans past this many still count towards the phase totals, but are left out of the
+ * Chrome trace. */
+#define TRACE_MAX_SPANS 4096
+
+typedef struct {
+    TracePhase phase;
+    uint64_t start;
+    uint64_t duration;
+} TraceSpan;
+
+static const char *const phase_names[TRACE_PHASE_COUNT] = {
+    "scan", "load", "index read", "index write", "graph", "output", "jq wait",
+};
+
+static const char *const counter_names[TRACE_COUNTER_COUNT] = {
+    "files_opened", "bytes_read", "files_parsed", "parse_ns", "index_hits",
+};
+
+int trace_enabled = 0;
+static int trace_chrome = 0;
+static const char *trace_name = "";
+static uint64_t trace_origin;
+static TraceSpan spans[TRACE_MAX_SPANS];
+static int span_count;
+static uint64_t phase_total[TRACE_PHASE_COUNT];
+static uint64_t phase_calls[TRACE_PHASE_COUNT];
+static _Atomic uint64_t counters[TRACE_COUNTER_COUNT];
+
+uint64_t trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void trace_command_begin(const char *name)
+{
+    const char *mode = getenv("TICKET_TRACE");
+    trace_enabled = mode != NULL && mode[0] != '\0' && strcmp(mode, "0") != 0;
+    trace_chrome = trace_enabled && strcmp(mode, "chrome") == 0;
+    trace_name = name;
+    span_count = 0;
+    memset(phase_total, 0, sizeof(phase_total));
+    memset(phase_calls, 0, sizeof(phase_calls));
+    for (int i = 0; i < TRACE_COUNTER_COUNT; i++) {
+        atomic_store_explicit(&counters[i], 0, memory_order_relaxed);
+    }
+    trace_origin = trace_enabled ? trace_now() : 0;
+}
+
+void trace_span(TracePhase phase, uint64_t start)
+{
+    uint64_t duration = trace_now() - start;
+    phase_total[phase] += duration;
+    phase_calls[phase]++;
+    if (span_count < TRACE_MAX_SPANS) {
+        spans[span_count].phase = phase;
+        spans[span_count].start = start;
+        spans[span_count].duration = duration;
+        span_count++;
+    }
+}
+
+void trace_add(TraceCounter counter, uint64_t n)
+{
+    atomic_fetch_add_explicit(&counters[counter], n, memory_order_relaxed);
+}
+
+static void print_summary(uint64_t total)
+{
+    fprintf(stderr, "trace: %s %.3f ms\n", trace_name, (double)total / 1e6);
+    for (int i = 0; i < TRACE_PHASE_COUNT; i++) {
+        fprintf(stderr, "  %-14s %10.3f ms  x%llu\n", phase_names[i],
+                (double)phase_total[i] / 1e6, (unsigned long long)phase_calls[i]);
+    }
+    for (int i = 0; i < TRACE_COUNTER_COUNT; i++) {
+        uint64_t value = atomic_load_explicit(&counters[i], memory_order_relaxed);
+        if (i == TRACE_PARSE_NS) {
+            fprintf(stderr, "  %-14s %10.3f ms  summed over threads\n", "parse time",
+                    (double)value / 1e6);
+        } else {
+            fprintf(stderr, "  %-14s %10llu\n", counter_names[i], (unsigned long long)value);
+        }
+    }
+}
+
+static void print_event(const char *name, uint64_t start, uint64_t duration)
+{
+    fprintf(stderr, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,", name,
+            (double)(start - trace_origin) / 1e3, (double)duration / 1e3);
+    fprintf(stderr, "\"pid\":%ld,\"tid\":1}", (long)getpid());
+}
+
+/* Command names come from argv, so they are escaped; phase names are plain. */
+static void print_chrome(uint64_t total)
+{
+    fprintf(stderr, "{\"traceEvents\":[\n{\"name\":\"");
+    for (const char *p = trace_name; *p != '\0'; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            fprintf(stderr, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(stderr, "\\u%04x", c);
+        } else {
+            fputc(c, stderr);
+        }
+    }
+    fprintf(stderr, "\",\"ph\":\"X\",\"ts\":0,\"dur\":%.3f,\"pid\":%ld,\"tid\":1}",
+            (double)total / 1e3, (long)getpid());
+    for (int i = 0; i < span_count; i++) {
+        print_event(phase_names[spans[i].phase], spans[i].start, spans[i].duration);
+    }
+    fprintf(stderr, ",\n{\"name\":\"counters\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%ld,\"tid\":1,"
+                    "\"args\":{",
+            (double)total / 1e3, (long)getpid());
+    for (int i = 0; i < TRACE_COUNTER_COUNT; i++) {
+        fprintf(stderr, "%s\"%s\":%llu", i > 0 ? "," : "", counter_names[i],
+                (unsigned long long)atomic_load_explicit(&counters[i], memory_order_relaxed));
+    }
+    fprintf(stderr, "}}\n]}\n");
+}
+
+void trace_command_end(void)
+{
+    if (!trace_enabled) {
+        return;
+    }
+    /* Whatever stdio still holds is written out now, and counts as output. */
+    uint64_t start = trace_now();
+    fflush(stdout);
+    trace_span(TRACE_OUTPUT, start);
+
+    uint64_t total = trace_now() - trace_origin;
+    if (trace_chrome) {
+        print_chrome(total);
+    } else {
+        print_summary(total);
+    }
+    trace_enabled = 0;
+}
+
+#else
+
+/* ISO C does not allow an empty translation unit. */
+typedef int TraceCompiledOut;
+
+#endif
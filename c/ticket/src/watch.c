@@ -0,0 +1,214 @@
+#define _DEFAULT_SOURCE
+
+#include "watch.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+
+void watch_view_init(WatchView *view)
+{
+    memset(view, 0, sizeof(*view));
+    arena_init(&view->arena);
+    intern_init(&view->ids, &view->arena);
+    id_index_init(&view->rows);
+}
+
+void watch_view_free(WatchView *view)
+{
+    for (int i = 0; i < view->count; i++) {
+        free(view->lines[i]);
+    }
+    free(view->lines);
+    free(view->row_ids);
+    id_index_free(&view->rows);
+    intern_free(&view->ids);
+    arena_free(&view->arena);
+    memset(view, 0, sizeof(*view));
+}
+
+/* The row for id, created empty when `create` is set; -1 if absent or out of memory. */
+static int view_row(WatchView *view, const char *id, int create)
+{
+    size_t len = strlen(id);
+    const char *key = intern_lookup(&view->ids, id, len);
+    int row = id_index_get(&view->rows, key);
+    if (row >= 0 || !create) {
+        return row;
+    }
+
+    if (view->count == view->capacity) {
+        int capacity = view->capacity ? view->capacity * 2 : 64;
+        const char **row_ids = realloc(view->row_ids, sizeof(char *) * (size_t)capacity);
+        if (row_ids == NULL) {
+            return -1;
+        }
+        view->row_ids = row_ids;
+        char **lines = realloc(view->lines, sizeof(char *) * (size_t)capacity);
+        if (lines == NULL) {
+            return -1;
+        }
+        view->lines = lines;
+        view->capacity = capacity;
+    }
+    key = intern(&view->ids, id, len);
+    if (key == NULL || id_index_put(&view->rows, key, view->count) != 0) {
+        return -1;
+    }
+    view->row_ids[view->count] = key;
+    view->lines[view->count] = NULL;
+    return view->count++;
+}
+
+/* The ticket's line as a heap string, or NULL with *failed untouched if it is not shown.
+ * `scratch` is a memory OutBuf reused across lines. */
+static char *format_line(const WatchListing *listing, const LiveGraph *live, int ticket,
+                         OutBuf *scratch, int *failed)
+{
+    if (!listing->shows(&live->store, &live->graph, ticket, listing->ctx)) {
+        return NULL;
+    }
+    scratch->len = 0;
+    listing->print(scratch, &live->store, &live->graph, ticket);
+    char *line = scratch->failed ? NULL : strndup(scratch->data, scratch->len);
+    if (line == NULL) {
+        *failed = 1;
+    }
+    return line;
+}
+
+static void emit(FILE *out, const char *mark, const char *line)
+{
+    fprintf(out, "%s%s\n", mark, line);
+}
+
+/* Tickets whose line may have changed: each re-read ticket and, since readiness follows dep
+ * statuses, every ticket that depends on it. */
+static int collect_affected(const LiveGraph *live, int all, const Ticket ***affected, int *count)
+{
+    const TicketStore *store = &live->store;
+    const TicketGraph *graph = &live->graph;
+    all = all || live->relisted || live->changed_count > store->count;
+    size_t capacity = all ? (size_t)store->count : 0;
+    for (int i = 0; !all && i < live->changed_count; i++) {
+        int ticket = find_ticket_interned(store, live->changed[i]);
+        if (ticket >= 0) {
+            capacity += 1 + (size_t)(graph->dependent_start[ticket + 1] -
+                                     graph->dependent_start[ticket]);
+        }
+    }
+
+    *count = 0;
+    *affected = malloc(sizeof(Ticket *) * (capacity ? capacity : 1));
+    if (*affected == NULL) {
+        return 1;
+    }
+    for (int i = 0; all && i < store->count; i++) {
+        (*affected)[(*count)++] = store->tickets[i];
+    }
+    for (int i = 0; !all && i < live->changed_count; i++) {
+        int ticket = find_ticket_interned(store, live->changed[i]);
+        if (ticket < 0) {
+            continue;
+        }
+        (*affected)[(*count)++] = store->tickets[ticket];
+        for (int d = graph->dependent_start[ticket]; d < graph->dependent_start[ticket + 1];
+             d++) {
+            (*affected)[(*count)++] = store->tickets[graph->dependents[d]];
+        }
+    }
+    return 0;
+}
+
+int watch_view_update(WatchView *view, const WatchListing *listing, const LiveGraph *live,
+                      FILE *out, int initial)
+{
+    const TicketStore *store = &live->store;
+    if (!initial && live->relisted) {
+        for (int row = 0; row < view->count; row++) {
+            if (view->lines[row] != NULL && find_ticket(store, view->row_ids[row]) < 0) {
+                emit(out, "- ", view->lines[row]);
+                free(view->lines[row]);
+                view->lines[row] = NULL;
+            }
+        }
+    }
+
+    const Ticket **affected;
+    int count;
+    if (collect_affected(live, initial, &affected, &count) != 0) {
+        return 1;
+    }
+    qsort(affected, (size_t)count, sizeof(Ticket *), listing->compare);
+
+    OutBuf scratch;
+    int failed = out_buf_init_memory(&scratch);
+    for (int i = 0; i < count && !failed; i++) {
+        if (i > 0 && affected[i] == affected[i - 1]) {
+            continue;
+        }
+        int ticket = find_ticket_interned(store, affected[i]->id);
+        char *line = format_line(listing, live, ticket, &scratch, &failed);
+        int row = view_row(view, affected[i]->id, line != NULL);
+        if (row < 0) {
+            failed |= line != NULL;
+            free(line);
+            continue;
+        }
+
+        char *old = view->lines[row];
+        if (line == NULL) {
+            if (old != NULL) {
+                emit(out, "- ", old);
+            }
+        } else if (initial) {
+            emit(out, "", line);
+        } else if (old == NULL) {
+            emit(out, "+ ", line);
+        } else if (strcmp(old, line) != 0) {
+            emit(out, "~ ", line);
+        }
+        free(old);
+        view->lines[row] = line;
+    }
+    out_buf_close(&scratch);
+    free(affected);
+    return failed;
+}
+
+int watch_listing(const WatchListing *listing)
+{
+    LiveGraph live;
+    if (live_graph_open(&live, NULL) != 0) {
+        return 1;
+    }
+    WatchView view;
+    watch_view_init(&view);
+
+    int failed = live.valid && watch_view_update(&view, listing, &live, stdout, 1) != 0;
+    int state = LIVE_UNCHANGED;
+    while (!failed && state != LIVE_GONE) {
+        fflush(stdout);
+        struct pollfd fds[1] = {{live.inotify_fd, POLLIN, 0}};
+        if (poll(fds, 1, -1) < 0 && errno != EINTR) {
+            break;
+        }
+        state = live_graph_refresh(&live);
+        if (state == LIVE_CHANGED && live.valid) {
+            failed = watch_view_update(&view, listing, &live, stdout, 0) != 0;
+        }
+    }
+    fflush(stdout);
+    if (failed) {
+        fprintf(stderr, "Error: out of memory\n");
+    } else if (state == LIVE_GONE) {
+        fprintf(stderr, "Error: %s was removed\n", TICKETS_DIR);
+    } else {
+        fprintf(stderr, "Error: cannot watch %s\n", TICKETS_DIR);
+    }
+
+    watch_view_free(&view);
+    live_graph_close(&live);
+    return 1;
+}
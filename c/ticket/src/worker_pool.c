@@ -0,0 +1,166 @@
+#define _DEFAULT_SOURCE
+
+#include "worker_pool.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#define WORKER_POOL_CHUNK 16
+
+struct WorkerThread {
+    pthread_t thread;
+    WorkerPool *pool;
+    int id;
+};
+
+int worker_pool_default_size(void)
+{
+    const char *jobs = getenv("TICKET_JOBS");
+    if (jobs != NULL && atoi(jobs) > 0) {
+        return atoi(jobs);
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+static void run_tasks(WorkerPool *pool, int worker)
+{
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        size_t start = pool->next;
+        size_t end = pool->count;
+        if (end - start > WORKER_POOL_CHUNK) {
+            end = start + WORKER_POOL_CHUNK;
+        }
+        WorkerTask task = pool->task;
+        void *ctx = pool->ctx;
+        if (start < pool->count) {
+            pool->next = end;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        if (start >= end) {
+            return;
+        }
+        for (size_t i = start; i < end; i++) {
+            task(ctx, worker, i);
+        }
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    WorkerThread *self = arg;
+    WorkerPool *pool = self->pool;
+    unsigned long seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stopping && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->stopping) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_tasks(pool, self->id);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+int worker_pool_start(WorkerPool *pool, int workers)
+{
+    pool->threads = NULL;
+    pool->workers = 1;
+    pool->generation = 0;
+    pool->task = NULL;
+    pool->ctx = NULL;
+    pool->next = 0;
+    pool->count = 0;
+    pool->active = 0;
+    pool->stopping = 0;
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        return 1;
+    }
+    if (pthread_cond_init(&pool->work_ready, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        return 1;
+    }
+    if (pthread_cond_init(&pool->work_done, NULL) != 0) {
+        pthread_cond_destroy(&pool->work_ready);
+        pthread_mutex_destroy(&pool->lock);
+        return 1;
+    }
+
+    if (workers <= 1) {
+        return 0;
+    }
+    pool->threads = calloc((size_t)workers - 1, sizeof(WorkerThread));
+    if (pool->threads == NULL) {
+        return 0;
+    }
+    for (int i = 1; i < workers; i++) {
+        WorkerThread *t = &pool->threads[i - 1];
+        t->pool = pool;
+        t->id = i;
+        if (pthread_create(&t->thread, NULL, worker_main, t) != 0) {
+            break;
+        }
+        pool->workers = i + 1;
+    }
+    return 0;
+}
+
+void worker_pool_run(WorkerPool *pool, WorkerTask task, void *ctx, size_t count)
+{
+    if (pool->workers <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(ctx, 0, i);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->next = 0;
+    pool->count = count;
+    pool->active = pool->workers - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_tasks(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void worker_pool_stop(WorkerPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->workers; i++) {
+        pthread_join(pool->threads[i - 1].thread, NULL);
+    }
+    free(pool->threads);
+    pthread_cond_destroy(&pool->work_done);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_mutex_destroy(&pool->lock);
+    pool->threads = NULL;
+    pool->workers = 1;
+}
@@ -1,11 +1,1132 @@
+#define _DEFAULT_SOURCE
+
 #include <check.h>
+#include <dirent.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "atomic_write.h"
+#include "batch.h"
+#include "columnar.h"
+#include "file_lock.h"
+#include "frontmatter.h"
+#include "frontmatter_patch.h"
+#include "graph.h"
+#include "id_resolver.h"
+#include "index_cache.h"
+#include "intern.h"
+#include "live_graph.h"
+#include "out_buf.h"
+#include "query_filter.h"
+#include "store.h"
+#include "watch.h"
 
 START_TEST(test_placeholder) {
     ck_assert_int_eq(1, 1);
 }
 END_TEST
 
+START_TEST(test_arena_alloc_and_strndup) {
+    Arena arena;
+    arena_init(&arena);
+
+    char *copy = arena_strndup(&arena, "tc-1234 trailing", 7);
+    ck_assert_str_eq(copy, "tc-1234");
+
+    void *large = arena_alloc(&arena, 1024 * 1024);
+    ck_assert_ptr_nonnull(large);
+    memset(large, 0xab, 1024 * 1024);
+
+    char *after = arena_strndup(&arena, "after", 5);
+    ck_assert_str_eq(after, "after");
+    ck_assert_str_eq(copy, "tc-1234");
+
+    arena_free(&arena);
+    ck_assert_ptr_null(arena.head);
+}
+END_TEST
+
+START_TEST(test_intern_deduplicates) {
+    Arena arena;
+    Interner strings;
+    arena_init(&arena);
+    intern_init(&strings, &arena);
+
+    const char *a = intern(&strings, "open", 4);
+    const char *b = intern(&strings, "open, closed", 4);
+    const char *c = intern(&strings, "closed", 6);
+    ck_assert_ptr_eq(a, b);
+    ck_assert_ptr_ne(a, c);
+    ck_assert_ptr_eq(intern_lookup(&strings, "closed", 6), c);
+    ck_assert_ptr_null(intern_lookup(&strings, "missing", 7));
+
+    char id[32];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(id, sizeof(id), "tc-%04d", i);
+        intern(&strings, id, strlen(id));
+    }
+    ck_assert_uint_eq(strings.count, 5002);
+    ck_assert_ptr_eq(intern(&strings, "open", 4), a);
+
+    intern_free(&strings);
+    arena_free(&arena);
+}
+END_TEST
+
+START_TEST(test_store_grows_without_moving_tickets) {
+    TicketStore store;
+    ticket_store_init(&store);
+
+    char id[32];
+    Ticket *first = ticket_store_add(&store, "tc-first", 8);
+    for (int i = 0; i < 20000; i++) {
+        snprintf(id, sizeof(id), "tc-%05d", i);
+        ck_assert_ptr_nonnull(ticket_store_add(&store, id, strlen(id)));
+    }
+
+    ck_assert_int_eq(store.count, 20001);
+    ck_assert_ptr_eq(store.tickets[0], first);
+    ck_assert_str_eq(first->id, "tc-first");
+    ck_assert_str_eq(first->status, "open");
+    ck_assert_int_eq(first->priority, 2);
+    ck_assert_int_eq(find_ticket(&store, "tc-19999"), 20000);
+    ck_assert_int_eq(find_ticket(&store, "tc-missing"), -1);
+
+    const char *dep = intern(&store.strings, "tc-00042", 8);
+    ck_assert_ptr_eq(dep, store.tickets[43]->id);
+    ck_assert_int_eq(find_ticket_interned(&store, dep), 43);
+    ck_assert_int_eq(find_ticket_interned(&store, intern(&store.strings, "tc-none", 7)), -1);
+
+    ticket_store_free(&store);
+}
+END_TEST
+
+START_TEST(test_preloaded_store_is_handed_over_once) {
+    TicketStore resident;
+    ticket_store_init(&resident);
+    ck_assert_ptr_nonnull(ticket_store_add(&resident, "tc-resident", 11));
+
+    set_preloaded_store(&resident);
+    TicketStore store;
+    ck_assert_int_eq(load_all_tickets(&store), 0);
+    ck_assert_int_eq(store.count, 1);
+    ck_assert_ptr_eq(store.strings.arena, &store.arena);
+    ck_assert_ptr_nonnull(ticket_store_add(&store, "tc-added", 8));
+    ck_assert_int_eq(find_ticket(&store, "tc-resident"), 0);
+    ck_assert_int_eq(find_ticket(&store, "tc-added"), 1);
+    ticket_store_free(&store);
+
+    /* The hand-over is one-shot: with no tickets directory the next load fails as usual. */
+    char dir[] = "/tmp/ticket_preload_XXXXXX";
+    char cwd[1024];
+    ck_assert_ptr_nonnull(getcwd(cwd, sizeof(cwd)));
+    ck_assert_ptr_nonnull(mkdtemp(dir));
+    ck_assert_int_eq(chdir(dir), 0);
+    ck_assert_int_ne(load_all_tickets(&store), 0);
+    ticket_store_free(&store);
+    ck_assert_int_eq(chdir(cwd), 0);
+    rmdir(dir);
+}
+END_TEST
+
+static int write_ticket(const char *path, const char *content)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return 1;
+    }
+    fputs(content, f);
+    return fclose(f);
+}
+
+START_TEST(test_index_cache_round_trip) {
+    char dir[] = "/tmp/ticket_index_XXXXXX";
+    char cwd[1024];
+    ck_assert_ptr_nonnull(getcwd(cwd, sizeof(cwd)));
+    ck_assert_ptr_nonnull(mkdtemp(dir));
+    ck_assert_int_eq(chdir(dir), 0);
+    ck_assert_int_eq(mkdir(TICKETS_DIR, 0755), 0);
+    ck_assert_int_eq(write_ticket(".tickets/tc-a.md", "---\nid: tc-a\nstatus: closed\ndeps: []\n"
+                                                      "links: [tc-b]\npriority: 1\n---\n# Alpha\n"),
+                     0);
+    ck_assert_int_eq(write_ticket(".tickets/tc-b.md", "---\nid: tc-b\nstatus: open\n"
+                                                      "deps: [tc-a, tc-c]\nlinks: [tc-a]\n"
+                                                      "parent: tc-a\ntype: bug\n"
+                                                      "assignee: Ann Lee\npriority: 3\n---\n"
+                                                      "# Beta\n"),
+                     0);
+
+    TicketStore store;
+    ck_assert_int_eq(rebuild_ticket_index(&store), 0);
+    ticket_store_free(&store);
+    ck_assert_int_eq(index_cache_enabled(), 1);
+
+    ck_assert_int_eq(load_all_tickets(&store), 0);
+    ck_assert_int_eq(store.count, 2);
+    const Ticket *b = store.tickets[find_ticket(&store, "tc-b")];
+    ck_assert_str_eq(b->status, "open");
+    ck_assert_str_eq(b->title, "Beta");
+    ck_assert_ptr_eq(b->parent, store.tickets[find_ticket(&store, "tc-a")]->id);
+    ck_assert_str_eq(b->type, "bug");
+    ck_assert_str_eq(b->assignee, "Ann Lee");
+    ck_assert_int_eq(b->priority, 3);
+    ck_assert_int_eq(b->dep_count, 2);
+    ck_assert_str_eq(b->deps[1], "tc-c");
+    ck_assert_int_eq(b->link_count, 1);
+    ticket_store_free(&store);
+
+    ck_assert_int_eq(write_ticket(".tickets/tc-a.md",
+                                  "---\nid: tc-a\nstatus: in_progress\n---\n# Alpha again\n"),
+                     0);
+    ck_assert_int_eq(load_all_tickets(&store), 0);
+    const Ticket *a = store.tickets[find_ticket(&store, "tc-a")];
+    ck_assert_str_eq(a->status, "in_progress");
+    ck_assert_str_eq(a->title, "Alpha again");
+    ck_assert_str_eq(a->type, "");
+    ck_assert_int_eq(a->link_count, 0);
+    ticket_store_free(&store);
+
+    unlink(".tickets/tc-a.md");
+    unlink(".tickets/tc-b.md");
+    unlink(INDEX_CACHE_PATH);
+    rmdir(TICKETS_DIR);
+    ck_assert_int_eq(chdir(cwd), 0);
+    rmdir(dir);
+}
+END_TEST
+
+START_TEST(test_neighbourhood_load_uses_index) {
+    char dir[] = "/tmp/ticket_show_XXXXXX";
+    char cwd[1024];
+    ck_assert_ptr_nonnull(getcwd(cwd, sizeof(cwd)));
+    ck_assert_ptr_nonnull(mkdtemp(dir));
+    ck_assert_int_eq(chdir(dir), 0);
+    ck_assert_int_eq(mkdir(TICKETS_DIR, 0755), 0);
+    const char *files[][2] = {
+        {".tickets/tc-a.md", "---\nid: tc-a\ndeps: [tc-b]\nlinks: [tc-c]\n---\n# A\n"},
+        {".tickets/tc-b.md", "---\nid: tc-b\n---\n# B\n"},
+        {".tickets/tc-c.md", "---\nid: tc-c\n---\n# C\n"},
+        {".tickets/tc-d.md", "---\nid: tc-d\ndeps: [tc-a]\n---\n# D\n"},
+        {".tickets/tc-e.md", "---\nid: tc-e\nparent: tc-a\n---\n# E\n"},
+        {".tickets/tc-f.md", "---\nid: tc-f\n---\n# F\n"},
+    };
+    for (int i = 0; i < 6; i++) {
+        ck_assert_int_eq(write_ticket(files[i][0], files[i][1]), 0);
+    }
+
+    TicketStore full;
+    ck_assert_int_eq(rebuild_ticket_index(&full), 0);
+    TicketStore store;
+    ck_assert_int_eq(load_ticket_neighbourhood(&store, "tc-a"), 0);
+    ck_assert_int_eq(store.count, 5);
+    ck_assert_int_lt(find_ticket(&store, "tc-f"), 0);
+    ck_assert_str_eq(store.tickets[find_ticket(&store, "tc-e")]->parent, "tc-a");
+    int next = 0;
+    for (int i = 0; i < full.count; i++) {
+        if (find_ticket(&store, full.tickets[i]->id) >= 0) {
+            ck_assert_str_eq(store.tickets[next++]->id, full.tickets[i]->id);
+        }
+    }
+    ticket_store_free(&store);
+    ticket_store_free(&full);
+
+    /* A ticket that gains a dep on tc-a after the index was written is not in its slices. */
+    ck_assert_int_eq(write_ticket(".tickets/tc-f.md", "---\nid: tc-f\ndeps: [tc-a]\n---\n# F\n"),
+                     0);
+    ck_assert_int_eq(load_ticket_neighbourhood(&store, "tc-a"), 1);
+
+    for (int i = 0; i < 6; i++) {
+        unlink(files[i][0]);
+    }
+    unlink(INDEX_CACHE_PATH);
+    rmdir(TICKETS_DIR);
+    ck_assert_int_eq(chdir(cwd), 0);
+    rmdir(dir);
+}
+END_TEST
+
+static int match_count(const char *query)
+{
+    IdMatches matches;
+    id_matches_init(&matches, query);
+    int rc = id_match_tickets(&matches);
+    int count = rc == 0 ? matches.count : -1;
+    id_matches_free(&matches);
+    return count;
+}
+
+START_TEST(test_id_resolver_uses_current_index) {
+    char dir[] = "/tmp/ticket_resolve_XXXXXX";
+    char cwd[1024];
+    ck_assert_ptr_nonnull(getcwd(cwd, sizeof(cwd)));
+    ck_assert_ptr_nonnull(mkdtemp(dir));
+    ck_assert_int_eq(chdir(dir), 0);
+    ck_assert_int_eq(mkdir(TICKETS_DIR, 0755), 0);
+    ck_assert_int_eq(write_ticket(".tickets/tc-abc1.md", "---\nid: tc-abc1\n---\n# A\n"), 0);
+    ck_assert_int_eq(write_ticket(".tickets/tc-abc2.md", "---\nid: tc-abc2\n---\n# B\n"), 0);
+    ck_assert_int_eq(write_ticket(".tickets/ab-x.md", "---\nid: ab-x\n---\n# C\n"), 0);
+
+    TicketStore store;
+    ck_assert_int_eq(rebuild_ticket_index(&store), 0);
+    ticket_store_free(&store);
+    IndexCache cache;
+    ck_assert_int_eq(index_cache_map(&cache), 0);
+    ck_assert_int_eq(index_cache_is_current(&cache), 1);
+    index_cache_close(&cache);
+
+    ck_assert_int_eq(match_count("abc"), 2);
+    ck_assert_int_eq(match_count("c-a"), 2);
+    ck_assert_int_eq(match_count("ab"), 3);
+    ck_assert_int_eq(match_count("abc3"), 0);
+    ck_assert_int_eq(match_count("x"), 1);
+
+    IdMatches matches;
+    id_matches_init(&matches, "bc1");
+    ck_assert_int_eq(id_match_tickets(&matches), 0);
+    ck_assert_str_eq(id_matches_resolve(&matches), "tc-abc1");
+    id_matches_free(&matches);
+
+    /* A ticket the index has not seen moves the directory stamp, so it is still found. */
+    ck_assert_int_eq(write_ticket(".tickets/tc-abc3.md", "---\nid: tc-abc3\n---\n# D\n"), 0);
+    ck_assert_int_eq(index_cache_map(&cache), 0);
+    ck_assert_int_eq(index_cache_is_current(&cache), 0);
+    index_cache_close(&cache);
+    ck_assert_int_eq(match_count("abc"), 3);
+    ck_assert_int_eq(match_count("abc3"), 1);
+
+    unlink(".tickets/tc-abc1.md");
+    unlink(".tickets/tc-abc2.md");
+    unlink(".tickets/tc-abc3.md");
+    unlink(".tickets/ab-x.md");
+    unlink(INDEX_CACHE_PATH);
+    rmdir(TICKETS_DIR);
+    ck_assert_int_eq(chdir(cwd), 0);
+    rmdir(dir);
+}
+END_TEST
+
+static int gram_match_count(IdGrams *grams, const char *query)
+{
+    IdMatches matches;
+    id_matches_init(&matches, query);
+    id_match_grams(&matches, grams);
+    int count = matches.failed ? -1 : matches.count;
+    id_matches_free(&matches);
+    return count;
+}
+
+START_TEST(test_id_grams_narrow_like_the_index) {
+    IdGrams grams;
+    id_grams_init(&grams);
+    ck_assert_int_eq(id_grams_add(&grams, "tc-abc1"), 0);
+    ck_assert_int_eq(id_grams_add(&grams, "tc-abc2"), 0);
+    ck_assert_int_eq(id_grams_add(&grams, "ab-x"), 0);
+    ck_assert_int_eq(id_grams_add(&grams, "aaaa"), 0);
+
+    ck_assert_int_eq(gram_match_count(&grams, "abc"), 2);
+    ck_assert_int_eq(gram_match_count(&grams, "c-a"), 2);
+    ck_assert_int_eq(gram_match_count(&grams, "ab"), 3);
+    ck_assert_int_eq(gram_match_count(&grams, "abc3"), 0);
+    ck_assert_int_eq(gram_match_count(&grams, "zzz"), 0);
+    /* "aaaa" holds "aaa" twice but is one candidate. */
+    ck_assert_int_eq(gram_match_count(&grams, "aaa"), 1);
+
+    /* Ids added after the postings were built are found once they are rebuilt. */
+    ck_assert_int_eq(id_grams_add(&grams, "tc-abc3"), 0);
+    ck_assert_int_eq(gram_match_count(&grams, "abc"), 3);
+
+    IdMatches matches;
+    id_matches_init(&matches, "bc1");
+    id_match_grams(&matches, &grams);
+    ck_assert_str_eq(id_matches_resolve(&matches), "tc-abc1");
+    id_matches_free(&matches);
+    id_grams_free(&grams);
+}
+END_TEST
+
+START_TEST(test_index_carry_excludes_concurrent_create) {
+    char dir[] = "/tmp/ticket_carry_XXXXXX";
+    char cwd[1024];
+    ck_assert_ptr_nonnull(getcwd(cwd, sizeof(cwd)));
+    ck_assert_ptr_nonnull(mkdtemp(dir));
+    ck_assert_int_eq(chdir(dir), 0);
+    ck_assert_int_eq(mkdir(TICKETS_DIR, 0755), 0);
+    ck_assert_int_eq(write_ticket(".tickets/tc-a.md", "---\nid: tc-a\n---\n# A\n"), 0);
+
+    TicketStore store;
+    ck_assert_int_eq(rebuild_ticket_index(&store), 0);
+    ticket_store_free(&store);
+
+    /* A rewrite of tc-a is under way when another process creates tc-new. */
+    IndexDirChange change;
+    index_cache_change_begin(&change);
+    pid_t child = fork();
+    ck_assert_int_ge(child, 0);
+    if (child == 0) {
+        close(change.lock);
+        IndexDirChange create;
+        index_cache_change_begin(&create);
+        const char *text = "---\nid: tc-new\n---\n";
+        int rc = atomic_write_file(".tickets/tc-new.md", text, strlen(text), ATOMIC_WRITE_CREATE);
+        index_cache_change_end(&create, 0);
+        _exit(rc);
+    }
+    usleep(50000);
+    ck_assert_int_eq(access(".tickets/tc-new.md", F_OK), -1);
+    const char *rewrite = "---\nid: tc-a\n---\n# A2\n";
+    ck_assert_int_eq(atomic_write_file(".tickets/tc-a.md", rewrite, strlen(rewrite), 0), 0);
+    index_cache_change_end(&change, 1);
+    int status;
+    ck_assert_int_eq(waitpid(child, &status, 0), child);
+    ck_assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    /* The carry covered only the rename; the create left the index unable to vouch. */
+    IndexCache cache;
+    ck_assert_int_eq(index_cache_map(&cache), 0);
+    ck_assert_int_eq(index_cache_is_current(&cache), 0);
+    index_cache_close(&cache);
+    ck_assert_int_eq(match_count("new"), 1);
+
+    unlink(".tickets/tc-a.md");
+    unlink(".tickets/tc-new.md");
+    unlink(INDEX_CACHE_PATH);
+    rmdir(TICKETS_DIR);
+    ck_assert_int_eq(chdir(cwd), 0);
+    rmdir(dir);
+}
+END_TEST
+
+START_TEST(test_live_graph_follows_edits) {
+    char dir[] = "/tmp/ticket_live_XXXXXX";
+    char cwd[1024];
+    ck_assert_ptr_nonnull(getcwd(cwd, sizeof(cwd)));
+    ck_assert_ptr_nonnull(mkdtemp(dir));
+    ck_assert_int_eq(chdir(dir), 0);
+    ck_assert_int_eq(mkdir(TICKETS_DIR, 0755), 0);
+    ck_assert_int_eq(write_ticket(".tickets/tc-a.md", "---\nid: tc-a\nstatus: open\n---\n"), 0);
+    ck_assert_int_eq(write_ticket(".tickets/tc-b.md", "---\nid: tc-b\ndeps: [tc-a]\n---\n"), 0);
+    ck_assert_int_eq(write_ticket(".tickets/.sentinel", ""), 0);
+
+    LiveGraph live;
+    ck_assert_int_eq(live_graph_open(&live, ".sentinel"), 0);
+    ck_assert(live.valid);
+    ck_assert_int_eq(live.store.count, 2);
+    int a = find_ticket(&live.store, "tc-a");
+    int b = find_ticket(&live.store, "tc-b");
+    ck_assert_int_eq(live.graph.unresolved[b], 1);
+    ck_assert_int_eq(live_graph_refresh(&live), LIVE_UNCHANGED);
+
+    /* A status edit keeps every record in place and only moves the counters. */
+    const Ticket *b_record = live.store.tickets[b];
+    ck_assert_int_eq(write_ticket(".tickets/tc-a.md", "---\nid: tc-a\nstatus: closed\n---\n"), 0);
+    ck_assert_int_eq(live_graph_refresh(&live), LIVE_CHANGED);
+    ck_assert_ptr_eq(live.store.tickets[b], b_record);
+    ck_assert_str_eq(live.store.tickets[a]->status, "closed");
+    ck_assert_int_eq(live.graph.unresolved[b], 0);
+    ck_assert(ticket_graph_is_ready(&live.graph, &live.store, b));
+
+    ck_assert_int_eq(write_ticket(".tickets/tc-c.md", "---\nid: tc-c\nparent: tc-b\n---\n"), 0);
+    ck_assert_int_eq(live_graph_refresh(&live), LIVE_CHANGED);
+    ck_assert_int_eq(live.store.count, 3);
+    b = find_ticket(&live.store, "tc-b");
+    int c = find_ticket(&live.store, "tc-c");
+    ck_assert_int_ge(c, 0);
+    ck_assert_int_eq(live.graph.child_start[b + 1] - live.graph.child_start[b], 1);
+    ck_assert_int_eq(live.graph.children[live.graph.child_start[b]], c);
+
+    unlink(".tickets/tc-a.md");
+    ck_assert_int_eq(live_graph_refresh(&live), LIVE_CHANGED);
+    ck_assert_int_eq(live.store.count, 2);
+    ck_assert_int_eq(find_ticket(&live.store, "tc-a"), -1);
+    b = find_ticket(&live.store, "tc-b");
+    ck_assert_int_ge(b, 0);
+    ck_assert_int_eq(live.graph.unresolved[b], 1);
+
+    unlink(".tickets/.sentinel");
+    ck_assert_int_eq(live_graph_refresh(&live), LIVE_GONE);
+    live_graph_close(&live);
+
+    unlink(".tickets/tc-b.md");
+    unlink(".tickets/tc-c.md");
+    rmdir(TICKETS_DIR);
+    ck_assert_int_eq(chdir(cwd), 0);
+    rmdir(dir);
+}
+END_TEST
+
+static int watch_test_shows(const TicketStore *store, const TicketGraph *graph, int ticket,
+                            const void *ctx)
+{
+    (void)ctx;
+    return ticket_graph_is_ready(graph, store, ticket);
+}
+
+static void watch_test_print(OutBuf *out, const TicketStore *store, const TicketGraph *graph,
+                             int ticket)
+{
+    (void)graph;
+    out_buf_puts(out, store->tickets[ticket]->id);
+    out_buf_putc(out, ' ');
+    out_buf_puts(out, store->tickets[ticket]->status);
+}
+
+static int watch_test_compare(const void *a, const void *b)
+{
+    return strcmp((*(const Ticket *const *)a)->id, (*(const Ticket *const *)b)->id);
+}
+
+/* What one update prints, or NULL if it failed. */
+static char *watch_test_update(WatchView *view, const WatchListing *listing, LiveGraph *live,
+                               int initial)
+{
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    if (out == NULL) {
+        return NULL;
+    }
+    int failed = watch_view_update(view, listing, live, out, initial);
+    fclose(out);
+    if (failed) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+START_TEST(test_watch_view_prints_ready_changes) {
+    char dir[] = "/tmp/ticket_watch_XXXXXX";
+    char cwd[1024];
+    ck_assert_ptr_nonnull(getcwd(cwd, sizeof(cwd)));
+    ck_assert_ptr_nonnull(mkdtemp(dir));
+    ck_assert_int_eq(chdir(dir), 0);
+    ck_assert_int_eq(mkdir(TICKETS_DIR, 0755), 0);
+    ck_assert_int_eq(write_ticket(".tickets/tc-a.md", "---\nid: tc-a\nstatus: open\n---\n"), 0);
+    ck_assert_int_eq(write_ticket(".tickets/tc-b.md", "---\nid: tc-b\ndeps: [tc-a]\n---\n"), 0);
+
+    LiveGraph live;
+    ck_assert_int_eq(live_graph_open(&live, NULL), 0);
+    WatchListing listing = {watch_test_shows, watch_test_print, watch_test_compare, NULL};
+    WatchView view;
+    watch_view_init(&view);
+    char *text = watch_test_update(&view, &listing, &live, 1);
+    ck_assert_str_eq(text, "tc-a open\n");
+    free(text);
+
+    /* Closing tc-a re-reads one file; tc-b is picked up as its dependent. */
+    ck_assert_int_eq(write_ticket(".tickets/tc-a.md", "---\nid: tc-a\nstatus: closed\n---\n"), 0);
+    ck_assert_int_eq(live_graph_refresh(&live), LIVE_CHANGED);
+    ck_assert(!live.relisted);
+    text = watch_test_update(&view, &listing, &live, 0);
+    ck_assert_str_eq(text, "- tc-a open\n+ tc-b open\n");
+    free(text);
+
+    ck_assert_int_eq(write_ticket(".tickets/tc-b.md", "---\nid: tc-b\nstatus: in_progress\n"
+                                                      "deps: [tc-a]\n---\n"),
+                     0);
+    ck_assert_int_eq(live_graph_refresh(&live), LIVE_CHANGED);
+    text = watch_test_update(&view, &listing, &live, 0);
+    ck_assert_str_eq(text, "~ tc-b in_progress\n");
+    free(text);
+
+    unlink(".tickets/tc-b.md");
+    ck_assert_int_eq(live_graph_refresh(&live), LIVE_CHANGED);
+    ck_assert(live.relisted);
+    text = watch_test_update(&view, &listing, &live, 0);
+    ck_assert_str_eq(text, "- tc-b in_progress\n");
+    free(text);
+
+    watch_view_free(&view);
+    live_graph_close(&live);
+    unlink(".tickets/tc-a.md");
+    rmdir(TICKETS_DIR);
+    ck_assert_int_eq(chdir(cwd), 0);
+    rmdir(dir);
+}
+END_TEST
+
+START_TEST(test_frontmatter_views) {
+    char path[] = "/tmp/ticket_fm_XXXXXX";
+    int fd = mkstemp(path);
+    ck_assert_int_ge(fd, 0);
+    close(fd);
+
+    char parent[2048];
+    memset(parent, 'p', sizeof(parent) - 1);
+    parent[sizeof(parent) - 1] = '\0';
+    char content[4096];
+    snprintf(content, sizeof(content),
+             "---\nstatus: in_progress\ndeps: [ tc-a ,, tc-b]\nparent: %s\npriority: -4\n---\n"
+             "body\n---\nstatus: closed\n# Title here\n",
+             parent);
+    ck_assert_int_eq(write_ticket(path, content), 0);
+
+    TicketFile file;
+    ck_assert_int_eq(ticket_file_open(&file, path), 0);
+    StrView value;
+    ck_assert_int_eq(frontmatter_get(&file, "status", &value), 1);
+    ck_assert(strview_eq(value, "in_progress"));
+    ck_assert_int_eq(frontmatter_get(&file, "parent", &value), 1);
+    ck_assert(strview_eq(value, parent));
+
+    int priority = 0;
+    ck_assert_int_eq(frontmatter_get(&file, "priority", &value), 1);
+    ck_assert_int_eq(strview_to_int(value, &priority), 0);
+    ck_assert_int_eq(priority, -4);
+
+    ck_assert_int_eq(frontmatter_get(&file, "deps", &value), 1);
+    StrView list = frontmatter_list(value);
+    StrView item;
+    ck_assert_int_eq(frontmatter_list_next(&list, &item), 1);
+    ck_assert(strview_eq(item, "tc-a"));
+    ck_assert_int_eq(frontmatter_list_next(&list, &item), 1);
+    ck_assert(strview_eq(item, "tc-b"));
+    ck_assert_int_eq(frontmatter_list_next(&list, &item), 0);
+
+    ck_assert(strview_eq(ticket_file_title(&file), "Title here"));
+    ck_assert_int_eq(frontmatter_get(&file, "links", &value), 0);
+    ticket_file_close(&file);
+    unlink(path);
+
+    const char text[] = "# Early title\n---\nlinks: [tc-c]\n---\nbody\n";
+    ticket_file_view(&file, text, sizeof(text) - 1);
+    ck_assert_int_eq(frontmatter_get(&file, "links", &value), 1);
+    ck_assert(strview_eq(value, "[tc-c]"));
+    ck_assert(strview_eq(ticket_file_title(&file), "Early title"));
+    ticket_file_close(&file);
+}
+END_TEST
+
+START_TEST(test_parallel_load_matches_sequential) {
+    char dir[] = "/tmp/ticket_jobs_XXXXXX";
+    char cwd[1024];
+    ck_assert_ptr_nonnull(getcwd(cwd, sizeof(cwd)));
+    ck_assert_ptr_nonnull(mkdtemp(dir));
+    ck_assert_int_eq(chdir(dir), 0);
+    ck_assert_int_eq(mkdir(TICKETS_DIR, 0755), 0);
+
+    char path[64], content[256];
+    for (int i = 0; i < 300; i++) {
+        snprintf(path, sizeof(path), ".tickets/tc-%03d.md", i);
+        snprintf(content, sizeof(content),
+                 "---\nstatus: %s\ndeps: [tc-%03d]\npriority: %d\n---\n# Ticket %d\n",
+                 i % 3 ? "open" : "closed", (i + 1) % 300, i % 5, i);
+        ck_assert_int_eq(write_ticket(path, content), 0);
+    }
+
+    TicketStore sequential, parallel;
+    set_load_workers(1);
+    ck_assert_int_eq(load_all_tickets(&sequential), 0);
+    set_load_workers(4);
+    ck_assert_int_eq(load_all_tickets(&parallel), 0);
+    set_load_workers(0);
+
+    ck_assert_int_eq(sequential.count, 300);
+    ck_assert_int_eq(parallel.count, sequential.count);
+    for (int i = 0; i < sequential.count; i++) {
+        const Ticket *a = sequential.tickets[i];
+        const Ticket *b = parallel.tickets[i];
+        ck_assert_str_eq(a->id, b->id);
+        ck_assert_str_eq(a->status, b->status);
+        ck_assert_str_eq(a->title, b->title);
+        ck_assert_int_eq(a->priority, b->priority);
+        ck_assert_int_eq(b->dep_count, 1);
+        ck_assert_str_eq(a->deps[0], b->deps[0]);
+    }
+    ticket_store_free(&sequential);
+    ticket_store_free(&parallel);
+
+    for (int i = 0; i < 300; i++) {
+        snprintf(path, sizeof(path), ".tickets/tc-%03d.md", i);
+        unlink(path);
+    }
+    rmdir(TICKETS_DIR);
+    ck_assert_int_eq(chdir(cwd), 0);
+    rmdir(dir);
+}
+END_TEST
+
+START_TEST(test_query_filter_native_subset) {
+    ck_assert_ptr_null(query_filter_compile(".status | test(\"op\")"));
+    ck_assert_ptr_null(query_filter_compile(".deps[0]"));
+    ck_assert_ptr_null(query_filter_compile(".status =="));
+
+    char path[] = "/tmp/ticket_query_XXXXXX";
+    int fd = mkstemp(path);
+    ck_assert_int_ge(fd, 0);
+    close(fd);
+    ck_assert_int_eq(write_ticket(path, "---\nid: tc-q\nstatus: open\ndeps: [tc-a, tc-b]\n"
+                                        "links: []\npriority: 3\n---\n# Query me\n"),
+                     0);
+    TicketFile file;
+    ck_assert_int_eq(ticket_file_open(&file, path), 0);
+
+    const char *matching[] = {
+        ".status == \"open\"",
+        ".priority > 1 and (.deps | length) == 2",
+        "IN(.deps[]; \"tc-b\")",
+        ".status | IN(\"open\", \"in_progress\")",
+        ".deps | contains([\"tc-a\"])",
+        "all(.deps[]; . > \"tc\") and (any(.links[]; true) | not)",
+        ".missing == null",
+    };
+    for (size_t i = 0; i < sizeof(matching) / sizeof(matching[0]); i++) {
+        QueryFilter *filter = query_filter_compile(matching[i]);
+        ck_assert_ptr_nonnull(filter);
+        ck_assert_int_eq(query_filter_match(filter, &file), 1);
+        query_filter_free(filter);
+    }
+
+    QueryFilter *filter = query_filter_compile(".status == \"closed\" or .priority < 3");
+    ck_assert_int_eq(query_filter_match(filter, &file), 0);
+    query_filter_free(filter);
+    filter = query_filter_compile(".status | contains(1)");
+    ck_assert_int_eq(query_filter_match(filter, &file), FILTER_NEEDS_JQ);
+    query_filter_free(filter);
+    ticket_file_close(&file);
+
+    ck_assert_int_eq(write_ticket(path, "---\nstatus: open\nstatus: closed\n---\n"), 0);
+    ck_assert_int_eq(ticket_file_open(&file, path), 0);
+    filter = query_filter_compile(".status == \"closed\"");
+    ck_assert_int_eq(query_filter_match(filter, &file), FILTER_NEEDS_JQ);
+    query_filter_free(filter);
+    ticket_file_close(&file);
+    unlink(path);
+}
+END_TEST
+
+START_TEST(test_out_buf_streams_past_buffer) {
+    char path[] = "/tmp/ticket_out_XXXXXX";
+    int fd = mkstemp(path);
+    ck_assert_int_ge(fd, 0);
+
+    size_t big_len = OUT_BUF_SIZE * 2 + 17;
+    char *big = malloc(big_len);
+    ck_assert_ptr_nonnull(big);
+    memset(big, 'x', big_len);
+    big[5] = '"';
+
+    OutBuf out;
+    ck_assert_int_eq(out_buf_init(&out, fd), 0);
+    out_buf_puts(&out, "{");
+    out_buf_json_string(&out, (StrView){"a\tb\\", 4});
+    out_buf_putc(&out, ':');
+    out_buf_json_string(&out, (StrView){big, big_len});
+    out_buf_puts(&out, "}\n");
+    ck_assert_int_eq(out_buf_close(&out), 0);
+    close(fd);
+
+    FILE *f = fopen(path, "r");
+    ck_assert_ptr_nonnull(f);
+    char head[16] = {0};
+    ck_assert_uint_eq(fread(head, 1, 15, f), 15);
+    ck_assert_str_eq(head, "{\"a\\tb\\\\\":\"xxxx");
+    ck_assert_int_eq(fseek(f, 0, SEEK_END), 0);
+    ck_assert_int_eq(ftell(f), (long)(big_len + 15));
+    fclose(f);
+    free(big);
+    unlink(path);
+}
+END_TEST
+
+START_TEST(test_out_buf_memory_matches_printf) {
+    char expected[1024];
+    int expected_len = 0;
+    OutBuf out;
+    ck_assert_int_eq(out_buf_init_memory(&out), 0);
+
+    const long long values[] = {0, 7, -3, 2147483647LL, -2147483647LL - 1, 1000000};
+    const char *ids[] = {"a", "tc-1234", "tc-12345", "tc-123456789"};
+    for (int i = 0; i < 6; i++) {
+        for (int j = 0; j < 4; j++) {
+            expected_len += snprintf(expected + expected_len, sizeof(expected) - expected_len,
+                                     "%-8s [P%lld]|", ids[j], values[i]);
+            out_buf_pad(&out, ids[j], 8);
+            out_buf_puts(&out, " [P");
+            out_buf_int(&out, values[i]);
+            out_buf_puts(&out, "]|");
+        }
+    }
+
+    /* Grown well past its initial size without flushing anything away. */
+    ck_assert_int_eq(out_buf_flush(&out), 0);
+    ck_assert_uint_eq(out.len, (size_t)expected_len);
+    ck_assert_int_eq(memcmp(out.data, expected, out.len), 0);
+    ck_assert_int_eq(out_buf_close(&out), 0);
+}
+END_TEST
+
+START_TEST(test_frontmatter_patch_edits_in_one_pass) {
+    const char *text = "---\nid: a\nstatus: open\ndeps: [x, y]\nlinks: []\ndeps: [z]\n---\n"
+                       "# T\n\nstatus: body\n---\ndeps: [q]\n";
+    const FrontmatterEdit edits[] = {
+        {FRONTMATTER_SET, "status", "closed"},
+        {FRONTMATTER_LIST_ADD, "deps", "w"},
+        {FRONTMATTER_LIST_REMOVE, "deps", "x"},
+        {FRONTMATTER_LIST_ADD, "deps", "y"},
+        {FRONTMATTER_LIST_ADD, "links", "a"},
+        {FRONTMATTER_LIST_ADD, "parent", "p"},
+        {FRONTMATTER_LIST_REMOVE, "tags", "t"},
+    };
+    TicketFile file;
+    ticket_file_view(&file, text, strlen(text));
+    OutBuf out;
+    ck_assert_int_eq(out_buf_init_memory(&out), 0);
+
+    /* Only the first deps line is patched, a missing key is added to the frontmatter and the
+     * body is left alone; the repeated add and the missing removal change nothing. */
+    ck_assert_int_eq(frontmatter_patch(&file, edits, 7, &out), 5);
+    const char *expected = "---\nid: a\nstatus: closed\ndeps: [y, w]\nlinks: [a]\ndeps: [z]\n"
+                           "parent: [p]\n---\n# T\n\nstatus: body\n---\ndeps: [q]\n";
+    ck_assert_uint_eq(out.len, strlen(expected));
+    ck_assert_int_eq(memcmp(out.data, expected, out.len), 0);
+
+    out.len = 0;
+    ck_assert_int_eq(frontmatter_patch(&file, &edits[3], 1, &out), 0);
+    ck_assert_uint_eq(out.len, strlen(text));
+    ck_assert_int_eq(memcmp(out.data, text, out.len), 0);
+
+    out.len = 0;
+    ticket_file_view(&file, "# no frontmatter\n", 17);
+    ck_assert_int_eq(frontmatter_patch(&file, edits, 7, &out), 0);
+    ck_assert_uint_eq(out.len, 17);
+    ck_assert_int_eq(out_buf_close(&out), 0);
+}
+END_TEST
+
+/* The first `size - 1` bytes of path, or "" if it cannot be read. */
+static const char *read_small(const char *path, char *buf, size_t size)
+{
+    FILE *f = fopen(path, "r");
+    size_t len = f != NULL ? fread(buf, 1, size - 1, f) : 0;
+    if (f != NULL) {
+        fclose(f);
+    }
+    buf[len] = '\0';
+    return buf;
+}
+
+static int dir_entry_count(const char *path)
+{
+    DIR *dir = opendir(path);
+    int count = 0;
+    struct dirent *entry;
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        count += entry->d_name[0] != '.';
+    }
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    return count;
+}
+
+START_TEST(test_atomic_write_replaces_whole_files) {
+    char dir[] = "/tmp/ticket_atomic_XXXXXX";
+    ck_assert_ptr_nonnull(mkdtemp(dir));
+    char path[64];
+    snprintf(path, sizeof(path), "%s/t.md", dir);
+    char buf[32];
+
+    ck_assert_int_eq(atomic_write_file(path, "one\n", 4, ATOMIC_WRITE_CREATE), 0);
+    ck_assert_str_eq(read_small(path, buf, sizeof(buf)), "one\n");
+    ck_assert_int_ne(atomic_write_file(path, "two\n", 4, ATOMIC_WRITE_CREATE), 0);
+    ck_assert_str_eq(read_small(path, buf, sizeof(buf)), "one\n");
+
+    /* A replacement keeps the file's mode and leaves no temporary file behind. */
+    ck_assert_int_eq(chmod(path, 0640), 0);
+    AtomicFile file;
+    ck_assert_int_eq(atomic_file_open(&file, path, 0), 0);
+    fputs("three\n", file.stream);
+    ck_assert_str_eq(read_small(path, buf, sizeof(buf)), "one\n");
+    ck_assert_int_eq(atomic_file_commit(&file), 0);
+    ck_assert_str_eq(read_small(path, buf, sizeof(buf)), "three\n");
+    struct stat st;
+    ck_assert_int_eq(stat(path, &st), 0);
+    ck_assert_int_eq(st.st_mode & 0777, 0640);
+
+    ck_assert_int_eq(atomic_file_open(&file, path, 0), 0);
+    fputs("dropped\n", file.stream);
+    atomic_file_abort(&file);
+    ck_assert_str_eq(read_small(path, buf, sizeof(buf)), "three\n");
+
+    setenv("TICKET_FSYNC", "1", 1);
+    ck_assert_int_eq(atomic_write_file(path, "four\n", 5, 0), 0);
+    ck_assert_int_eq(atomic_write_sync(), 0);
+    unsetenv("TICKET_FSYNC");
+    ck_assert_str_eq(read_small(path, buf, sizeof(buf)), "four\n");
+    ck_assert_int_eq(dir_entry_count(dir), 1);
+
+    unlink(path);
+    rmdir(dir);
+}
+END_TEST
+
+START_TEST(test_file_lock_follows_replaced_file) {
+    char dir[] = "/tmp/ticket_lock_XXXXXX";
+    ck_assert_ptr_nonnull(mkdtemp(dir));
+    char path[64];
+    snprintf(path, sizeof(path), "%s/t.md", dir);
+    ck_assert_int_eq(atomic_write_file(path, "one\n", 4, 0), 0);
+
+    FileLock lock;
+    ck_assert_int_eq(file_lock_acquire(&lock, path), 0);
+    pid_t child = fork();
+    ck_assert_int_ge(child, 0);
+    if (child == 0) {
+        /* The inherited descriptor shares the parent's lock, so it goes first. The child then
+         * waits for the parent and must end up holding the file that replaced the one locked
+         * when it started waiting. */
+        close(lock.fd);
+        FileLock waiter;
+        struct stat st;
+        int ok = file_lock_acquire(&waiter, path) == 0 && stat(path, &st) == 0 &&
+                 waiter.stamp.ino == (uint64_t)st.st_ino && st.st_size == 4;
+        _exit(ok ? 0 : 1);
+    }
+    usleep(50000);
+    ck_assert_int_eq(atomic_write_file(path, "two\n", 4, 0), 0);
+    file_lock_release(&lock);
+    int status;
+    ck_assert_int_eq(waitpid(child, &status, 0), child);
+    ck_assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    unlink(path);
+    rmdir(dir);
+}
+END_TEST
+
+/* Runs the batch in a child with stdout and stderr sent to batch.out and batch.err; returns
+ * its exit status. */
+static int run_batch(const char *input)
+{
+    pid_t child = fork();
+    if (child == 0) {
+        FILE *in = fmemopen((void *)input, strlen(input), "r");
+        if (in == NULL || freopen("batch.out", "w", stdout) == NULL ||
+            freopen("batch.err", "w", stderr) == NULL) {
+            _exit(100);
+        }
+        int rc = batch_run(in);
+        fflush(stdout);
+        fflush(stderr);
+        _exit(rc);
+    }
+    int status;
+    if (child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+START_TEST(test_batch_groups_edits_and_numbers_errors) {
+    char dir[] = "/tmp/ticket_batch_XXXXXX";
+    char cwd[1024];
+    ck_assert_ptr_nonnull(getcwd(cwd, sizeof(cwd)));
+    ck_assert_ptr_nonnull(mkdtemp(dir));
+    ck_assert_int_eq(chdir(dir), 0);
+    ck_assert_int_eq(mkdir(TICKETS_DIR, 0755), 0);
+    const char *ids[] = {"tc-a", "tc-b", "tc-c"};
+    for (int i = 0; i < 3; i++) {
+        char path[64];
+        char text[128];
+        snprintf(path, sizeof(path), ".tickets/%s.md", ids[i]);
+        snprintf(text, sizeof(text), "---\nid: %s\nstatus: open\ndeps: []\nlinks: []\n---\n# T\n",
+                 ids[i]);
+        ck_assert_int_eq(write_ticket(path, text), 0);
+    }
+    struct stat before;
+    ck_assert_int_eq(stat(".tickets/tc-b.md", &before), 0);
+
+    /* Every operation on tc-a lands in the one write-back; the failed lines do not stop the
+     * ones after them. */
+    ck_assert_int_eq(run_batch("start tc-a\n"
+                               "dep tc-a tc-b\n"
+                               "dep tc-a tc-b\n"
+                               "status tc-a bogus\n"
+                               "dep tc-a tc-zz\n"
+                               "\n"
+                               "link tc-a tc-c\n"
+                               "undep tc-c tc-a\n"),
+                     1);
+    char buf[512];
+    ck_assert_str_eq(read_small(".tickets/tc-a.md", buf, sizeof(buf)),
+                     "---\nid: tc-a\nstatus: in_progress\ndeps: [tc-b]\nlinks: [tc-c]\n---\n"
+                     "# T\n");
+    ck_assert_str_eq(read_small(".tickets/tc-c.md", buf, sizeof(buf)),
+                     "---\nid: tc-c\nstatus: open\ndeps: []\nlinks: [tc-a]\n---\n# T\n");
+    struct stat after;
+    ck_assert_int_eq(stat(".tickets/tc-b.md", &after), 0);
+    ck_assert(after.st_ino == before.st_ino);
+
+    ck_assert_str_eq(read_small("batch.out", buf, sizeof(buf)),
+                     "Updated tc-a -> in_progress\n"
+                     "Added dependency: tc-a -> tc-b\n"
+                     "Dependency already exists\n"
+                     "Added 2 link(s) between 2 tickets\n");
+    ck_assert_str_eq(read_small("batch.err", buf, sizeof(buf)),
+                     "Error: line 4: invalid status 'bogus'. Valid statuses: open in_progress "
+                     "closed\n"
+                     "Error: line 5: ticket 'tc-zz' not found\n"
+                     "Error: line 8: Dependency not found\n");
+
+    for (int i = 0; i < 3; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), ".tickets/%s.md", ids[i]);
+        unlink(path);
+    }
+    rmdir(TICKETS_DIR);
+    unlink("batch.out");
+    unlink("batch.err");
+    ck_assert_int_eq(chdir(cwd), 0);
+    rmdir(dir);
+}
+END_TEST
+
+START_TEST(test_graph_counters_follow_status) {
+    TicketStore store;
+    ticket_store_init(&store);
+    Ticket *a = ticket_store_add(&store, "tc-a", 4);
+    Ticket *b = ticket_store_add(&store, "tc-b", 4);
+    Ticket *c = ticket_store_add(&store, "tc-c", 4);
+    const char *b_deps[] = {a->id, a->id};
+    const char *c_deps[] = {a->id, b->id, intern(&store.strings, "tc-gone", 7)};
+    b->deps = b_deps;
+    b->dep_count = 2;
+    c->deps = c_deps;
+    c->dep_count = 3;
+    c->parent = a->id;
+    a->parent = c->id;
+
+    TicketGraph graph;
+    ck_assert_int_eq(ticket_graph_build(&graph, &store), 0);
+    ck_assert_int_eq(graph.dependent_start[1] - graph.dependent_start[0], 2);
+    ck_assert_int_eq(graph.dependents[graph.dependent_start[0]], 1);
+    ck_assert_int_eq(graph.dependents[graph.dependent_start[0] + 1], 2);
+    ck_assert_int_eq(graph.dep_targets[graph.dep_start[2] + 2], -1);
+    ck_assert_int_eq(graph.child_start[1] - graph.child_start[0], 1);
+    ck_assert_int_eq(graph.children[graph.child_start[0]], 2);
+    ck_assert_int_eq(graph.child_start[2] - graph.child_start[1], 0);
+    ck_assert_int_eq(graph.children[graph.child_start[2]], 0);
+    ck_assert_int_eq(graph.unresolved[1], 2);
+    ck_assert_int_eq(graph.unresolved[2], 3);
+    ck_assert(ticket_graph_is_ready(&graph, &store, 0));
+    ck_assert(ticket_graph_is_blocked(&graph, &store, 1));
+
+    ticket_graph_set_status(&graph, &store, 0, "closed");
+    ck_assert_str_eq(a->status, "closed");
+    ck_assert(!ticket_graph_is_ready(&graph, &store, 0));
+    ck_assert(ticket_graph_is_ready(&graph, &store, 1));
+    ck_assert_int_eq(graph.unresolved[2], 2);
+    ticket_graph_set_status(&graph, &store, 1, "closed");
+    ck_assert_int_eq(graph.unresolved[2], 1);
+    ck_assert(ticket_graph_is_blocked(&graph, &store, 2));
+    ticket_graph_set_status(&graph, &store, 0, "in_progress");
+    ck_assert_int_eq(graph.unresolved[1], 2);
+    ck_assert_int_eq(graph.unresolved[2], 2);
+
+    ticket_graph_free(&graph);
+    ticket_store_free(&store);
+}
+END_TEST
+
+START_TEST(test_graph_tree_depths_skip_cycles) {
+    TicketStore store;
+    ticket_store_init(&store);
+    Ticket *a = ticket_store_add(&store, "tc-a", 4);
+    Ticket *b = ticket_store_add(&store, "tc-b", 4);
+    Ticket *c = ticket_store_add(&store, "tc-c", 4);
+    Ticket *d = ticket_store_add(&store, "tc-d", 4);
+    const char *a_deps[] = {b->id, c->id, intern(&store.strings, "tc-gone", 7)};
+    const char *b_deps[] = {c->id};
+    const char *c_deps[] = {a->id};
+    const char *d_deps[] = {a->id};
+    a->deps = a_deps;
+    a->dep_count = 3;
+    b->deps = b_deps;
+    b->dep_count = 1;
+    c->deps = c_deps;
+    c->dep_count = 1;
+    d->deps = d_deps;
+    d->dep_count = 1;
+
+    TicketGraph graph;
+    int max_depth[4], subtree_depth[4];
+    ck_assert_int_eq(ticket_graph_build(&graph, &store), 0);
+    ck_assert_int_eq(ticket_graph_tree_depths(&graph, 0, max_depth, subtree_depth), 0);
+    ck_assert_int_eq(max_depth[0], 0);
+    ck_assert_int_eq(max_depth[1], 1);
+    ck_assert_int_eq(max_depth[2], 2);
+    ck_assert_int_eq(max_depth[3], -1);
+    ck_assert_int_eq(subtree_depth[0], 2);
+    ck_assert_int_eq(subtree_depth[1], 2);
+    ck_assert_int_eq(subtree_depth[2], 2);
+    ck_assert_int_eq(subtree_depth[3], -1);
+
+    ck_assert_int_eq(ticket_graph_tree_depths(&graph, 3, max_depth, subtree_depth), 0);
+    ck_assert_int_eq(max_depth[0], 1);
+    ck_assert_int_eq(max_depth[2], 3);
+    ck_assert_int_eq(subtree_depth[3], 3);
+
+    ticket_graph_free(&graph);
+    ticket_store_free(&store);
+}
+END_TEST
+
+START_TEST(test_columnar_snapshot_layout) {
+    TicketStore store;
+    ticket_store_init(&store);
+    Ticket *a = ticket_store_add(&store, "tc-a", 4);
+    Ticket *b = ticket_store_add(&store, "tc-bb", 5);
+    const char *b_deps[] = {intern(&store.strings, "tc-gone", 7), a->id};
+    b->deps = b_deps;
+    b->dep_count = 2;
+    b->links = &a->id;
+    b->link_count = 1;
+    b->parent = a->id;
+    b->title = "Second";
+    b->type = intern(&store.strings, "bug", 3);
+    b->assignee = intern(&store.strings, "Ann", 3);
+    b->priority = 0;
+    a->status = intern(&store.strings, "closed", 6);
+
+    OutBuf out;
+    ck_assert_int_eq(out_buf_init_memory(&out), 0);
+    ck_assert_int_eq(columnar_write(&store, &out), 0);
+
+    ColumnarHeader header;
+    memcpy(&header, out.data, sizeof(header));
+    ck_assert_int_eq(memcmp(header.magic, COLUMNAR_MAGIC, 8), 0);
+    ck_assert_uint_eq(header.ticket_count, 2);
+    ck_assert_uint_eq(header.id_count, 3);
+    ck_assert_uint_eq(header.status_count, 2);
+    ck_assert_uint_eq(header.type_count, 2);
+    ck_assert_uint_eq(header.dep_count, 2);
+    ck_assert_uint_eq(header.link_count, 1);
+    ck_assert_uint_eq(header.strings_size, 4 + 5 + 7 + 6 + 3 + 6 + 4 + 3);
+
+    /* Columns in file order: id, title, assignee, status and type offsets, priority, parent,
+     * deps, links. */
+    uint32_t words[4 + 3 + 3 + 3 + 3 + 2 + 2 + 3 + 2 + 3 + 1];
+    ck_assert_uint_eq(out.len, sizeof(header) + sizeof(words) + 4 + header.strings_size);
+    memcpy(words, out.data + sizeof(header), sizeof(words));
+    const uint32_t expected[] = {0, 4, 9, 16, 16, 16, 22, 22, 22, 25, 25, 31, 35, 35, 35, 38, 2,
+                                 0, COLUMNAR_NONE, 0, 0, 0, 2, 2, 0, 0, 0, 1, 0};
+    ck_assert_int_eq(memcmp(words, expected, sizeof(words)), 0);
+    const char *rest = out.data + sizeof(header) + sizeof(words);
+    const char codes[] = {0, 1, 0, 1};
+    ck_assert_int_eq(memcmp(rest, codes, sizeof(codes)), 0);
+    ck_assert_int_eq(memcmp(rest + 4, "tc-atc-bbtc-goneSecondAnnclosedopenbug", 38), 0);
+
+    ck_assert_int_eq(out_buf_close(&out), 0);
+    ticket_store_free(&store);
+}
+END_TEST
+
 Suite *main_suite(void) {
     Suite *s;
     TCase *tc_core;
@@ -14,6 +1135,29 @@ Suite *main_suite(void) {
     tc_core = tcase_create("Core");
     
     tcase_add_test(tc_core, test_placeholder);
+    tcase_add_test(tc_core, test_arena_alloc_and_strndup);
+    tcase_add_test(tc_core, test_intern_deduplicates);
+    tcase_add_test(tc_core, test_store_grows_without_moving_tickets);
+    tcase_add_test(tc_core, test_preloaded_store_is_handed_over_once);
+    tcase_add_test(tc_core, test_index_cache_round_trip);
+    tcase_add_test(tc_core, test_neighbourhood_load_uses_index);
+    tcase_add_test(tc_core, test_id_resolver_uses_current_index);
+    tcase_add_test(tc_core, test_id_grams_narrow_like_the_index);
+    tcase_add_test(tc_core, test_index_carry_excludes_concurrent_create);
+    tcase_add_test(tc_core, test_live_graph_follows_edits);
+    tcase_add_test(tc_core, test_watch_view_prints_ready_changes);
+    tcase_add_test(tc_core, test_frontmatter_views);
+    tcase_add_test(tc_core, test_parallel_load_matches_sequential);
+    tcase_add_test(tc_core, test_query_filter_native_subset);
+    tcase_add_test(tc_core, test_out_buf_streams_past_buffer);
+    tcase_add_test(tc_core, test_out_buf_memory_matches_printf);
+    tcase_add_test(tc_core, test_frontmatter_patch_edits_in_one_pass);
+    tcase_add_test(tc_core, test_atomic_write_replaces_whole_files);
+    tcase_add_test(tc_core, test_file_lock_follows_replaced_file);
+    tcase_add_test(tc_core, test_batch_groups_edits_and_numbers_errors);
+    tcase_add_test(tc_core, test_graph_counters_follow_status);
+    tcase_add_test(tc_core, test_graph_tree_depths_skip_cycles);
+    tcase_add_test(tc_core, test_columnar_snapshot_layout);
     suite_add_tcase(s, tc_core);
     
     return s;